@@ -0,0 +1,220 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "alarmaudio.h"
+
+AlarmAudio::AlarmAudio(DfPlayer &dfPlayer)
+    : dfPlayer_(dfPlayer)
+    , prewarmSeconds_(PREWARM_SECONDS)
+    , rampSeconds_(RAMP_SECONDS)
+    , curve_(Curve::Quadratic)
+    , state_(State::Off)
+    , at_(nil_time)
+    , volume_(0)
+    , count_(0)
+    , next_(0)
+    , waitFor_(0)
+    , latencyUs_(0)
+{
+}
+
+void AlarmAudio::setPrewarmSeconds(uint8_t seconds)
+{
+  prewarmSeconds_ = seconds > MAX_PREWARM_SECONDS ? MAX_PREWARM_SECONDS : seconds;
+}
+
+void AlarmAudio::setRamp(uint16_t seconds, Curve curve)
+{
+  rampSeconds_ = seconds;
+  curve_       = curve;
+}
+
+void AlarmAudio::arm(absolute_time_t at)
+{
+  if (state_ != State::Off and state_ != State::Armed)
+  {
+    return;
+  }
+
+  at_    = at;
+  state_ = State::Armed;
+}
+
+void AlarmAudio::disarm()
+{
+  if (armed())
+  {
+    stop();
+  }
+}
+
+void AlarmAudio::start()
+{
+  if (playing())
+  {
+    return;
+  }
+
+  if (state_ == State::Ready)
+  {
+    dfPlayer_.resume();
+  }
+  else
+  {
+    // Cold, or the prewarm is still on its way: whatever of it is queued
+    // takes the first step's volume and the track starts after it.
+    if (state_ == State::Off or state_ == State::Armed)
+    {
+      volume_ = dfPlayer_.volume();
+      plan();
+    }
+    if (state_ == State::Off)
+    {
+      at_ = get_absolute_time();
+    }
+    dfPlayer_.setVolume(steps_[0].volume);
+    dfPlayer_.setPlayMode(DfPlayer::PlayMode::Random);
+    dfPlayer_.next();
+  }
+
+  waitFor_ = dfPlayer_.finished() + dfPlayer_.queued();
+  next_    = 1;
+  state_   = next_ < count_ ? State::Ramping : State::Playing;
+}
+
+void AlarmAudio::stop()
+{
+  switch (state_)
+  {
+  case State::Off:
+  case State::Restoring:
+    return;
+  case State::Armed:
+    break;
+  case State::Loading:
+    // A volume queued now would merge into the silent one ahead of the
+    // track; it goes out once the prewarm is through.
+    state_ = State::Restoring;
+    return;
+  case State::Ready:
+    dfPlayer_.setVolume(volume_);
+    break;
+  case State::Ramping:
+  case State::Playing:
+    dfPlayer_.pause();
+    dfPlayer_.setVolume(volume_);
+    break;
+  }
+  state_ = State::Off;
+}
+
+void AlarmAudio::update()
+{
+  switch (state_)
+  {
+  case State::Armed:
+    if (prewarmSeconds_ > 0 and time_reached(deadline()))
+    {
+      prewarm();
+    }
+    break;
+  case State::Loading:
+    if (dfPlayer_.idle())
+    {
+      dfPlayer_.setVolume(steps_[0].volume);
+      state_ = State::Ready;
+    }
+    break;
+  case State::Restoring:
+    if (dfPlayer_.idle())
+    {
+      dfPlayer_.setVolume(volume_);
+      state_ = State::Off;
+    }
+    break;
+  case State::Ramping:
+    while (next_ < count_ and time_reached(delayed_by_ms(at_, steps_[next_].ms)))
+    {
+      dfPlayer_.setVolume(steps_[next_++].volume);
+    }
+    if (next_ == count_)
+    {
+      state_ = State::Playing;
+    }
+    break;
+  default:
+    break;
+  }
+
+  if (waitFor_ != 0 and dfPlayer_.finished() >= waitFor_)
+  {
+    int64_t latency = absolute_time_diff_us(at_, get_absolute_time());
+    latencyUs_      = latency > 0 ? uint32_t(latency) : 0;
+    waitFor_        = 0;
+  }
+}
+
+absolute_time_t AlarmAudio::deadline() const
+{
+  switch (state_)
+  {
+  case State::Armed:
+  {
+    if (prewarmSeconds_ == 0)
+    {
+      return at_the_end_of_time;
+    }
+    uint64_t at    = to_us_since_boot(at_);
+    uint64_t ahead = uint64_t(prewarmSeconds_) * 1000000;
+    return from_us_since_boot(at > ahead ? at - ahead : 0);
+  }
+  case State::Ramping:
+    return delayed_by_ms(at_, steps_[next_].ms);
+  default:
+    return at_the_end_of_time;
+  }
+}
+
+// Volume 1 at the start, the user's level at the end and the curve in
+// between; steps that would repeat a volume are left out.
+void AlarmAudio::plan()
+{
+  uint32_t power = uint32_t(curve_) + 1;
+  uint32_t full  = 1;
+  for (uint32_t p = 0; p < power; p++)
+  {
+    full *= STEPS - 1;
+  }
+
+  count_ = 0;
+  for (uint32_t i = 0; i < STEPS; i++)
+  {
+    uint32_t x = 1;
+    for (uint32_t p = 0; p < power; p++)
+    {
+      x *= i;
+    }
+
+    uint8_t volume = volume_ > 0 ? uint8_t(1 + uint32_t(volume_ - 1) * x / full) : 0;
+    if (count_ > 0 and steps_[count_ - 1].volume == volume)
+    {
+      continue;
+    }
+    steps_[count_++] = Step{uint32_t(rampSeconds_) * 1000 * i / (STEPS - 1), volume};
+  }
+}
+
+// The track starts silent and is paused again at once; the first step's
+// volume follows once the pause went through.
+void AlarmAudio::prewarm()
+{
+  volume_ = dfPlayer_.volume();
+  plan();
+  dfPlayer_.setVolume(0);
+  dfPlayer_.setPlayMode(DfPlayer::PlayMode::Random);
+  dfPlayer_.next();
+  dfPlayer_.pause();
+  state_ = State::Loading;
+}
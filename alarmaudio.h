@@ -0,0 +1,107 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "dfplayer.h"
+#include "pico/time.h"
+#include <stdint.h>
+
+// The alarm sound on the DFPlayer. Armed with the time the alarm rings, it
+// wakes the player prewarmSeconds() ahead, loads a track and leaves it
+// paused at the first step of the crescendo, so start() on the minute only
+// has to resume it. The volume then climbs to the user's level along the
+// curve in at most STEPS volume commands spread over rampSeconds().
+//
+// The time from the alarm to the player's answer to the command that
+// started the sound is kept in latencyUs(), for the shell's stats and the
+// profiler.
+class AlarmAudio
+{
+public:
+  enum class Curve : uint8_t
+  {
+    Linear,
+    Quadratic,
+    Cubic
+  };
+
+  static constexpr uint32_t STEPS              = 8;
+  static constexpr uint8_t PREWARM_SECONDS     = 10;
+  static constexpr uint8_t MAX_PREWARM_SECONDS = 59;
+  static constexpr uint16_t RAMP_SECONDS       = 60;
+
+  AlarmAudio(DfPlayer &dfPlayer);
+
+  // 0 turns the prewarm off, the alarm then starts the player cold.
+  uint8_t prewarmSeconds() const { return prewarmSeconds_; }
+  void setPrewarmSeconds(uint8_t seconds);
+
+  uint16_t rampSeconds() const { return rampSeconds_; }
+  Curve curve() const { return curve_; }
+  void setRamp(uint16_t seconds, Curve curve);
+
+  // The alarm rings at `at`; at most a minute ahead, as the player is woken
+  // from the minute before.
+  void arm(absolute_time_t at);
+
+  // Forgets an armed alarm that did not start and gives the player its
+  // volume back.
+  void disarm();
+
+  // The alarm is due: resumes the prepared track or starts one.
+  void start();
+
+  // Stops the sound and leaves the player at the user's volume.
+  void stop();
+
+  // The alarm time armed or started with.
+  absolute_time_t at() const { return at_; }
+
+  bool armed() const { return state_ == State::Armed or state_ == State::Loading or state_ == State::Ready; }
+  bool playing() const { return state_ == State::Ramping or state_ == State::Playing; }
+
+  // Sends what is due of the prewarm and the ramp; run with the player's
+  // poll().
+  void update();
+  absolute_time_t deadline() const;
+
+  uint32_t latencyUs() const { return latencyUs_; }
+
+private:
+  enum class State : uint8_t
+  {
+    Off,
+    Armed,      ///< Waiting for the prewarm or, without one, the alarm.
+    Loading,    ///< Track loading at volume 0.
+    Ready,      ///< Track paused at the first step.
+    Ramping,
+    Playing,
+    Restoring   ///< Stopped while loading, the volume follows once through.
+  };
+
+  struct Step
+  {
+    uint32_t ms;        ///< After the start.
+    uint8_t volume;
+  };
+
+  DfPlayer &dfPlayer_;
+  uint8_t prewarmSeconds_;
+  uint16_t rampSeconds_;
+  Curve curve_;
+
+  State state_;
+  absolute_time_t at_;
+  int32_t volume_;        ///< The user's level the ramp ends at.
+  Step steps_[STEPS];
+  uint32_t count_;
+  uint32_t next_;         ///< First step not sent yet.
+  uint32_t waitFor_;      ///< player finished() once the sound started, 0 once logged.
+  uint32_t latencyUs_;
+
+  void plan();
+  void prewarm();
+};
@@ -0,0 +1,795 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "alarmclock.h"
+#include <stdio.h>
+
+uint8_t constexpr PIXEL_LEFT   = 2;
+uint8_t constexpr PIXEL_MIDDLE = 1;
+uint8_t constexpr PIXEL_RIGHT  = 0;
+uint8_t constexpr PIXEL_FRONT  = 3;
+
+uint8_t constexpr LUX_ADDRESS  = 0x23;
+
+uint32_t constexpr MENU_TIMEOUT_MS     = 10000;
+uint32_t constexpr ALARM_OFF_MS        = 10 * 60 * 1000;
+uint32_t constexpr ALARM_BLINK_MS      = 2000;
+uint16_t constexpr ALARM_BLINK_STEP_MS = 50;
+uint16_t constexpr SUNRISE_STEP_MS     = 250;
+uint8_t constexpr MAX_BRIGHTNESS       = 15;
+uint32_t constexpr SECONDS_PER_DAY     = 24 * 60 * 60;
+uint32_t constexpr SECONDS_PER_WEEK    = 7 * SECONDS_PER_DAY;
+
+// Red fading in, holding and fading out on the front pixel while the alarm
+// plays.
+static constexpr Keyframe alarmBlink[] = {
+{   0, {  0,   0,   0}},
+{ 366, {255,   0,   0}},
+{ 634, {255,   0,   0}},
+{1000, {  0,   0,   0}}};
+
+// Night to daylight through the colour of the sky at dawn: deep red, orange
+// around 1800 K, warm white around 2700 K and about 4500 K at the alarm.
+static constexpr Keyframe sunrise[] = {
+{   0, {  0,   0,   0}},
+{ 150, { 48,   0,   0}},
+{ 400, {160,  24,   0}},
+{ 650, {255,  96,   8}},
+{ 850, {255, 160,  64}},
+{1000, {255, 220, 180}}};
+
+using S = State<AlarmClock>;
+
+const State<AlarmClock> AlarmClock::states_[] = {
+  // name          onEnter                                  onRun                                  onExit                                  onDeadline
+  {"Idle",         S::call<&AlarmClock::idleEnter>,         S::call<&AlarmClock::idleRun>,         nullptr,                                S::call<&AlarmClock::idleDeadline>},
+  {"Menu",         S::call<&AlarmClock::menuEnter>,         S::call<&AlarmClock::menuRun>,         nullptr,                                S::call<&AlarmClock::menuDeadline>},
+  {"MenuTime",     S::call<&AlarmClock::menuTimeEnter>,     S::call<&AlarmClock::menuTimeRun>,     nullptr,                                S::call<&AlarmClock::menuDeadline>},
+  {"MenuAlarm",    S::call<&AlarmClock::menuAlarmEnter>,    S::call<&AlarmClock::menuAlarmRun>,    nullptr,                                S::call<&AlarmClock::menuDeadline>},
+  {"MenuVolumen",  S::call<&AlarmClock::menuVolumenEnter>,  S::call<&AlarmClock::menuVolumenRun>,  S::call<&AlarmClock::menuVolumenExit>,  S::call<&AlarmClock::menuDeadline>},
+  {"ShowAlarm",    S::call<&AlarmClock::showAlarmEnter>,    S::call<&AlarmClock::showAlarmRun>,    nullptr,                                S::call<&AlarmClock::showAlarmDeadline>},
+};
+
+const MenuItem AlarmClock::menuItems_[] = {
+  {"Alarm",   StateMachineCommand::changeTo(StateId::MenuAlarm)},
+  {"Zeit",    StateMachineCommand::changeTo(StateId::MenuTime)},
+  {"Volumen", StateMachineCommand::changeTo(StateId::MenuVolumen)},
+  {"Exit",    StateMachineCommand::changeTo(StateId::Idle)},
+};
+
+static void play(DfPlayer & dfPlayer)
+{
+  dfPlayer.setPlayMode(DfPlayer::PlayMode::Random);
+  dfPlayer.next();
+}
+
+AlarmClock::AlarmClock(Keys &keys,
+                       cilo72::ic::SD2405 &rtc,
+                       cilo72::ic::BH1750FVI &lux,
+                       I2cDma &i2cDma,
+                       Mailbox<Frame> &frames,
+                       DfPlayer &dfPlayer)
+    : keys_(keys)
+    , rtc_(rtc)
+    , lux_(lux)
+    , i2cDma_(i2cDma)
+    , frames_(frames)
+    , dfPlayer_(dfPlayer)
+    , audio_(dfPlayer)
+    , timer_(nullptr)
+    , hm_(rtc, i2cDma)
+    , timeSet_(KeyPlus, KeyMinus, KeyEnter)
+    , alarmIsPlaying_(false)
+    , sunriseMinutes_(SUNRISE_MINUTES)
+    , snoozing_(false)
+    , snoozeMinutes_(SNOOZE_MINUTES)
+    , maxSnoozes_(MAX_SNOOZES)
+    , snoozes_(0)
+    , snoozeEnd_(nil_time)
+    , menu_(menuItems_)
+    , alarmOn_(graph_, "alarm on", false)
+    , time_(graph_, "time")
+    , light_(graph_, "light")
+    , level_(graph_, "level", {&light_}, *this, Computed<uint8_t, AlarmClock>::call<&AlarmClock::lightLevel>)
+    , alarmEffect_(graph_, "alarm", {&alarmOn_}, *this, Effect<AlarmClock>::call<&AlarmClock::alarmOnChanged>)
+    , timeEffect_(graph_, "clock", {&time_}, *this, Effect<AlarmClock>::call<&AlarmClock::timeChanged>)
+    , brightnessEffect_(graph_, "brightness", {&level_}, *this, Effect<AlarmClock>::call<&AlarmClock::showBrightness>)
+    , sm_(*this, states_, uint8_t(StateId::Idle))
+{
+  // Until alarms are stored elsewhere the RTC alarm register seeds the first
+  // one, which rings every day.
+  cilo72::ic::SD2405::Time alarm;
+  {
+    I2cDma::Claim claim(i2cDma_, HourMinute::RTC_ADDRESS, I2cDma::Priority::Clock);
+    alarm = rtc_.alarm();
+  }
+  alarms_.add({alarm.hour(), alarm.minute(), Alarms::EVERY_DAY, Alarms::Alarm::Enabled});
+  alarms_.nextChanged();
+
+  timers_.start(luxTimer_, ambient_.intervalMs(), ambient_.intervalMs());
+
+  frames_.publish(frame_);
+  published_ = frame_;
+}
+
+void AlarmClock::showMenu()
+{
+  frame_.view = Frame::View::Menu;
+  frame_.menu = menu_.view();
+}
+
+void AlarmClock::showClock()
+{
+  const HourMinute::Time &time = hm_;
+  frame_.view   = Frame::View::Clock;
+  frame_.hour   = time.hour();
+  frame_.minute = time.minute();
+}
+
+// The time left of the snooze, rounded up to whole seconds.
+void AlarmClock::showSnooze()
+{
+  int64_t left  = absolute_time_diff_us(get_absolute_time(), snoozeEnd_);
+  uint32_t s    = left > 0 ? uint32_t((left + 999999) / 1000000) : 0;
+  frame_.view   = Frame::View::Snooze;
+  frame_.minute = s / 60;
+  frame_.second = s % 60;
+}
+
+void AlarmClock::showTimeSet()
+{
+  frame_.view   = Frame::View::TimeSet;
+  frame_.hour   = timeSet_.time().hour();
+  frame_.minute = timeSet_.time().minute();
+  frame_.digit  = timeSet_.selected();
+}
+
+// Also stops an animation running on the pixel.
+void AlarmClock::setPixel(uint8_t index, uint8_t r, uint8_t g, uint8_t b)
+{
+  frame_.pixels[index].r   = r;
+  frame_.pixels[index].g   = g;
+  frame_.pixels[index].b   = b;
+  frame_.animations[index] = Animation();
+}
+
+// The pixels stay at ambient brightness, except that a sunrise needs all of
+// it and the alarm keeps what it started with.
+void AlarmClock::showBrightness()
+{
+  frame_.contrast = ambient_.brightness(level_.get()).oled;
+
+  if(not alarmIsPlaying_)
+  {
+    frame_.brightness = sunriseRunning() ? MAX_BRIGHTNESS : ambient_.brightness(level_.get()).pixel;
+  }
+}
+
+void AlarmClock::setSnoozeMinutes(uint8_t minutes)
+{
+  snoozeMinutes_ = minutes < 1 ? 1 : minutes > MAX_SNOOZE_MINUTES ? MAX_SNOOZE_MINUTES : minutes;
+}
+
+void AlarmClock::setMaxSnoozes(uint8_t count)
+{
+  maxSnoozes_ = count > SNOOZES_LIMIT ? SNOOZES_LIMIT : count;
+}
+
+void AlarmClock::setSunriseMinutes(uint8_t minutes)
+{
+  if(minutes != 0 and minutes < MIN_SUNRISE_MINUTES)
+  {
+    minutes = MIN_SUNRISE_MINUTES;
+  }
+  if(minutes > MAX_SUNRISE_MINUTES)
+  {
+    minutes = MAX_SUNRISE_MINUTES;
+  }
+  sunriseMinutes_ = minutes;
+}
+
+bool AlarmClock::sunriseRunning() const
+{
+  return frame_.animations[PIXEL_LEFT].keys == sunrise;
+}
+
+// The sunrise takes the last sunriseMinutes_ before the next alarm and holds
+// its last colour while the alarm rings. It is placed from the alarm time,
+// so when it starts late, e.g. after the menu had the pixels, it goes on
+// where it would have been.
+void AlarmClock::updateSunrise()
+{
+  if(alarmIsPlaying_ or sunriseRunning() or sunriseMinutes_ == 0)
+  {
+    return;
+  }
+
+  uint32_t until = secondsToAlarm();
+  uint32_t span  = uint32_t(sunriseMinutes_) * 60;
+  if(until == 0 or until > span)
+  {
+    return;
+  }
+
+  // Right after boot the part before it is squeezed in, the sunrise still
+  // ends on the alarm.
+  uint64_t nowUs = time_us_64();
+  uint64_t ahead = uint64_t(span - until) * 1000000;
+  uint64_t start = nowUs > ahead ? nowUs - ahead : 0;
+  uint32_t ms    = uint32_t((nowUs - start) / 1000) + until * 1000;
+
+  for(uint8_t pixel : {PIXEL_LEFT, PIXEL_MIDDLE, PIXEL_RIGHT})
+  {
+    frame_.animations[pixel] = Animation::of(sunrise, start, ms, SUNRISE_STEP_MS);
+  }
+  showBrightness();
+}
+
+void AlarmClock::ring()
+{
+  alarmIsPlaying_ = true;
+  frame_.animations[PIXEL_FRONT] = Animation::of(alarmBlink, time_us_64(), ALARM_BLINK_MS, ALARM_BLINK_STEP_MS, true);
+  timers_.start(alarmOffTimer_, ALARM_OFF_MS);
+  audio_.start();
+}
+
+// The alarm rings again from idleRun once snoozeTimer_ expired; the player
+// is prepared for it like for the alarm itself.
+void AlarmClock::snooze()
+{
+  uint32_t ms = uint32_t(snoozeMinutes_) * 60 * 1000;
+
+  alarmIsPlaying_ = false;
+  snoozing_       = true;
+  snoozes_++;
+  timers_.cancel(alarmOffTimer_);
+  timers_.start(snoozeTimer_, ms);
+  timers_.start(countdownTimer_, 1000, 1000);
+  snoozeEnd_ = make_timeout_time_ms(ms);
+  audio_.stop();
+  audio_.arm(snoozeEnd_);
+
+  setPixel(PIXEL_FRONT, 0, 0, 255);
+  showBrightness();
+  showSnooze();
+}
+
+// Ends the alarm and a snooze chain; the alarm is switched off.
+void AlarmClock::stopAlarm()
+{
+  timers_.cancel(alarmOffTimer_);
+  timers_.cancel(snoozeTimer_);
+  timers_.cancel(countdownTimer_);
+  audio_.stop();
+  alarmIsPlaying_ = false;
+  snoozing_       = false;
+  snoozes_        = 0;
+  alarmOn_.set(false);
+  setPixel(PIXEL_LEFT,   0, 0, 0);
+  setPixel(PIXEL_MIDDLE, 0, 0, 0);
+  setPixel(PIXEL_RIGHT,  0, 0, 0);
+  setPixel(PIXEL_FRONT,  0, 0, 0);
+  showBrightness();
+  showClock();
+}
+
+// Sets the RTC and takes the time over from it.
+void AlarmClock::setTime(const cilo72::ic::SD2405::Time &time)
+{
+  {
+    I2cDma::Claim claim(i2cDma_, HourMinute::RTC_ADDRESS, I2cDma::Priority::Clock);
+    rtc_.setTime(time);
+  }
+  hm_.resync();
+  alarms_.restart();
+}
+
+void AlarmClock::setWeekday(uint32_t weekday)
+{
+  hm_.setWeekday(weekday);
+  alarms_.restart();
+}
+
+int32_t AlarmClock::addAlarm(const Alarms::Alarm &alarm)
+{
+  int32_t index = alarms_.add(alarm);
+  updateRtcAlarm();
+  armAudio();
+  return index;
+}
+
+void AlarmClock::setAlarm(uint32_t index, const Alarms::Alarm &alarm)
+{
+  alarms_.set(index, alarm);
+  updateRtcAlarm();
+  armAudio();
+}
+
+void AlarmClock::removeAlarm(uint32_t index)
+{
+  alarms_.remove(index);
+  updateRtcAlarm();
+  armAudio();
+}
+
+void AlarmClock::setBrightness(uint8_t level, const Ambient::Brightness &brightness)
+{
+  ambient_.setBrightness(level, brightness);
+  showBrightness();
+}
+
+bool AlarmClock::quiet() const
+{
+  if(sm_.state() != uint8_t(StateId::Idle) or alarmIsPlaying_ or snoozing_ or sunriseRunning() or
+     audio_.armed() or audio_.playing())
+  {
+    return false;
+  }
+
+  uint32_t until = secondsToAlarm();
+  return until == 0 or until > QUIET_SECONDS;
+}
+
+// Seconds until the next alarm rings, 0 when it does not ring or the alarm
+// is switched off.
+uint32_t AlarmClock::secondsToAlarm() const
+{
+  if(not alarmOn_.get() or alarms_.next() < 0 or alarms_.alarm(alarms_.next()).is(Alarms::Alarm::SkipNext))
+  {
+    return 0;
+  }
+
+  uint32_t now = hm_.weekday() * SECONDS_PER_DAY + hm_.secondOfDay();
+  return (alarms_.nextFire() * 60 + SECONDS_PER_WEEK - now) % SECONDS_PER_WEEK;
+}
+
+// The player is prepared from the minute before the alarm on, which starts
+// at the next minute rollover then.
+void AlarmClock::armAudio()
+{
+  uint32_t until = secondsToAlarm();
+  if(until > 0 and until <= 60)
+  {
+    audio_.arm(hm_.nextMinute());
+  }
+}
+
+// The sensor driver hands out lux as a double; converting it is the only
+// floating point left on the way to the brightness.
+void AlarmClock::sampleLight()
+{
+  {
+    I2cDma::Claim claim(i2cDma_, LUX_ADDRESS, I2cDma::Priority::Light);
+    lux_.update();
+  }
+  ambient_.sample(static_cast<uint32_t>(lux_));
+  light_.set(ambient_.lux());
+}
+
+// Hysteresis needs a level to hold, the first sample maps directly.
+uint8_t AlarmClock::lightLevel(const uint8_t &last)
+{
+  return ambient_.samples() > 1 ? Ambient::level(light_.get(), last) : Ambient::level(light_.get());
+}
+
+void AlarmClock::alarmOnChanged()
+{
+  setPixel(PIXEL_FRONT, 0, 0, alarmOn_.get() ? 255 : 0);
+  frame_.alarmOn = alarmOn_.get();
+  armAudio();
+}
+
+void AlarmClock::timeChanged()
+{
+  const HourMinute::Time &time = time_.get();
+
+  // A key may have left Idle in the pass that set the time.
+  if(not snoozing_ and sm_.state() == uint8_t(StateId::Idle))
+  {
+    showClock();
+  }
+
+  uint32_t fired = alarms_.tick(Alarms::minuteOfWeek(hm_.weekday(), time.hour(), time.minute()));
+
+  if(fired and alarmOn_.get() and not snoozing_)
+  {
+    ring();
+  }
+  else if(audio_.armed() and time_reached(audio_.at()))
+  {
+    // Its minute passed without it ringing.
+    audio_.disarm();
+  }
+
+  updateRtcAlarm();
+  updateSunrise();
+  armAudio();
+}
+
+// The RTC alarm register mirrors the alarm that rings next and is written
+// only when that one changes.
+void AlarmClock::updateRtcAlarm()
+{
+  if(alarms_.nextChanged() and alarms_.next() >= 0)
+  {
+    I2cDma::Claim claim(i2cDma_, HourMinute::RTC_ADDRESS, I2cDma::Priority::Clock);
+    rtc_.setAlarm(nextAlarm());
+  }
+}
+
+// The next alarm to ring, the first one if none is enabled.
+cilo72::ic::SD2405::Time AlarmClock::nextAlarm() const
+{
+  const Alarms::Alarm &alarm = alarms_.alarm(alarms_.next() >= 0 ? alarms_.next() : 0);
+  return cilo72::ic::SD2405::Time(alarm.hour, alarm.minute, 0);
+}
+
+// One key event and one timer event per pass; with more pending the
+// scheduler does not sleep. Player commands the states issue only queue up,
+// its answers are handled here.
+void AlarmClock::run()
+{
+  if(not keys_.pop(key_) and not injected_.pop(key_))
+  {
+    key_ = KeyEvent();
+  }
+  timers_.advance();
+  if(not timers_.pop(timer_))
+  {
+    timer_ = nullptr;
+  }
+  dfPlayer_.poll();
+  audio_.update();
+  sm_.run();
+  graph_.commit();
+
+  if(frame_ != published_)
+  {
+    frames_.publish(frame_);
+    published_ = frame_;
+  }
+}
+
+absolute_time_t AlarmClock::deadline()
+{
+  if(not injected_.empty() or graph_.pending())
+  {
+    return get_absolute_time();
+  }
+  absolute_time_t deadline = absolute_time_min(sm_.deadline(), timers_.deadline());
+  return absolute_time_min(deadline, absolute_time_min(dfPlayer_.deadline(), audio_.deadline()));
+}
+
+// -----------------------------------------------------------------------------------------
+// IDLE ------------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------------
+void AlarmClock::idleEnter()
+{
+  setPixel(PIXEL_LEFT,   0, 0, 0);
+  setPixel(PIXEL_MIDDLE, 0, 0, 0);
+  setPixel(PIXEL_RIGHT,  0, 0, 0);
+  timers_.cancel(menuTimer_);
+  hm_.update();
+  time_.set(hm_);
+  timeEffect_.schedule();
+  showBrightness();
+  if(snoozing_)
+  {
+    showSnooze();
+  }
+}
+
+StateMachineCommand AlarmClock::idleRun()
+{
+  bool switchOff = false;
+  if(time_reached(hm_.deadline()))
+  {
+    hm_.update();
+    time_.set(hm_);
+  }
+  if(expired(luxTimer_))
+  {
+    sampleLight();
+    timers_.start(luxTimer_, ambient_.intervalMs(), ambient_.intervalMs());
+  }
+
+  // The key is used up by the snooze, Enter does not open the menu.
+  if(alarmIsPlaying_ and snoozes_ < maxSnoozes_ and (pressed(KeyPlus) or pressed(KeyMinus) or pressed(KeyEnter)))
+  {
+    snooze();
+    return StateMachineCommand::nothing();
+  }
+
+  // Missed while a menu was open, it rings as soon as the clock is back.
+  if(snoozing_ and not snoozeTimer_.armed())
+  {
+    snoozing_ = false;
+    timers_.cancel(countdownTimer_);
+    showClock();
+    ring();
+  }
+  else if(snoozing_ and expired(countdownTimer_))
+  {
+    showSnooze();
+  }
+
+  // Once the snoozes are used up the ringing alarm swallows the keys: a
+  // menu over it would take over its audio. The alarm key still ends it.
+  if(pressed(KeyEnter) and not alarmIsPlaying_)
+  {
+    return StateMachineCommand::changeTo(StateId::Menu);
+  }
+
+  if(pressed(KeyAlarm))
+  {
+
+    alarmOn_.set(not alarmOn_.get());
+    if(alarmOn_.get())
+    {
+      return StateMachineCommand::changeTo(StateId::ShowAlarm);
+    }
+    else
+    {
+      switchOff = true;
+    }
+  }
+
+  // The alarm off timer may have expired in a menu, it is through once it
+  // is no longer armed. Switching the alarm off also ends a snooze chain.
+  if((alarmIsPlaying_ and not alarmOffTimer_.armed()) or (switchOff and (alarmIsPlaying_ or snoozing_)))
+  {
+      stopAlarm();
+  }
+  else if(switchOff)
+  {
+      audio_.disarm();
+      if(sunriseRunning())
+      {
+        setPixel(PIXEL_LEFT,   0, 0, 0);
+        setPixel(PIXEL_MIDDLE, 0, 0, 0);
+        setPixel(PIXEL_RIGHT,  0, 0, 0);
+        showBrightness();
+      }
+  }
+
+  return StateMachineCommand::nothing();
+}
+
+// Light samples and the alarm off are timers.
+absolute_time_t AlarmClock::idleDeadline()
+{
+  return hm_.deadline();
+}
+
+// -----------------------------------------------------------------------------------------
+// MENU ------------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------------
+void AlarmClock::menuEnter()
+{
+  setPixel(PIXEL_LEFT,   255, 255, 255);
+  setPixel(PIXEL_MIDDLE, 255, 255, 255);
+  setPixel(PIXEL_RIGHT,  255, 255, 255);
+  showBrightness();
+  timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+
+  menu_.reset();
+  showMenu();
+}
+
+StateMachineCommand AlarmClock::menuRun()
+{
+  if(pressed(KeyEnter))
+  {
+    timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+    switch(menu_.selected().type())
+    {
+      case MenuItem::Type::Command:
+        return menu_.selected().command();
+      case MenuItem::Type::Submenu:
+        menu_.enter();
+        break;
+      case MenuItem::Type::Up:
+        menu_.leave();
+        break;
+    }
+    showMenu();
+  }
+  else if(pressedOrRepeated(KeyMinus))
+  {
+    timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+    menu_.up();
+    showMenu();
+  }
+  else if(pressedOrRepeated(KeyPlus))
+  {
+    timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+    menu_.down();
+    showMenu();
+  }
+
+  if(expired(menuTimer_))
+  {
+    return StateMachineCommand::changeTo(StateId::Idle);
+  }
+  else
+  {
+    return StateMachineCommand::nothing();
+  }
+}
+
+// Shared by all states that leave after MENU_TIMEOUT_MS without a key: they
+// wait for keys and menuTimer_.
+absolute_time_t AlarmClock::menuDeadline()
+{
+  return at_the_end_of_time;
+}
+
+// -----------------------------------------------------------------------------------------
+// TIME ------------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------------
+void AlarmClock::menuTimeEnter()
+{
+  timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+
+  {
+    I2cDma::Claim claim(i2cDma_, HourMinute::RTC_ADDRESS, I2cDma::Priority::Clock);
+    timeSet_.init(rtc_.time());
+  }
+  showTimeSet();
+}
+
+StateMachineCommand AlarmClock::menuTimeRun()
+{
+  bool pressed = false;
+
+  if(timeSet_.run(key_, pressed) == false)
+  {
+    setTime(timeSet_.time());
+    return StateMachineCommand::changeTo(StateId::Idle);
+  }
+
+  if(pressed)
+  {
+    timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+  }
+  showTimeSet();
+
+  if(expired(menuTimer_))
+  {
+     return StateMachineCommand::changeTo(StateId::Idle);
+  }
+  else
+  {
+    return StateMachineCommand::nothing();
+  }
+}
+
+// -----------------------------------------------------------------------------------------
+// ALARM ------------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------------
+void AlarmClock::menuAlarmEnter()
+{
+  timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+
+  // The menu edits the first alarm; without one it starts from the time
+  // and adds a daily alarm.
+  if(alarms_.count() > 0)
+  {
+    const Alarms::Alarm &alarm = alarms_.alarm(0);
+    timeSet_.init(cilo72::ic::SD2405::Time(alarm.hour, alarm.minute, 0));
+  }
+  else
+  {
+    I2cDma::Claim claim(i2cDma_, HourMinute::RTC_ADDRESS, I2cDma::Priority::Clock);
+    timeSet_.init(rtc_.time());
+  }
+  showTimeSet();
+}
+
+StateMachineCommand AlarmClock::menuAlarmRun()
+{
+  bool pressed = false;
+
+  if(timeSet_.run(key_, pressed) == false)
+  {
+    Alarms::Alarm alarm = alarms_.count() > 0 ? alarms_.alarm(0) : Alarms::Alarm{0, 0, Alarms::EVERY_DAY, 0};
+    alarm.hour   = timeSet_.time().hour();
+    alarm.minute = timeSet_.time().minute();
+    alarm.flags |= Alarms::Alarm::Enabled;
+    if(alarms_.count() > 0)
+    {
+      alarms_.set(0, alarm);
+    }
+    else
+    {
+      alarms_.add(alarm);
+    }
+    updateRtcAlarm();
+    return StateMachineCommand::changeTo(StateId::Idle);
+  }
+
+  if(pressed)
+  {
+    timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+  }
+  showTimeSet();
+
+  if(expired(menuTimer_))
+  {
+     return StateMachineCommand::changeTo(StateId::Idle);
+  }
+  else
+  {
+    return StateMachineCommand::nothing();
+  }
+}
+
+// -----------------------------------------------------------------------------------------
+// SHOW ALARM ------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------------
+void AlarmClock::showAlarmEnter()
+{
+  cilo72::ic::SD2405::Time time = nextAlarm();
+  frame_.view   = Frame::View::Clock;
+  frame_.hour   = time.hour();
+  frame_.minute = time.minute();
+}
+
+StateMachineCommand AlarmClock::showAlarmRun()
+{
+  if(keys_.isDown(KeyAlarm))
+  {
+     return StateMachineCommand::nothing();
+  }
+  else
+  {
+    return StateMachineCommand::back();
+  }
+}
+
+absolute_time_t AlarmClock::showAlarmDeadline()
+{
+  return at_the_end_of_time;
+}
+
+// -----------------------------------------------------------------------------------------
+// Volume ------------------------------------------------------------------------------------
+// -----------------------------------------------------------------------------------------
+void AlarmClock::menuVolumenEnter()
+{
+  frame_.view = Frame::View::Volume;
+  audio_.stop();
+  play(dfPlayer_);
+  timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+}
+
+StateMachineCommand AlarmClock::menuVolumenRun()
+{
+  if(expired(menuTimer_))
+  {
+     return StateMachineCommand::changeTo(StateId::Idle);
+  }
+  else if(pressed(KeyEnter))
+  {
+    return StateMachineCommand::changeTo(StateId::Idle);
+  }
+  else if(pressedOrRepeated(KeyMinus))
+  {
+    dfPlayer_.incVolume(-1);
+    timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+  }
+  else if(pressedOrRepeated(KeyPlus))
+  {
+    dfPlayer_.incVolume(1);
+    timers_.start(menuTimer_, MENU_TIMEOUT_MS);
+  }
+
+    return StateMachineCommand::nothing();
+}
+
+void AlarmClock::menuVolumenExit()
+{
+  dfPlayer_.pause();
+}
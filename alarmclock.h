@@ -0,0 +1,227 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "cilo72/ic/sd2405.h"
+#include "cilo72/ic/bh1750fvi.h"
+#include "keys.h"
+#include "frame.h"
+#include "mailbox.h"
+#include "statemachine.h"
+#include "state.h"
+#include "menu.h"
+#include "timeset.h"
+#include "hourminute.h"
+#include "alarms.h"
+#include "ambient.h"
+#include "dfplayer.h"
+#include "alarmaudio.h"
+#include "timerwheel.h"
+#include "signalgraph.h"
+
+class AlarmClock
+{
+public:
+  static constexpr uint8_t SUNRISE_MINUTES     = 20;
+  static constexpr uint8_t MIN_SUNRISE_MINUTES = 10;
+  static constexpr uint8_t MAX_SUNRISE_MINUTES = 30;
+  static constexpr uint8_t SNOOZE_MINUTES      = 9;
+  static constexpr uint8_t MAX_SNOOZE_MINUTES  = 30;
+  static constexpr uint8_t MAX_SNOOZES         = 3;
+  static constexpr uint8_t SNOOZES_LIMIT       = 10;
+  static constexpr uint32_t INJECTED           = 8;
+  static constexpr uint32_t QUIET_SECONDS      = 120;
+
+  // The order of the pins the Keys are built with.
+  enum Key : uint8_t
+  {
+    KeyPlus,
+    KeyMinus,
+    KeyAlarm,
+    KeyEnter
+  };
+
+  // What the clock shows goes to frames, the displays and the pixels are
+  // drawn by the Renderer on the other side of it.
+  AlarmClock(Keys &keys,
+             cilo72::ic::SD2405 &rtc,
+             cilo72::ic::BH1750FVI &lux,
+             I2cDma &i2cDma,
+             Mailbox<Frame> &frames,
+             DfPlayer &dfPlayer);
+
+  void run();
+  absolute_time_t deadline();
+
+  const char *stateName() const { return sm_.name(); }
+  uint8_t states() const { return sm_.size(); }
+  const char *stateName(uint8_t state) const { return sm_.name(state); }
+#if ALARM_CLOCK_PROFILE
+  const Histogram &stateProfile(uint8_t state, StatePhase phase) const { return sm_.profile(state, phase); }
+#endif
+  bool alarmIsPlaying() const { return alarmIsPlaying_; }
+  bool snoozing() const { return snoozing_; }
+
+  // No menu is open and no alarm rings, snoozes, or is due within
+  // QUIET_SECONDS with its sunrise and prewarm. Work that stalls both cores
+  // for a while, such as a flash erase, waits for it.
+  bool quiet() const;
+  const Frame &frame() const { return published_; }
+  const HourMinute &hourMinute() const { return hm_; }
+  const Alarms &alarms() const { return alarms_; }
+  const Ambient &ambient() const { return ambient_; }
+  uint8_t level() const { return level_.get(); }
+  const SignalGraph &graph() const { return graph_; }
+
+  // Prewarm and crescendo of the alarm sound.
+  AlarmAudio &alarmAudio() { return audio_; }
+  const AlarmAudio &alarmAudio() const { return audio_; }
+
+  // How long the pixels light up before an alarm, 0 for not at all.
+  uint8_t sunriseMinutes() const { return sunriseMinutes_; }
+  void setSunriseMinutes(uint8_t minutes);
+
+  // A key other than the alarm key silences a ringing alarm for
+  // snoozeMinutes(), up to maxSnoozes() times in a row.
+  uint8_t snoozeMinutes() const { return snoozeMinutes_; }
+  void setSnoozeMinutes(uint8_t minutes);
+  uint8_t maxSnoozes() const { return maxSnoozes_; }
+  void setMaxSnoozes(uint8_t count);
+  uint8_t snoozes() const { return snoozes_; }
+
+  // How the clock's digits go over to the next minute, carried to core1 in
+  // the frame.
+  Frame::Transition transition() const { return frame_.transition; }
+  void setTransition(Frame::Transition transition) { frame_.transition = transition; }
+
+  // What the menus change, for the serial Shell; takes effect at the next
+  // pass.
+  void setTime(const cilo72::ic::SD2405::Time &time);
+  void setWeekday(uint32_t weekday);
+  bool alarmOn() const { return alarmOn_.get(); }
+  void setAlarmOn(bool on) { alarmOn_.set(on); }
+  int32_t addAlarm(const Alarms::Alarm &alarm);
+  void setAlarm(uint32_t index, const Alarms::Alarm &alarm);
+  void removeAlarm(uint32_t index);
+  void setBrightness(uint8_t level, const Ambient::Brightness &brightness);
+
+  // Handled like an event of the Keys, after those already pending. False
+  // when INJECTED events are waiting already.
+  bool inject(const KeyEvent &event) { return injected_.push(event); }
+
+private:
+  Keys &keys_;
+  cilo72::ic::SD2405 &rtc_;
+  cilo72::ic::BH1750FVI &lux_;
+  I2cDma &i2cDma_;
+  Mailbox<Frame> &frames_;
+  DfPlayer &dfPlayer_;
+  AlarmAudio audio_;
+
+  Frame frame_;      ///< What the clock should show, published after each pass.
+  Frame published_;
+
+  TimerWheel timers_;
+  Timer menuTimer_;      ///< Leaves a menu without a key press.
+  Timer alarmOffTimer_;
+  Timer luxTimer_;
+  Timer snoozeTimer_;
+  Timer countdownTimer_; ///< Each second of a snooze.
+  SpscRing<KeyEvent, INJECTED> injected_;
+  KeyEvent key_;         ///< The key event this pass handles, None if there is none.
+  Timer *timer_;         ///< The timer that expired for this pass, null if none did.
+
+  HourMinute hm_;
+  Alarms alarms_;
+
+  TimeSet timeSet_;
+
+  bool alarmIsPlaying_;
+  uint8_t sunriseMinutes_;
+  bool snoozing_;
+  uint8_t snoozeMinutes_;
+  uint8_t maxSnoozes_;
+  uint8_t snoozes_;              ///< In a row since the alarm first rang.
+  absolute_time_t snoozeEnd_;
+  Ambient ambient_;
+
+  static const MenuItem menuItems_[];
+  Menu menu_;
+
+  // What the displays and the alarm follow; the states only set the
+  // signals, run() commits the graph once per pass.
+  SignalGraph graph_;
+  Signal<bool> alarmOn_;
+  Signal<HourMinute::Time> time_;
+  Signal<uint32_t> light_;       ///< Filtered, in whole lux.
+  Computed<uint8_t, AlarmClock> level_;  ///< Brightness level of light_.
+  Effect<AlarmClock> alarmEffect_;
+  Effect<AlarmClock> timeEffect_;
+  Effect<AlarmClock> brightnessEffect_;
+
+  // Indices into states_, in the same order.
+  enum class StateId : uint8_t
+  {
+    Idle,
+    Menu,
+    MenuTime,
+    MenuAlarm,
+    MenuVolumen,
+    ShowAlarm,
+    Count
+  };
+
+  static const State<AlarmClock> states_[size_t(StateId::Count)];
+  StateMachine<AlarmClock, size_t(StateId::Count)> sm_;
+
+  bool pressed(Key key) const { return key_.is(KeyEvent::Type::Press, key); }
+  bool pressedOrRepeated(Key key) const { return pressed(key) or key_.is(KeyEvent::Type::Repeat, key); }
+  bool expired(const Timer &timer) const { return timer_ == &timer; }
+
+  void showMenu();
+  void showTimeSet();
+  void showClock();
+  void showSnooze();
+  void setPixel(uint8_t index, uint8_t r, uint8_t g, uint8_t b);
+  void showBrightness();
+  bool sunriseRunning() const;
+  void updateSunrise();
+  uint32_t secondsToAlarm() const;
+  void armAudio();
+
+  void ring();
+  void snooze();
+  void stopAlarm();
+
+  void sampleLight();
+  uint8_t lightLevel(const uint8_t &last);
+  void alarmOnChanged();
+  void timeChanged();
+  void updateRtcAlarm();
+  cilo72::ic::SD2405::Time nextAlarm() const;
+
+  void idleEnter();
+  StateMachineCommand idleRun();
+  absolute_time_t idleDeadline();
+
+  void menuEnter();
+  StateMachineCommand menuRun();
+  absolute_time_t menuDeadline();
+
+  void menuTimeEnter();
+  StateMachineCommand menuTimeRun();
+
+  void menuAlarmEnter();
+  StateMachineCommand menuAlarmRun();
+
+  void showAlarmEnter();
+  StateMachineCommand showAlarmRun();
+  absolute_time_t showAlarmDeadline();
+
+  void menuVolumenEnter();
+  StateMachineCommand menuVolumenRun();
+  void menuVolumenExit();
+};
@@ -0,0 +1,202 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "alarms.h"
+
+Alarms::Alarms()
+    : count_(0)
+    , enabled_(0)
+    , started_(false)
+    , from_(0)
+    , shownNext_(-1)
+    , shownFire_(0)
+{
+}
+
+void Alarms::start(uint32_t minuteOfWeek)
+{
+  started_ = true;
+  from_    = minuteOfWeek;
+  enabled_ = 0;
+  for (uint32_t i = 0; i < count_; i++)
+  {
+    if (alarms_[i].is(Alarm::Enabled))
+    {
+      insert(i);
+    }
+  }
+}
+
+int32_t Alarms::add(const Alarm &alarm)
+{
+  if (count_ == CAPACITY)
+  {
+    return -1;
+  }
+
+  alarms_[count_] = alarm;
+  if (alarm.is(Alarm::Enabled))
+  {
+    insert(count_);
+  }
+  return count_++;
+}
+
+void Alarms::set(uint32_t index, const Alarm &alarm)
+{
+  if (index >= count_)
+  {
+    return;
+  }
+
+  unlink(index);
+  alarms_[index] = alarm;
+  if (alarm.is(Alarm::Enabled))
+  {
+    insert(index);
+  }
+}
+
+void Alarms::remove(uint32_t index)
+{
+  if (index >= count_)
+  {
+    return;
+  }
+
+  unlink(index);
+  count_--;
+  for (uint32_t i = index; i < count_; i++)
+  {
+    alarms_[i] = alarms_[i + 1];
+    fire_[i]   = fire_[i + 1];
+  }
+  for (uint32_t i = 0; i < enabled_; i++)
+  {
+    if (order_[i] > index)
+    {
+      order_[i]--;
+    }
+  }
+}
+
+uint32_t Alarms::tick(uint32_t minuteOfWeek)
+{
+  minuteOfWeek %= MINUTES_PER_WEEK;
+  if (not started_)
+  {
+    start(minuteOfWeek);
+  }
+  else if (ahead(minuteOfWeek) >= MINUTES_PER_WEEK - BEHIND_MINUTES)
+  {
+    // The minute of the last tick or one before it, not a week ahead.
+    return 0;
+  }
+
+  uint32_t span  = ahead(minuteOfWeek);
+  uint32_t fired = 0;
+  uint8_t due[CAPACITY];
+  uint32_t dues = 0;
+
+  while (enabled_ > 0 and ahead(fire_[order_[0]]) <= span)
+  {
+    due[dues++] = order_[0];
+    unlink(order_[0]);
+  }
+
+  from_ = (minuteOfWeek + 1) % MINUTES_PER_WEEK;
+
+  for (uint32_t i = 0; i < dues; i++)
+  {
+    Alarm &alarm = alarms_[due[i]];
+    if (alarm.is(Alarm::SkipNext))
+    {
+      alarm.flags &= ~Alarm::SkipNext;
+    }
+    else
+    {
+      fired |= 1u << due[i];
+      if (alarm.is(Alarm::OneShot))
+      {
+        alarm.flags &= ~Alarm::Enabled;
+      }
+    }
+
+    if (alarm.is(Alarm::Enabled))
+    {
+      insert(due[i]);
+    }
+  }
+
+  return fired;
+}
+
+bool Alarms::nextChanged()
+{
+  int32_t index = next();
+  uint32_t fire = index < 0 ? 0 : nextFire() % MINUTES_PER_DAY;
+  if (index == shownNext_ and fire == shownFire_)
+  {
+    return false;
+  }
+
+  shownNext_ = index;
+  shownFire_ = fire;
+  return true;
+}
+
+// Minutes from from_ to minute, 0 for from_ itself.
+uint32_t Alarms::ahead(uint32_t minute) const
+{
+  return (minute + MINUTES_PER_WEEK - from_) % MINUTES_PER_WEEK;
+}
+
+// The first minute at or after `after` the alarm is due.
+uint32_t Alarms::nextFire(const Alarm &alarm, uint32_t after) const
+{
+  uint32_t time     = alarm.hour * 60 + alarm.minute;
+  uint32_t day      = after / MINUTES_PER_DAY;
+  uint8_t weekdays  = alarm.weekdays ? alarm.weekdays : EVERY_DAY;
+
+  for (uint32_t d = time < after % MINUTES_PER_DAY ? 1 : 0; d <= 7; d++)
+  {
+    uint32_t weekday = (day + d) % 7;
+    if (weekdays & (1 << weekday))
+    {
+      return weekday * MINUTES_PER_DAY + time;
+    }
+  }
+  return day * MINUTES_PER_DAY + time;
+}
+
+void Alarms::unlink(uint32_t index)
+{
+  for (uint32_t i = 0; i < enabled_; i++)
+  {
+    if (order_[i] == index)
+    {
+      enabled_--;
+      for (; i < enabled_; i++)
+      {
+        order_[i] = order_[i + 1];
+      }
+      return;
+    }
+  }
+}
+
+void Alarms::insert(uint32_t index)
+{
+  fire_[index]   = nextFire(alarms_[index], from_);
+  uint32_t key   = ahead(fire_[index]);
+  uint32_t i     = enabled_;
+  while (i > 0 and ahead(fire_[order_[i - 1]]) > key)
+  {
+    order_[i] = order_[i - 1];
+    i--;
+  }
+  order_[i] = index;
+  enabled_++;
+}
@@ -0,0 +1,92 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// A fixed set of alarms, each with a time of day, the weekdays it rings on
+// and one-shot / skip-next flags. Times are minutes of the week, 0 being
+// Monday 00:00. The enabled alarms are kept ordered by their next fire time
+// as seen from the last tick, so a tick only compares against the first one
+// and an alarm is re-sorted only after it fired or was changed.
+class Alarms
+{
+public:
+  static constexpr uint32_t CAPACITY         = 8;
+  static constexpr uint32_t MINUTES_PER_DAY  = 24 * 60;
+  static constexpr uint32_t MINUTES_PER_WEEK = 7 * MINUTES_PER_DAY;
+  static constexpr uint8_t EVERY_DAY         = 0x7F;
+  static constexpr uint32_t BEHIND_MINUTES   = 5;
+
+  struct Alarm
+  {
+    enum Flags : uint8_t
+    {
+      Enabled  = 0x01,
+      OneShot  = 0x02,   ///< Disables itself after ringing.
+      SkipNext = 0x04,   ///< The next due time passes silently, then clears.
+    };
+
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t weekdays;    ///< Bit 0 Monday ... bit 6 Sunday, 0 for any day.
+    uint8_t flags;
+
+    bool is(Flags flag) const { return flags & flag; }
+  };
+
+  Alarms();
+
+  // Forgets the last tick, e.g. after the clock was set: the next tick()
+  // only starts counting, alarms due at exactly its minute still fire.
+  void restart() { started_ = false; }
+
+  uint32_t count() const { return count_; }
+  const Alarm &alarm(uint32_t index) const { return alarms_[index]; }
+
+  // Returns the index of the new alarm, -1 when all slots are taken.
+  int32_t add(const Alarm &alarm);
+  // An index past count() is ignored.
+  void set(uint32_t index, const Alarm &alarm);
+  void remove(uint32_t index);
+
+  // Advances to minuteOfWeek and returns a bit per alarm that came due since
+  // the last tick. Ticks may skip minutes, no alarm in between gets lost.
+  // The last BEHIND_MINUTES minutes up to the one ticked last, e.g. after
+  // the clock was pulled back to the RTC, were handled already: nothing
+  // fires and the count goes on from where it was.
+  uint32_t tick(uint32_t minuteOfWeek);
+
+  // The alarm that rings next, -1 when none is enabled.
+  int32_t next() const { return enabled_ ? order_[0] : -1; }
+  uint32_t nextFire() const { return fire_[order_[0]]; }
+
+  // Whether next() or its time of day changed since the last call, for
+  // callers that mirror the next alarm into the daily RTC alarm register.
+  bool nextChanged();
+
+  static uint32_t minuteOfWeek(uint32_t weekday, uint32_t hour, uint32_t minute)
+  {
+    return (weekday * 24 + hour) * 60 + minute;
+  }
+
+private:
+  Alarm alarms_[CAPACITY];
+  uint16_t fire_[CAPACITY];    ///< Next minute of week the alarm is due.
+  uint8_t order_[CAPACITY];    ///< Enabled alarms by fire_, soonest first.
+  uint32_t count_;
+  uint32_t enabled_;
+  bool started_;
+  uint32_t from_;              ///< First minute not yet ticked over.
+  int32_t shownNext_;
+  uint32_t shownFire_;         ///< Minute of day of shownNext_.
+
+  uint32_t ahead(uint32_t minute) const;
+  uint32_t nextFire(const Alarm &alarm, uint32_t after) const;
+  void start(uint32_t minuteOfWeek);
+  void unlink(uint32_t index);
+  void insert(uint32_t index);
+};
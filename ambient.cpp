@@ -0,0 +1,124 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "ambient.h"
+
+struct Band
+{
+  uint8_t lux;    ///< Highest light of the level.
+  Ambient::Brightness brightness;
+};
+
+static constexpr Band bands[Ambient::LEVELS] = {
+{  0, {  0,  5}},
+{  2, {  2,  5}},
+{  3, {  3,  5}},
+{  4, {  4,  5}},
+{  6, {  6,  5}},
+{  8, {  8,  5}},
+{ 11, { 11,  6}},
+{ 16, { 16,  7}},
+{ 23, { 23,  8}},
+{ 32, { 32,  9}},
+{ 45, { 45, 10}},
+{ 64, { 64, 11}},
+{ 90, { 90, 12}},
+{128, {128, 13}},
+{181, {181, 14}},
+{255, {255, 15}}};
+
+struct LevelTable
+{
+  uint8_t level[256];
+};
+
+// The level of every lux value up to 255, brighter light is the last level.
+static constexpr LevelTable makeLevelTable()
+{
+  LevelTable table = {};
+  uint32_t level   = 0;
+  for (uint32_t lux = 0; lux < 256; lux++)
+  {
+    while (lux > bands[level].lux)
+    {
+      level++;
+    }
+    table.level[lux] = level;
+  }
+  return table;
+}
+
+static constexpr LevelTable levels = makeLevelTable();
+
+static uint8_t levelOf(uint32_t lux)
+{
+  return levels.level[lux < 255 ? lux : 255];
+}
+
+Ambient::Ambient()
+    : filtered_(0)
+    , intervalMs_(MIN_INTERVAL_MS)
+    , samples_(0)
+{
+  for (uint32_t level = 0; level < LEVELS; level++)
+  {
+    curve_[level] = bands[level].brightness;
+  }
+}
+
+void Ambient::setBrightness(uint8_t level, const Brightness &brightness)
+{
+  curve_[level].oled  = brightness.oled;
+  curve_[level].pixel = brightness.pixel < 15 ? brightness.pixel : 15;
+}
+
+void Ambient::sample(uint32_t lux)
+{
+  uint32_t reading = lux << FRACTION_BITS;
+
+  if (samples_++ == 0)
+  {
+    filtered_ = reading;
+    return;
+  }
+
+  // A reading off the average by more than an eighth, or by 2 lux in the
+  // dark, means the light is moving: read fast until it settles.
+  uint32_t deviation = reading > filtered_ ? reading - filtered_ : filtered_ - reading;
+  if (deviation > filtered_ / 8 + (2 << FRACTION_BITS))
+  {
+    intervalMs_ = MIN_INTERVAL_MS;
+  }
+  else if (intervalMs_ < MAX_INTERVAL_MS)
+  {
+    intervalMs_ *= 2;
+  }
+
+  // Rounded up so the average does reach the reading.
+  uint32_t step = (deviation + (1 << EMA_SHIFT) - 1) >> EMA_SHIFT;
+  filtered_     = reading > filtered_ ? filtered_ + step : filtered_ - step;
+}
+
+uint8_t Ambient::level(uint32_t lux)
+{
+  return levelOf(lux);
+}
+
+// The level moves only when the light is an eighth past the band edge.
+uint8_t Ambient::level(uint32_t lux, uint8_t last)
+{
+  uint32_t margin = lux / 8 + 1;
+  uint8_t up      = levelOf(lux > margin ? lux - margin : 0);
+  uint8_t down    = levelOf(lux + margin);
+  if (up > last)
+  {
+    return up;
+  }
+  if (down < last)
+  {
+    return down;
+  }
+  return last;
+}
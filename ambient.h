@@ -0,0 +1,59 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Turns light sensor readings into one of LEVELS brightness levels for the
+// displays and the pixels, in integers only: the RP2040 has no FPU. The
+// readings go through an exponential moving average and the sampling
+// interval stretches while the light is stable and drops back when it moves.
+// level() maps the filtered light to a level, which changes only once the
+// light is clear of the band edge; the clock derives it in its SignalGraph.
+class Ambient
+{
+public:
+  static constexpr uint32_t LEVELS          = 16;
+  static constexpr uint32_t MIN_INTERVAL_MS = 250;    ///< A high resolution BH1750 reading takes up to 180 ms.
+  static constexpr uint32_t MAX_INTERVAL_MS = 8000;
+
+  struct Brightness
+  {
+    uint8_t oled;     ///< Panel contrast.
+    uint8_t pixel;    ///< WS2812 brightness, 0 ... 15.
+  };
+
+  Ambient();
+
+  // Feeds one reading in whole lux.
+  void sample(uint32_t lux);
+
+  // The level for lux coming from last, and without one to come from.
+  static uint8_t level(uint32_t lux, uint8_t last);
+  static uint8_t level(uint32_t lux);
+
+  // What a level drives the panels and the pixels with; starts out as the
+  // built-in curve and can be reshaped per level.
+  const Brightness &brightness(uint8_t level) const { return curve_[level]; }
+  void setBrightness(uint8_t level, const Brightness &brightness);
+
+  // When the next reading is due, after the one just taken.
+  uint32_t intervalMs() const { return intervalMs_; }
+
+  // The filtered light in whole lux.
+  uint32_t lux() const { return (filtered_ + HALF) >> FRACTION_BITS; }
+  uint32_t samples() const { return samples_; }
+
+private:
+  static constexpr uint32_t FRACTION_BITS = 4;
+  static constexpr uint32_t HALF          = 1 << (FRACTION_BITS - 1);
+  static constexpr uint32_t EMA_SHIFT     = 2;    ///< Each reading weighs 1/4.
+
+  uint32_t filtered_;     ///< Average of the readings in 1/16 lux.
+  uint32_t intervalMs_;
+  uint32_t samples_;
+  Brightness curve_[LEVELS];
+};
@@ -0,0 +1,104 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "animation.h"
+
+static constexpr double root(double x)
+{
+  double r = x > 1.0 ? x : 1.0;
+  for (uint32_t i = 0; i < 64; i++)
+  {
+    r = (r + x / r) / 2;
+  }
+  return r;
+}
+
+struct GammaTable
+{
+  uint8_t value[256];
+};
+
+// Gamma 2.25, x^2 * x^(1/4): close to the usual 2.2 and built from square
+// roots only, which a constant expression can do.
+static constexpr GammaTable makeGammaTable()
+{
+  GammaTable table = {};
+  for (uint32_t i = 0; i < 256; i++)
+  {
+    double x       = i / 255.0;
+    table.value[i] = uint8_t(x * x * root(root(x)) * 255.0 + 0.5);
+  }
+  return table;
+}
+
+static constexpr GammaTable gamma = makeGammaTable();
+
+static_assert(gamma.value[0] == 0 and gamma.value[255] == 255, "gamma must keep black and full");
+
+// Interpolates one channel in 8.8 fixed point, weight 0 ... 256.
+static uint8_t mix(uint8_t from, uint8_t to, int32_t weight)
+{
+  int32_t value = (int32_t(from) << 8) + (int32_t(to) - int32_t(from)) * weight;
+  return gamma.value[(value + 128) >> 8];
+}
+
+Rgb Animation::at(uint64_t us) const
+{
+  uint64_t durationUs = uint64_t(durationMs) * 1000;
+  uint64_t stepUs     = uint64_t(stepMs) * 1000;
+
+  if (us <= startUs or count < 2 or durationUs == 0)
+  {
+    return {gamma.value[keys[0].colour.r], gamma.value[keys[0].colour.g], gamma.value[keys[0].colour.b]};
+  }
+
+  uint64_t elapsed = us - startUs;
+  if (stepUs > 0)
+  {
+    elapsed -= elapsed % stepUs;
+  }
+  if (loop)
+  {
+    elapsed %= durationUs;
+  }
+  else if (elapsed >= durationUs)
+  {
+    elapsed = durationUs;
+  }
+
+  // Position in 1/256 permille.
+  uint32_t position = uint32_t(elapsed * 256000 / durationUs);
+
+  uint32_t i = 1;
+  while (i < uint32_t(count) - 1 and position > uint32_t(keys[i].at) * 256)
+  {
+    i++;
+  }
+
+  const Keyframe &a = keys[i - 1];
+  const Keyframe &b = keys[i];
+  int32_t span      = b.at - a.at;
+  int32_t weight    = span > 0 ? int32_t(position - uint32_t(a.at) * 256) / span : 256;
+  weight            = weight < 0 ? 0 : weight > 256 ? 256 : weight;
+
+  return {mix(a.colour.r, b.colour.r, weight), mix(a.colour.g, b.colour.g, weight), mix(a.colour.b, b.colour.b, weight)};
+}
+
+absolute_time_t Animation::nextStep(uint64_t us) const
+{
+  uint64_t stepUs = uint64_t(stepMs ? stepMs : 1) * 1000;
+
+  if (us < startUs)
+  {
+    return from_us_since_boot(startUs);
+  }
+
+  uint64_t next = startUs + ((us - startUs) / stepUs + 1) * stepUs;
+  if (not loop and next > startUs + uint64_t(durationMs) * 1000 + stepUs)
+  {
+    return at_the_end_of_time;
+  }
+  return from_us_since_boot(next);
+}
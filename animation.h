@@ -0,0 +1,71 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "pico/time.h"
+#include <stddef.h>
+#include <stdint.h>
+
+struct Rgb
+{
+  uint8_t r = 0;
+  uint8_t g = 0;
+  uint8_t b = 0;
+
+  bool operator==(const Rgb &rhs) const { return r == rhs.r and g == rhs.g and b == rhs.b; }
+  bool operator!=(const Rgb &rhs) const { return not operator==(rhs); }
+};
+
+struct Keyframe
+{
+  uint16_t at;    ///< Permille of the animation, 0 ... 1000.
+  Rgb colour;     ///< As perceived, gamma is applied on output.
+};
+
+// A pixel colour running through a constant table of keyframes over a time
+// span, once or looped. Colours are interpolated in fixed point between the
+// keyframes and go through a gamma table, so equal steps in the table look
+// like equal steps on the LED. Output moves in whole steps of stepMs from
+// the start; one animation is a few words of plain data and can be copied
+// through the frame mailbox.
+struct Animation
+{
+  const Keyframe *keys = nullptr;   ///< First key at 0, last one at 1000.
+  uint8_t count        = 0;
+  bool loop            = false;
+  uint16_t stepMs      = 0;
+  uint64_t startUs     = 0;
+  uint32_t durationMs  = 0;
+
+  template <size_t N>
+  static Animation of(const Keyframe (&keys)[N], uint64_t startUs, uint32_t durationMs, uint16_t stepMs, bool loop = false)
+  {
+    Animation animation;
+    animation.keys       = keys;
+    animation.count      = N;
+    animation.loop       = loop;
+    animation.stepMs     = stepMs;
+    animation.startUs    = startUs;
+    animation.durationMs = durationMs;
+    return animation;
+  }
+
+  bool active() const { return keys != nullptr; }
+
+  // The colour at the step that contains us, gamma corrected. Before the
+  // start it is the first key, after the end of a one-shot the last one.
+  Rgb at(uint64_t us) const;
+
+  // The first step after us, at_the_end_of_time once a one-shot is through.
+  absolute_time_t nextStep(uint64_t us) const;
+
+  bool operator==(const Animation &rhs) const
+  {
+    return keys == rhs.keys and count == rhs.count and loop == rhs.loop and stepMs == rhs.stepMs and
+           startUs == rhs.startUs and durationMs == rhs.durationMs;
+  }
+  bool operator!=(const Animation &rhs) const { return not operator==(rhs); }
+};
@@ -0,0 +1,464 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "compositor.h"
+#include <string.h>
+
+Layer::Layer()
+    : visible_(true)
+{
+  memset(ink_, 0, sizeof(ink_));
+  memset(cover_, 0, sizeof(cover_));
+  for (uint32_t panel = 0; panel < PANELS; panel++)
+  {
+    repaired(panel);
+  }
+}
+
+void Layer::clear()
+{
+  clear(0, 0, WIDTH, HEIGHT);
+}
+
+void Layer::clear(int32_t x, int32_t y, uint32_t width, uint32_t height)
+{
+  fill(x, y, width, height, Color::Black, false);
+}
+
+void Layer::setPixel(int32_t x, int32_t y, Color color)
+{
+  drawSquare(x, y, 1, 1, color);
+}
+
+void Layer::drawSquare(int32_t x, int32_t y, uint32_t width, uint32_t height, Color color)
+{
+  fill(x, y, width, height, color, true);
+}
+
+// Reads the runs of compressed Glyphs, a run continues with the next read.
+class RunDecoder
+{
+public:
+  RunDecoder(const uint8_t *data) : data_(data), left_(0), repeat_(false) {}
+
+  void read(uint8_t *out, uint32_t count)
+  {
+    while (count > 0)
+    {
+      if (left_ == 0)
+      {
+        uint8_t code = *data_++;
+        repeat_      = code >= Glyphs::REPEAT;
+        left_        = repeat_ ? code - Glyphs::REPEAT + 1 : code + 1;
+      }
+
+      uint32_t length = left_ < count ? left_ : count;
+      if (repeat_)
+      {
+        memset(out, *data_, length);
+      }
+      else
+      {
+        memcpy(out, data_, length);
+        data_ += length;
+      }
+      out += length;
+      count -= length;
+      left_ -= length;
+      if (repeat_ and left_ == 0)
+      {
+        data_++;
+      }
+    }
+  }
+
+private:
+  const uint8_t *data_;
+  uint32_t left_;
+  bool repeat_;
+};
+
+void Layer::drawString(int32_t x, int32_t y, uint32_t scale, const char *s, Color color, const Font &font)
+{
+  const Glyphs *scaled = font.scaled(scale);
+  for (; *s; s++)
+  {
+    const uint8_t *prepared = scaled ? scaled->glyph(*s) : nullptr;
+    if (prepared)
+    {
+      blit(x, y, *scaled, prepared, color);
+      x += (font.width() + 1) * scale;
+      continue;
+    }
+
+    const uint8_t *glyph = font.glyph(*s);
+    for (uint32_t column = 0; column < font.width(); column++)
+    {
+      for (uint32_t bit = 0; bit < font.height(); bit++)
+      {
+        if (glyph[column] & (1 << bit))
+        {
+          drawSquare(x + column * scale, y + bit * scale, scale, scale, color);
+        }
+      }
+    }
+    x += (font.width() + 1) * scale;
+  }
+}
+
+void Layer::drawString(int32_t x, int32_t y, const Glyphs &glyphs, const char *s, Color color, uint32_t pattern)
+{
+  for (; *s; s++)
+  {
+    const uint8_t *glyph = glyphs.glyph(*s);
+    if (glyph)
+    {
+      blit(x, y, glyphs, glyph, color, pattern);
+    }
+    x += glyphs.advance();
+  }
+}
+
+// A 4x4 Bayer matrix: the pixels come on spread out evenly, whatever the level.
+uint32_t Layer::dither(uint32_t level)
+{
+  static constexpr uint8_t BAYER[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+  uint32_t pattern = 0;
+  for (uint32_t column = 0; column < 4; column++)
+  {
+    for (uint32_t row = 0; row < 8; row++)
+    {
+      if (BAYER[row % 4][column] < level)
+      {
+        pattern |= 1u << (column * 8 + row);
+      }
+    }
+  }
+  return pattern;
+}
+
+bool Layer::pixel(int32_t x, int32_t y) const
+{
+  return x >= 0 and x < int32_t(WIDTH) and y >= 0 and y < int32_t(HEIGHT) and ink_[y / 8][x] & (1 << (y % 8));
+}
+
+bool Layer::covers(int32_t x, int32_t y) const
+{
+  return x >= 0 and x < int32_t(WIDTH) and y >= 0 and y < int32_t(HEIGHT) and cover_[y / 8][x] & (1 << (y % 8));
+}
+
+// Everything the layer covers changes, a panel it leaves alone does not.
+void Layer::setVisible(bool visible)
+{
+  if (visible != visible_)
+  {
+    visible_ = visible;
+    for (uint32_t page = 0; page < PAGES; page++)
+    {
+      for (uint32_t column = 0; column < WIDTH; column++)
+      {
+        if (cover_[page][column])
+        {
+          damage(page, column);
+        }
+      }
+    }
+  }
+}
+
+// Clipped to the canvas; a transparent fill uncovers the area.
+void Layer::fill(int32_t x, int32_t y, uint32_t width, uint32_t height, Color color, bool opaque)
+{
+  int32_t x0 = x < 0 ? 0 : x;
+  int32_t y0 = y < 0 ? 0 : y;
+  int32_t x1 = x + int32_t(width) > int32_t(WIDTH) ? WIDTH : x + width;
+  int32_t y1 = y + int32_t(height) > int32_t(HEIGHT) ? HEIGHT : y + height;
+
+  for (int32_t row = y0; row < y1;)
+  {
+    uint32_t page   = row / 8;
+    int32_t end     = (int32_t(page) + 1) * 8 < y1 ? (page + 1) * 8 : y1;
+    uint8_t mask    = uint8_t((0xFF << (row % 8)) & (0xFF >> (8 - (end - int32_t(page) * 8))));
+
+    uint8_t inkSet    = color == Color::White and opaque ? mask : 0;
+    uint8_t coverSet  = opaque ? mask : 0;
+    int32_t first     = WIDTH;
+    int32_t last      = -1;
+    for (int32_t column = x0; column < x1; column++)
+    {
+      uint8_t ink   = (ink_[page][column] & ~mask) | inkSet;
+      uint8_t cover = (cover_[page][column] & ~mask) | coverSet;
+      if (ink != ink_[page][column] or cover != cover_[page][column])
+      {
+        ink_[page][column]   = ink;
+        cover_[page][column] = cover;
+        first                = column < first ? column : first;
+        last                 = column;
+      }
+    }
+    if (first <= last)
+    {
+      damage(page, first, last);
+    }
+    row = end;
+  }
+}
+
+// Up to four bytes as one little-endian word, the byte order of the RP2040.
+static inline uint32_t load(const uint8_t *bytes, uint32_t count)
+{
+  uint32_t word = 0;
+  if (count == 4)
+  {
+    memcpy(&word, bytes, 4);
+  }
+  else
+  {
+    memcpy(&word, bytes, count);
+  }
+  return word;
+}
+
+static inline void store(uint8_t *bytes, uint32_t count, uint32_t word)
+{
+  if (count == 4)
+  {
+    memcpy(bytes, &word, 4);
+  }
+  else
+  {
+    memcpy(bytes, &word, count);
+  }
+}
+
+// Draws the set pixels of the glyph as drawString() does, a page row at a
+// time and four columns per step: off a page boundary each row of the canvas
+// takes the lower part of one glyph page and the upper part of the one
+// above, shifted within the bytes of a word, and the pattern masks it. Steps
+// without a set pixel are skipped. Compressed glyphs are decoded into the
+// row buffers as they go.
+void Layer::blit(int32_t x, int32_t y, const Glyphs &glyphs, const uint8_t *glyph, Color color, uint32_t pattern)
+{
+  static constexpr uint8_t NONE[Oled::WIDTH] = {};
+
+  uint32_t width = glyphs.width();
+  int32_t top    = y >= 0 ? y / 8 : -((7 - y) / 8);
+  uint32_t shift = y - top * 8;
+  uint32_t low   = (0xFFu << shift & 0xFF) * 0x01010101u;   ///< The bits a page keeps of its own row.
+  int32_t x0     = x < 0 ? -x : 0;
+  int32_t x1     = x + int32_t(width) > int32_t(WIDTH) ? int32_t(WIDTH) - x : width;
+
+  // The steps start at the same column modulo 4.
+  uint32_t rotate = (x + x0) % 4 * 8;
+  uint32_t mask   = rotate ? (pattern >> rotate) | (pattern << (32 - rotate)) : pattern;
+
+  RunDecoder decoder(glyph);
+  uint8_t buffers[2][Oled::WIDTH];
+  const uint8_t *above = NONE;
+  uint32_t rows        = glyphs.pages() + (shift ? 1 : 0);
+
+  for (uint32_t row = 0; row < rows; row++)
+  {
+    const uint8_t *current = buffers[row % 2];
+    if (row == glyphs.pages())
+    {
+      current = NONE;
+    }
+    else if (glyphs.compressed())
+    {
+      decoder.read(buffers[row % 2], width);
+    }
+    else
+    {
+      current = glyph + row * width;
+    }
+
+    int32_t page = top + int32_t(row);
+    if (page >= 0 and page < int32_t(PAGES))
+    {
+      uint8_t *ink   = &ink_[page][0];
+      uint8_t *cover = &cover_[page][0];
+      int32_t first  = WIDTH;
+      int32_t last   = -1;
+      for (int32_t column = x0; column < x1; column += 4)
+      {
+        uint32_t count = x1 - column < 4 ? x1 - column : 4;
+        uint32_t bits  = (((load(&current[column], count) << shift) & low) | ((load(&above[column], count) >> (8 - shift)) & ~low)) & mask;
+        if (bits == 0)
+        {
+          continue;
+        }
+
+        uint32_t oldInk   = load(&ink[x + column], count);
+        uint32_t oldCover = load(&cover[x + column], count);
+        uint32_t newInk   = color == Color::White ? oldInk | bits : oldInk & ~bits;
+        uint32_t changed  = (newInk ^ oldInk) | ((oldCover | bits) ^ oldCover);
+        if (changed)
+        {
+          store(&ink[x + column], count, newInk);
+          store(&cover[x + column], count, oldCover | bits);
+          int32_t from = column + __builtin_ctz(changed) / 8;
+          first        = from < first ? from : first;
+          last         = column + (31 - __builtin_clz(changed)) / 8;
+        }
+      }
+      if (first <= last)
+      {
+        damage(page, x + first, x + last);
+      }
+    }
+    above = current;
+  }
+}
+
+void Layer::damage(uint32_t page, uint32_t column)
+{
+  uint32_t panel = column / Oled::WIDTH;
+  uint8_t x      = uint8_t(column % Oled::WIDTH);
+  if (x < damageFirst_[panel][page])
+  {
+    damageFirst_[panel][page] = x;
+  }
+  if (x > damageLast_[panel][page])
+  {
+    damageLast_[panel][page] = x;
+  }
+}
+
+// A range across the seam damages both panels.
+void Layer::damage(uint32_t page, uint32_t first, uint32_t last)
+{
+  for (uint32_t column = first; column <= last; column = (column / Oled::WIDTH + 1) * Oled::WIDTH)
+  {
+    uint32_t end = (column / Oled::WIDTH + 1) * Oled::WIDTH - 1;
+    damage(page, column);
+    damage(page, end < last ? end : last);
+  }
+}
+
+void Layer::repaired(uint32_t panel)
+{
+  for (uint32_t page = 0; page < PAGES; page++)
+  {
+    damageFirst_[panel][page] = Oled::WIDTH - 1;
+    damageLast_[panel][page]  = 0;
+  }
+}
+
+Compositor::Compositor(Oled &left, Oled &right)
+    : panels_{&left, &right}
+    , nextFrame_{}
+    , commits_{}
+{
+  setFrameRate(FRAME_RATE);
+}
+
+void Compositor::setFrameRate(uint32_t fps)
+{
+  frameRate_ = fps;
+  frameUs_   = fps > 0 ? 1000000 / fps : 0;
+}
+
+bool Compositor::damaged() const
+{
+  for (uint32_t panel = 0; panel < PANELS; panel++)
+  {
+    if (damaged(panel))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Compositor::damaged(uint32_t panel) const
+{
+  for (const Layer &layer : layers_)
+  {
+    for (uint32_t page = 0; page < Layer::PAGES; page++)
+    {
+      if (layer.damageFirst_[panel][page] <= layer.damageLast_[panel][page])
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool Compositor::commit()
+{
+  uint64_t now   = time_us_64();
+  bool committed = false;
+  for (uint32_t panel = 0; panel < PANELS; panel++)
+  {
+    if (commit(panel, now))
+    {
+      committed = true;
+    }
+  }
+  return committed;
+}
+
+bool Compositor::commit(uint32_t panel, uint64_t now)
+{
+  Oled &oled = *panels_[panel];
+  if (now < nextFrame_[panel] or oled.busy() or not damaged(panel))
+  {
+    return false;
+  }
+
+  uint32_t offset = panel * Oled::WIDTH;
+  for (uint32_t page = 0; page < Layer::PAGES; page++)
+  {
+    uint32_t first = Oled::WIDTH - 1;
+    uint32_t last  = 0;
+    for (const Layer &layer : layers_)
+    {
+      first = layer.damageFirst_[panel][page] < first ? layer.damageFirst_[panel][page] : first;
+      last  = layer.damageLast_[panel][page] > last ? layer.damageLast_[panel][page] : last;
+    }
+
+    for (uint32_t column = first; column <= last; column++)
+    {
+      // Black where no layer covers the canvas.
+      uint8_t value = 0;
+      for (const Layer &layer : layers_)
+      {
+        if (layer.visible_)
+        {
+          uint8_t cover = layer.cover_[page][offset + column];
+          value         = (value & ~cover) | (layer.ink_[page][offset + column] & cover);
+        }
+      }
+      oled.write(page, column, value);
+    }
+  }
+
+  for (Layer &layer : layers_)
+  {
+    layer.repaired(panel);
+  }
+
+  oled.flushAsync();
+  nextFrame_[panel] = now + frameUs_;
+  commits_[panel]++;
+  return true;
+}
+
+// The soonest of the damaged panels that are free.
+absolute_time_t Compositor::deadline() const
+{
+  uint64_t deadline = UINT64_MAX;
+  for (uint32_t panel = 0; panel < PANELS; panel++)
+  {
+    if (not panels_[panel]->busy() and damaged(panel) and nextFrame_[panel] < deadline)
+    {
+      deadline = nextFrame_[panel];
+    }
+  }
+  return deadline == UINT64_MAX ? at_the_end_of_time : from_us_since_boot(deadline);
+}
@@ -0,0 +1,128 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "oled.h"
+#include "font.h"
+#include "pico/time.h"
+#include <stdint.h>
+
+// One bitmap of a Compositor, the size of the whole canvas in the panels'
+// page layout. Besides the ink it keeps where it covers the layers below: a
+// cleared area is transparent, drawing in either colour makes the pixels
+// opaque. Drawing records the damaged columns per page, the compositor
+// recomposes only those.
+class Layer
+{
+public:
+  enum class Color
+  {
+    Black,
+    White
+  };
+
+  static constexpr uint32_t PANELS = 2;
+  static constexpr uint32_t WIDTH  = PANELS * Oled::WIDTH;
+  static constexpr uint32_t HEIGHT = Oled::HEIGHT;
+  static constexpr uint32_t PAGES  = Oled::PAGES;
+
+  // A mask byte per column for columns 0 to 3 modulo 4, repeating across the
+  // canvas.
+  static constexpr uint32_t SOLID = 0xFFFFFFFF;
+  static constexpr uint32_t DITHER_LEVELS = 16;
+
+  Layer();
+  Layer(const Layer &) = delete;
+  Layer &operator=(const Layer &) = delete;
+
+  uint32_t width() const { return WIDTH; }
+  uint32_t height() const { return HEIGHT; }
+
+  void clear();
+  void clear(int32_t x, int32_t y, uint32_t width, uint32_t height);
+  void setPixel(int32_t x, int32_t y, Color color = Color::White);
+  void drawSquare(int32_t x, int32_t y, uint32_t width, uint32_t height, Color color = Color::White);
+  void drawString(int32_t x, int32_t y, uint32_t scale, const char *s, Color color = Color::White, const Font &font = font8x5);
+  // Characters without a glyph leave a gap. Only the pixels in pattern are
+  // drawn.
+  void drawString(int32_t x, int32_t y, const Glyphs &glyphs, const char *s, Color color = Color::White,
+                  uint32_t pattern = SOLID);
+
+  // level of DITHER_LEVELS pixels in an ordered dither, ~dither(level) holds
+  // the others.
+  static uint32_t dither(uint32_t level);
+
+  bool pixel(int32_t x, int32_t y) const;
+  bool covers(int32_t x, int32_t y) const;
+
+  // A hidden layer keeps its bitmap and shows it again when made visible.
+  bool visible() const { return visible_; }
+  void setVisible(bool visible);
+
+private:
+  friend class Compositor;
+
+  uint8_t ink_[PAGES][WIDTH];
+  uint8_t cover_[PAGES][WIDTH];
+  uint8_t damageFirst_[PANELS][PAGES];    ///< Damaged columns per panel and page, first > last if clean.
+  uint8_t damageLast_[PANELS][PAGES];
+  bool visible_;
+
+  void fill(int32_t x, int32_t y, uint32_t width, uint32_t height, Color color, bool opaque);
+  void blit(int32_t x, int32_t y, const Glyphs &glyphs, const uint8_t *glyph, Color color, uint32_t pattern = SOLID);
+  void damage(uint32_t page, uint32_t column);
+  void damage(uint32_t page, uint32_t first, uint32_t last);
+  void repaired(uint32_t panel);
+};
+
+// The LAYERS of a 256x64 canvas, bottom to top, shown on PANELS panels side
+// by side: the left one shows columns 0 to 127, the right one 128 to 255.
+// Anything drawn across the seam is split between them. commit() composes
+// the damaged columns of all layers into the framebuffer of the panel they
+// fall on and starts a flush of that panel, which sends only the bytes that
+// came out different. A panel is committed only when its half changed, at
+// most once per frame of the frame rate and not while it is busy, so
+// drawing several layers for one frame costs one transfer per panel.
+class Compositor
+{
+public:
+  static constexpr uint32_t LAYERS     = 2;
+  static constexpr uint32_t PANELS     = Layer::PANELS;
+  static constexpr uint32_t WIDTH      = Layer::WIDTH;
+  static constexpr uint32_t FRAME_RATE = 50;
+
+  Compositor(Oled &left, Oled &right);
+
+  Layer &layer(uint32_t z) { return layers_[z]; }
+  Oled &panel(uint32_t index) { return *panels_[index]; }
+
+  // Frames per second at most, 0 for no cap.
+  uint32_t frameRate() const { return frameRate_; }
+  void setFrameRate(uint32_t fps);
+
+  bool damaged() const;
+  bool damaged(uint32_t panel) const;
+
+  // False when no panel was committed: nothing changed or the changed ones
+  // have to wait for their transfer or the next frame.
+  bool commit();
+
+  // When a damaged panel may be committed, at_the_end_of_time if there is
+  // nothing to commit. A busy panel wakes the caller when it is through.
+  absolute_time_t deadline() const;
+
+  uint32_t commits(uint32_t panel) const { return commits_[panel]; }
+
+private:
+  Oled *panels_[PANELS];
+  Layer layers_[LAYERS];
+  uint32_t frameRate_;
+  uint64_t frameUs_;
+  uint64_t nextFrame_[PANELS];    ///< Earliest time of the next commit.
+  uint32_t commits_[PANELS];
+
+  bool commit(uint32_t panel, uint64_t now);
+};
@@ -0,0 +1,265 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "dfplayer.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include <stdio.h>
+#include <string.h>
+
+DfPlayer *DfPlayer::instances_[2];
+
+DfPlayer::DfPlayer(uart_inst_t *uart, uint8_t pinRx, uint8_t pinTx, uint32_t baudrate)
+    : uart_(uart)
+    , count_(0)
+    , inFlight_(false)
+    , tries_(0)
+    , timeout_(at_the_end_of_time)
+    , quiet_(nil_time)
+    , volumeSet_(false)
+    , volume_(15)
+    , length_(0)
+    , finished_(0)
+    , sent_(0)
+    , coalesced_(0)
+    , timeouts_(0)
+    , failed_(0)
+    , late_(0)
+    , dropped_(0)
+    , overruns_(0)
+{
+  uint32_t index    = uart_get_index(uart);
+  instances_[index] = this;
+
+  uart_init(uart, baudrate);
+  gpio_set_function(pinRx, GPIO_FUNC_UART);
+  gpio_set_function(pinTx, GPIO_FUNC_UART);
+  uart_set_format(uart, 8, 1, UART_PARITY_NONE);
+  uart_set_fifo_enabled(uart, true);
+
+  irq_set_exclusive_handler(index ? UART1_IRQ : UART0_IRQ, index ? &DfPlayer::onIrq1 : &DfPlayer::onIrq0);
+  irq_set_enabled(index ? UART1_IRQ : UART0_IRQ, true);
+  uart_set_irq_enables(uart, true, false);
+
+  queue(Command::Type::QueryVolume);
+}
+
+void DfPlayer::setPlayMode(PlayMode mode)
+{
+  queue(Command::Type::PlayMode, uint8_t(mode));
+}
+
+void DfPlayer::next()
+{
+  queue(Command::Type::Next);
+}
+
+void DfPlayer::pause()
+{
+  queue(Command::Type::Pause);
+}
+
+void DfPlayer::resume()
+{
+  queue(Command::Type::Resume);
+}
+
+void DfPlayer::incVolume(int32_t steps)
+{
+  setVolume(volume_ + steps);
+}
+
+void DfPlayer::setVolume(int32_t volume)
+{
+  volume_    = volume < 0 ? 0 : volume > MAX_VOLUME ? MAX_VOLUME : volume;
+  volumeSet_ = true;
+  queue(Command::Type::Volume, uint8_t(volume_));
+}
+
+void DfPlayer::queue(Command::Type type, uint8_t value)
+{
+  // Setting the same thing again only needs the newer value, but only while
+  // nothing else was queued after the older one: it must not overtake the
+  // commands in between. A pause is a toggle, two of them are never one.
+  uint32_t waiting = inFlight_ ? 1 : 0;
+  if (count_ > waiting and (type == Command::Type::Volume or type == Command::Type::PlayMode))
+  {
+    Command &last = queue_[count_ - 1];
+    if (last.type == type)
+    {
+      last.value = value;
+      coalesced_++;
+      return;
+    }
+  }
+
+  if (count_ == QUEUE)
+  {
+    dropped_++;
+    return;
+  }
+
+  queue_[count_++] = Command{type, value};
+  send();
+}
+
+void DfPlayer::send()
+{
+  if (inFlight_ or count_ == 0 or not time_reached(quiet_))
+  {
+    return;
+  }
+
+  char s[LINE];
+  const Command &command = queue_[0];
+  switch (command.type)
+  {
+  case Command::Type::PlayMode:
+    snprintf(s, sizeof(s), "AT+PLAYMODE=%u\r\n", command.value);
+    break;
+  case Command::Type::Next:
+    snprintf(s, sizeof(s), "AT+PLAY=NEXT\r\n");
+    break;
+  case Command::Type::Pause:
+  case Command::Type::Resume:
+    snprintf(s, sizeof(s), "AT+PLAY=PP\r\n");
+    break;
+  case Command::Type::Volume:
+    snprintf(s, sizeof(s), "AT+VOL=%u\r\n", command.value);
+    break;
+  case Command::Type::QueryVolume:
+    snprintf(s, sizeof(s), "AT+VOL=?\r\n");
+    break;
+  }
+
+  // The answer to the previous command came after its last byte left, so
+  // the 32 byte TX FIFO is empty and takes the whole command without a wait.
+  uart_write_blocking(uart_, reinterpret_cast<const uint8_t *>(s), strlen(s));
+  inFlight_ = true;
+  timeout_  = make_timeout_time_ms(TIMEOUT_MS);
+  tries_++;
+  sent_++;
+}
+
+void DfPlayer::finish()
+{
+  for (uint32_t i = 1; i < count_; i++)
+  {
+    queue_[i - 1] = queue_[i];
+  }
+  count_--;
+  finished_++;
+  inFlight_ = false;
+  tries_    = 0;
+  timeout_  = at_the_end_of_time;
+}
+
+// The player answers OK, a volume query with "VOL = [n]". Anything else
+// means the command was refused; lines without a command on the wire are
+// ignored.
+void DfPlayer::answer(const char *line)
+{
+  if (not inFlight_)
+  {
+    if (not time_reached(quiet_))
+    {
+      late_++;
+    }
+    return;
+  }
+
+  const Command &command = queue_[0];
+  const char *bracket    = strchr(line, '[');
+  if (command.type == Command::Type::QueryVolume and bracket != nullptr)
+  {
+    if (not volumeSet_)
+    {
+      int32_t volume = 0;
+      for (const char *c = bracket + 1; *c >= '0' and *c <= '9'; c++)
+      {
+        volume = volume * 10 + (*c - '0');
+      }
+      volume_ = volume > MAX_VOLUME ? MAX_VOLUME : volume;
+    }
+  }
+  else if (strcmp(line, "OK") != 0)
+  {
+    failed_++;
+  }
+
+  finish();
+}
+
+void DfPlayer::poll()
+{
+  char c;
+  while (rx_.pop(c))
+  {
+    if (c == '\n')
+    {
+      if (length_ > 0 and line_[length_ - 1] == '\r')
+      {
+        length_--;
+      }
+      line_[length_] = '\0';
+      if (length_ > 0)
+      {
+        answer(line_);
+      }
+      length_ = 0;
+    }
+    else if (length_ < LINE - 1)
+    {
+      line_[length_++] = c;
+    }
+  }
+
+  if (inFlight_ and time_reached(timeout_))
+  {
+    timeouts_++;
+    if (tries_ > RETRIES or not queue_[0].repeatable())
+    {
+      failed_++;
+      finish();
+    }
+    else
+    {
+      inFlight_ = false;
+    }
+    quiet_ = make_timeout_time_ms(QUIET_MS);
+  }
+
+  send();
+}
+
+absolute_time_t DfPlayer::deadline() const
+{
+  if (inFlight_)
+  {
+    return timeout_;
+  }
+  return count_ > 0 and not time_reached(quiet_) ? quiet_ : at_the_end_of_time;
+}
+
+void DfPlayer::onIrq()
+{
+  while (uart_is_readable(uart_))
+  {
+    if (not rx_.push(uart_getc(uart_)))
+    {
+      overruns_++;
+    }
+  }
+}
+
+void DfPlayer::onIrq0()
+{
+  instances_[0]->onIrq();
+}
+
+void DfPlayer::onIrq1()
+{
+  instances_[1]->onIrq();
+}
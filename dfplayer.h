@@ -0,0 +1,136 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "hardware/uart.h"
+#include "pico/time.h"
+#include "ring.h"
+#include <stdint.h>
+
+// The DFPlayer Pro driven by its AT commands without waiting for it. Calls
+// only queue a command; the UART interrupt moves the answers into a ring
+// and poll() matches them against the command on the wire, then sends the
+// next one. A command without an answer after TIMEOUT_MS goes out again,
+// up to RETRIES times, if sending it twice does no harm: a volume, a play
+// mode or a query. A toggle may have been carried out with only its answer
+// lost, sent again it would undo itself; it counts as failed instead. The
+// line stays quiet for QUIET_MS after a timeout, an answer arriving then is
+// a late one and dropped rather than taken for the next command's.
+//
+// A volume or play mode coalesces with the last command still waiting if
+// that one sets the same: volume steps become one absolute AT+VOL=n with
+// the sum of all of them, a newer play mode replaces an older one. Pauses
+// are toggles and always go out one by one. The player keeps its volume
+// over power cycles, it is queried once at start.
+class DfPlayer
+{
+public:
+  enum class PlayMode : uint8_t
+  {
+    RepeatOne       = 1,
+    RepeatAll       = 2,
+    PlayOneAndPause = 3,
+    Random          = 4,
+    RepeatFolder    = 5
+  };
+
+  static constexpr uint32_t QUEUE      = 8;
+  static constexpr uint32_t TIMEOUT_MS = 300;
+  static constexpr uint32_t RETRIES    = 2;
+  static constexpr uint32_t QUIET_MS   = 300;
+  static constexpr int32_t MAX_VOLUME  = 30;
+
+  DfPlayer(uart_inst_t *uart, uint8_t pinRx, uint8_t pinTx, uint32_t baudrate = 115200);
+
+  void setPlayMode(PlayMode mode);
+  void next();
+  void pause();
+  // Toggles like pause(), to play a track left paused.
+  void resume();
+  void incVolume(int32_t steps);
+  void setVolume(int32_t volume);
+
+  // The volume once all queued commands are through.
+  int32_t volume() const { return volume_; }
+
+  // Handles the answers received so far and sends what is queued.
+  void poll();
+
+  // When poll() has to run again without an answer: the timeout of the
+  // command on the wire, or the end of the quiet time after one.
+  absolute_time_t deadline() const;
+
+  // Answer bytes wait for poll().
+  bool pending() const { return not rx_.empty(); }
+  bool idle() const { return count_ == 0; }
+  uint32_t queued() const { return count_; }
+
+  // Commands done with, answered or given up. Commands finish in the order
+  // they were queued, so a command queued when finished() + queued() was n
+  // is through once finished() reaches n.
+  uint32_t finished() const { return finished_; }
+
+  uint32_t sent() const { return sent_; }
+  uint32_t coalesced() const { return coalesced_; }
+  uint32_t timeouts() const { return timeouts_; }   ///< Answers that did not come in time.
+  uint32_t failed() const { return failed_; }       ///< Commands refused or given up.
+  uint32_t late() const { return late_; }           ///< Answers dropped after a timeout.
+  uint32_t dropped() const { return dropped_; }     ///< Commands that found the queue full.
+  uint32_t overruns() const { return overruns_; }   ///< Answer bytes lost to a full ring.
+
+private:
+  struct Command
+  {
+    enum class Type : uint8_t
+    {
+      PlayMode,
+      Next,
+      Pause,
+      Resume,
+      Volume,
+      QueryVolume
+    };
+
+    Type type;
+    uint8_t value;
+
+    bool repeatable() const { return type != Type::Next and type != Type::Pause and type != Type::Resume; }
+  };
+
+  static constexpr uint32_t LINE = 32;
+
+  uart_inst_t *uart_;
+  SpscRing<char, 64> rx_;
+  Command queue_[QUEUE];      ///< queue_[0] is on the wire while inFlight_.
+  uint32_t count_;
+  bool inFlight_;
+  uint32_t tries_;
+  absolute_time_t timeout_;
+  absolute_time_t quiet_;     ///< Nothing goes out before, after a timeout.
+  bool volumeSet_;            ///< The volume was set before the query answered.
+  int32_t volume_;
+  char line_[LINE];
+  uint32_t length_;
+
+  uint32_t finished_;
+  uint32_t sent_;
+  uint32_t coalesced_;
+  uint32_t timeouts_;
+  uint32_t failed_;
+  uint32_t late_;
+  uint32_t dropped_;
+  volatile uint32_t overruns_;
+
+  static DfPlayer *instances_[2];
+
+  void queue(Command::Type type, uint8_t value = 0);
+  void send();
+  void finish();
+  void answer(const char *line);
+  void onIrq();
+  static void onIrq0();
+  static void onIrq1();
+};
@@ -0,0 +1,277 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "flashstore.h"
+#include "hardware/sync.h"
+#include "pico/multicore.h"
+#include <stddef.h>
+#include <string.h>
+
+FlashStore::FlashStore(uint32_t offset)
+    : offset_(offset)
+    , values_{}
+    , present_(0)
+    , dirty_(0)
+    , sequence_{}
+    , newest_(-1)
+    , base_(-1)
+    , used_(0)
+    , lockout_(false)
+    , appended_(0)
+    , compactions_(0)
+{
+  Record header;
+  for (uint32_t i = 0; i < SECTORS; i++)
+  {
+    if (read(i, 0, header) and header.key == HEADER and header.sequence != 0)
+    {
+      sequence_[i] = header.sequence;
+      if (newest_ < 0 or header.sequence > sequence_[newest_])
+      {
+        newest_ = i;
+      }
+    }
+  }
+
+  // Newest first, down to the first sealed one: a sector after it holds
+  // part of a copy, with changes that never completed.
+  uint32_t below = UINT32_MAX;
+  while (true)
+  {
+    int32_t next = -1;
+    for (uint32_t i = 0; i < SECTORS; i++)
+    {
+      if (sequence_[i] != 0 and sequence_[i] < below and (next < 0 or sequence_[i] > sequence_[next]))
+      {
+        next = i;
+      }
+    }
+    if (next < 0 or replay(next))
+    {
+      break;
+    }
+    below = sequence_[next];
+  }
+}
+
+void FlashStore::set(uint8_t key, uint32_t value)
+{
+  if (key >= KEYS or (has(key) and values_[key] == value))
+  {
+    return;
+  }
+  values_[key]  = value;
+  present_     |= bit(key);
+  dirty_       |= bit(key);
+}
+
+const uint8_t *FlashStore::sector(uint32_t index) const
+{
+  return reinterpret_cast<const uint8_t *>(XIP_BASE + offset_ + index * FLASH_SECTOR_SIZE);
+}
+
+// False for a slot that is erased, torn or left over from an earlier use of
+// the sector.
+bool FlashStore::read(uint32_t index, uint32_t slot, Record &record) const
+{
+  memcpy(&record, sector(index) + slot * RECORD, RECORD);
+  return record.key != ERASED and record.format == FORMAT and
+         record.crc == crc32(reinterpret_cast<const uint8_t *>(&record), offsetof(Record, crc));
+}
+
+// Takes the values of a sealed sector, false for any other. Every slot is
+// looked at: a torn record may sit between good ones, and only the last slot
+// written to tells where the next record goes.
+bool FlashStore::replay(uint32_t index)
+{
+  Record record;
+  uint32_t values[KEYS];
+  uint64_t present = 0;
+  uint32_t used    = 1;
+  bool sealed      = false;
+  for (uint32_t slot = 1; slot < SLOTS; slot++)
+  {
+    if (read(index, slot, record) and record.sequence == sequence_[index])
+    {
+      if (record.key < KEYS)
+      {
+        values[record.key]  = record.value;
+        present            |= bit(record.key);
+      }
+      else if (record.key == SEALED)
+      {
+        sealed = true;
+      }
+    }
+
+    const uint8_t *bytes = sector(index) + slot * RECORD;
+    for (uint32_t i = 0; i < RECORD; i++)
+    {
+      if (bytes[i] != 0xFF)
+      {
+        used = slot + 1;
+        break;
+      }
+    }
+  }
+
+  if (not sealed)
+  {
+    return false;
+  }
+  memcpy(values_, values, sizeof(values_));
+  present_ = present;
+  base_    = index;
+  used_    = used;
+  return true;
+}
+
+void FlashStore::flush()
+{
+  if (not dirty_)
+  {
+    return;
+  }
+
+  // A sector whose compaction was cut short only gets a new one.
+  if (base_ < 0 or base_ != newest_)
+  {
+    compact();
+    return;
+  }
+
+  Record records[KEYS];
+  uint32_t count = 0;
+  for (uint8_t key = 0; key < KEYS; key++)
+  {
+    if (dirty_ & bit(key))
+    {
+      records[count++] = record(key, values_[key], sequence_[newest_]);
+    }
+  }
+
+  if (used_ + count > SLOTS)
+  {
+    compact();
+    return;
+  }
+
+  program(newest_, used_, records, count);
+  used_     += count;
+  appended_ += count;
+  dirty_     = 0;
+}
+
+// Copies the live values into the sector after the newest, never into the
+// last sealed one: until the new copy is sealed, that one and what was
+// appended to it are what a restart falls back on.
+void FlashStore::compact()
+{
+  uint32_t target = newest_ < 0 ? 0 : (newest_ + 1) % SECTORS;
+  if (int32_t(target) == base_)
+  {
+    target = (target + 1) % SECTORS;
+  }
+  uint32_t sequence = this->sequence() + 1;
+
+  Record records[KEYS + 2];
+  uint32_t count    = 0;
+  records[count++]  = record(HEADER, 0, sequence);
+  for (uint8_t key = 0; key < KEYS; key++)
+  {
+    if (has(key))
+    {
+      records[count++] = record(key, values_[key], sequence);
+    }
+  }
+  records[count++] = record(SEALED, 0, sequence);
+
+  sequence_[target] = 0;
+  erase(target);
+  sequence_[target] = sequence;
+  newest_           = target;
+  program(target, 0, records, count);
+
+  base_  = target;
+  used_  = count;
+  dirty_ = 0;
+  compactions_++;
+}
+
+// Whole pages, with what they hold already: bits only go from 1 to 0, so
+// programming a record's bytes again leaves it as it is.
+void FlashStore::program(uint32_t index, uint32_t slot, const Record *records, uint32_t count)
+{
+  uint8_t page[FLASH_PAGE_SIZE];
+  uint32_t first = slot / PER_PAGE;
+  uint32_t last  = (slot + count - 1) / PER_PAGE;
+  for (uint32_t p = first; p <= last; p++)
+  {
+    memcpy(page, sector(index) + p * FLASH_PAGE_SIZE, FLASH_PAGE_SIZE);
+    for (uint32_t s = p * PER_PAGE; s < (p + 1) * PER_PAGE; s++)
+    {
+      if (s >= slot and s < slot + count)
+      {
+        memcpy(page + (s % PER_PAGE) * RECORD, &records[s - slot], RECORD);
+      }
+    }
+
+    // Core1 waits in RAM while the flash cannot be read.
+    if (lockout_)
+    {
+      multicore_lockout_start_blocking();
+    }
+    uint32_t status = save_and_disable_interrupts();
+    flash_range_program(offset_ + index * FLASH_SECTOR_SIZE + p * FLASH_PAGE_SIZE, page, FLASH_PAGE_SIZE);
+    restore_interrupts(status);
+    if (lockout_)
+    {
+      multicore_lockout_end_blocking();
+    }
+  }
+}
+
+void FlashStore::erase(uint32_t index)
+{
+  if (lockout_)
+  {
+    multicore_lockout_start_blocking();
+  }
+  uint32_t status = save_and_disable_interrupts();
+  flash_range_erase(offset_ + index * FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+  restore_interrupts(status);
+  if (lockout_)
+  {
+    multicore_lockout_end_blocking();
+  }
+}
+
+FlashStore::Record FlashStore::record(uint8_t key, uint32_t value, uint32_t sequence)
+{
+  Record record;
+  record.key      = key;
+  record.format   = FORMAT;
+  record.reserved = 0xFFFF;
+  record.value    = value;
+  record.sequence = sequence;
+  record.crc      = crc32(reinterpret_cast<const uint8_t *>(&record), offsetof(Record, crc));
+  return record;
+}
+
+// Bitwise: a boot checks SECTORS * SLOTS records at most, a table is not
+// worth its 1 KiB.
+uint32_t FlashStore::crc32(const uint8_t *data, uint32_t length)
+{
+  uint32_t crc = 0xFFFFFFFF;
+  for (uint32_t i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+    for (uint32_t b = 0; b < 8; b++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
@@ -0,0 +1,94 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "hardware/flash.h"
+
+// Up to KEYS 32 bit values kept over power cycles in the last SECTORS
+// sectors of the flash, as a log: a changed value is appended as a record
+// of its own, CRC-checked and tagged with the sequence number of its sector.
+// When the sector in use is full, the live values are compacted into the
+// next one, round the sectors in turn so they wear evenly. A sector holds
+// its header, the copies and a sealed record, then 214 changes or more.
+//
+// The constructor reads the log once and keeps the latest value of each key
+// in RAM, where get() finds it. set() only changes RAM; flush() appends what
+// changed, a page program per 16 records, and erases a sector when it has to
+// compact. Both stall both cores, an erase for some 45 ms, so the caller
+// picks the time.
+//
+// A power cut at any point leaves each key at its old or its new value: a
+// restart reads the newest sector whose copy completed and what was
+// appended to it, and records are only appended to that one. A compaction
+// cut short is redone at the next flush(), its changes are lost.
+class FlashStore
+{
+public:
+  static constexpr uint32_t KEYS    = 40;
+  static constexpr uint32_t SECTORS = 4;
+  static constexpr uint32_t RECORD  = 16;
+  static constexpr uint32_t SLOTS   = FLASH_SECTOR_SIZE / RECORD;
+  static constexpr uint32_t OFFSET  = PICO_FLASH_SIZE_BYTES - SECTORS * FLASH_SECTOR_SIZE;
+
+  // The program image has to end below offset.
+  FlashStore(uint32_t offset = OFFSET);
+
+  bool has(uint8_t key) const { return present_ & bit(key); }
+  uint32_t get(uint8_t key, uint32_t fallback = 0) const { return has(key) ? values_[key] : fallback; }
+  void set(uint8_t key, uint32_t value);
+
+  bool dirty() const { return dirty_ != 0; }
+  void flush();
+
+  // Whether flash operations have to hold core1, once it runs from flash.
+  void setLockout(bool lockout) { lockout_ = lockout; }
+
+  uint32_t sequence() const { return newest_ < 0 ? 0 : sequence_[newest_]; }
+  uint32_t appended() const { return appended_; }
+  uint32_t compactions() const { return compactions_; }
+
+private:
+  static constexpr uint8_t FORMAT = 1;
+  static constexpr uint8_t HEADER = 0xFD;   ///< First record of a sector.
+  static constexpr uint8_t SEALED = 0xFE;   ///< The copies of a compaction are complete.
+  static constexpr uint8_t ERASED = 0xFF;
+  static constexpr uint32_t PER_PAGE = FLASH_PAGE_SIZE / RECORD;
+
+  struct Record
+  {
+    uint8_t key;
+    uint8_t format;
+    uint16_t reserved;
+    uint32_t value;
+    uint32_t sequence;   ///< Of the sector it was written to.
+    uint32_t crc;        ///< CRC-32 of the fields before.
+  };
+  static_assert(sizeof(Record) == RECORD, "records fill pages");
+
+  uint32_t offset_;
+  uint32_t values_[KEYS];
+  uint64_t present_;
+  uint64_t dirty_;
+  uint32_t sequence_[SECTORS];   ///< 0 for a sector without a valid header.
+  int32_t newest_;               ///< The sector records go to, -1 for none.
+  int32_t base_;                 ///< The newest sealed sector.
+  uint32_t used_;                ///< Slots of base_ not free any more.
+  bool lockout_;
+  uint32_t appended_;
+  uint32_t compactions_;
+
+  static uint64_t bit(uint8_t key) { return key < KEYS ? uint64_t(1) << key : 0; }
+  static uint32_t crc32(const uint8_t *data, uint32_t length);
+  static Record record(uint8_t key, uint32_t value, uint32_t sequence);
+
+  const uint8_t *sector(uint32_t index) const;
+  bool read(uint32_t index, uint32_t slot, Record &record) const;
+  bool replay(uint32_t index);
+  void compact();
+  void program(uint32_t index, uint32_t slot, const Record *records, uint32_t count);
+  void erase(uint32_t index);
+};
@@ -0,0 +1,302 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "font.h"
+
+static constexpr uint8_t font8x5Columns[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, // ' '
+    0x00, 0x00, 0x5F, 0x00, 0x00, // '!'
+    0x00, 0x07, 0x00, 0x07, 0x00, // '"'
+    0x14, 0x7F, 0x14, 0x7F, 0x14, // '#'
+    0x24, 0x2A, 0x7F, 0x2A, 0x12, // '$'
+    0x23, 0x13, 0x08, 0x64, 0x62, // '%'
+    0x36, 0x49, 0x56, 0x20, 0x50, // '&'
+    0x00, 0x08, 0x07, 0x03, 0x00, // '''
+    0x00, 0x1C, 0x22, 0x41, 0x00, // '('
+    0x00, 0x41, 0x22, 0x1C, 0x00, // ')'
+    0x2A, 0x1C, 0x7F, 0x1C, 0x2A, // '*'
+    0x08, 0x08, 0x3E, 0x08, 0x08, // '+'
+    0x00, 0x80, 0x70, 0x30, 0x00, // ','
+    0x08, 0x08, 0x08, 0x08, 0x08, // '-'
+    0x00, 0x00, 0x60, 0x60, 0x00, // '.'
+    0x20, 0x10, 0x08, 0x04, 0x02, // '/'
+    0x3E, 0x51, 0x49, 0x45, 0x3E, // '0'
+    0x00, 0x42, 0x7F, 0x40, 0x00, // '1'
+    0x72, 0x49, 0x49, 0x49, 0x46, // '2'
+    0x21, 0x41, 0x49, 0x4D, 0x33, // '3'
+    0x18, 0x14, 0x12, 0x7F, 0x10, // '4'
+    0x27, 0x45, 0x45, 0x45, 0x39, // '5'
+    0x3C, 0x4A, 0x49, 0x49, 0x31, // '6'
+    0x41, 0x21, 0x11, 0x09, 0x07, // '7'
+    0x36, 0x49, 0x49, 0x49, 0x36, // '8'
+    0x46, 0x49, 0x49, 0x29, 0x1E, // '9'
+    0x00, 0x00, 0x14, 0x00, 0x00, // ':'
+    0x00, 0x40, 0x34, 0x00, 0x00, // ';'
+    0x00, 0x08, 0x14, 0x22, 0x41, // '<'
+    0x14, 0x14, 0x14, 0x14, 0x14, // '='
+    0x00, 0x41, 0x22, 0x14, 0x08, // '>'
+    0x02, 0x01, 0x59, 0x09, 0x06, // '?'
+    0x3E, 0x41, 0x5D, 0x59, 0x4E, // '@'
+    0x7C, 0x12, 0x11, 0x12, 0x7C, // 'A'
+    0x7F, 0x49, 0x49, 0x49, 0x36, // 'B'
+    0x3E, 0x41, 0x41, 0x41, 0x22, // 'C'
+    0x7F, 0x41, 0x41, 0x41, 0x3E, // 'D'
+    0x7F, 0x49, 0x49, 0x49, 0x41, // 'E'
+    0x7F, 0x09, 0x09, 0x09, 0x01, // 'F'
+    0x3E, 0x41, 0x41, 0x51, 0x73, // 'G'
+    0x7F, 0x08, 0x08, 0x08, 0x7F, // 'H'
+    0x00, 0x41, 0x7F, 0x41, 0x00, // 'I'
+    0x20, 0x40, 0x41, 0x3F, 0x01, // 'J'
+    0x7F, 0x08, 0x14, 0x22, 0x41, // 'K'
+    0x7F, 0x40, 0x40, 0x40, 0x40, // 'L'
+    0x7F, 0x02, 0x1C, 0x02, 0x7F, // 'M'
+    0x7F, 0x04, 0x08, 0x10, 0x7F, // 'N'
+    0x3E, 0x41, 0x41, 0x41, 0x3E, // 'O'
+    0x7F, 0x09, 0x09, 0x09, 0x06, // 'P'
+    0x3E, 0x41, 0x51, 0x21, 0x5E, // 'Q'
+    0x7F, 0x09, 0x19, 0x29, 0x46, // 'R'
+    0x26, 0x49, 0x49, 0x49, 0x32, // 'S'
+    0x03, 0x01, 0x7F, 0x01, 0x03, // 'T'
+    0x3F, 0x40, 0x40, 0x40, 0x3F, // 'U'
+    0x1F, 0x20, 0x40, 0x20, 0x1F, // 'V'
+    0x3F, 0x40, 0x38, 0x40, 0x3F, // 'W'
+    0x63, 0x14, 0x08, 0x14, 0x63, // 'X'
+    0x03, 0x04, 0x78, 0x04, 0x03, // 'Y'
+    0x61, 0x59, 0x49, 0x4D, 0x43, // 'Z'
+    0x00, 0x7F, 0x41, 0x41, 0x41, // '['
+    0x02, 0x04, 0x08, 0x10, 0x20, // '\'
+    0x00, 0x41, 0x41, 0x41, 0x7F, // ']'
+    0x04, 0x02, 0x01, 0x02, 0x04, // '^'
+    0x40, 0x40, 0x40, 0x40, 0x40, // '_'
+    0x00, 0x03, 0x07, 0x08, 0x00, // '`'
+    0x20, 0x54, 0x54, 0x78, 0x40, // 'a'
+    0x7F, 0x28, 0x44, 0x44, 0x38, // 'b'
+    0x38, 0x44, 0x44, 0x44, 0x28, // 'c'
+    0x38, 0x44, 0x44, 0x28, 0x7F, // 'd'
+    0x38, 0x54, 0x54, 0x54, 0x18, // 'e'
+    0x00, 0x08, 0x7E, 0x09, 0x02, // 'f'
+    0x18, 0xA4, 0xA4, 0x9C, 0x78, // 'g'
+    0x7F, 0x08, 0x04, 0x04, 0x78, // 'h'
+    0x00, 0x44, 0x7D, 0x40, 0x00, // 'i'
+    0x20, 0x40, 0x40, 0x3D, 0x00, // 'j'
+    0x7F, 0x10, 0x28, 0x44, 0x00, // 'k'
+    0x00, 0x41, 0x7F, 0x40, 0x00, // 'l'
+    0x7C, 0x04, 0x78, 0x04, 0x78, // 'm'
+    0x7C, 0x08, 0x04, 0x04, 0x78, // 'n'
+    0x38, 0x44, 0x44, 0x44, 0x38, // 'o'
+    0xFC, 0x18, 0x24, 0x24, 0x18, // 'p'
+    0x18, 0x24, 0x24, 0x18, 0xFC, // 'q'
+    0x7C, 0x08, 0x04, 0x04, 0x08, // 'r'
+    0x48, 0x54, 0x54, 0x54, 0x24, // 's'
+    0x04, 0x04, 0x3F, 0x44, 0x24, // 't'
+    0x3C, 0x40, 0x40, 0x20, 0x7C, // 'u'
+    0x1C, 0x20, 0x40, 0x20, 0x1C, // 'v'
+    0x3C, 0x40, 0x30, 0x40, 0x3C, // 'w'
+    0x44, 0x28, 0x10, 0x28, 0x44, // 'x'
+    0x4C, 0x90, 0x90, 0x90, 0x7C, // 'y'
+    0x44, 0x64, 0x54, 0x4C, 0x44, // 'z'
+    0x00, 0x08, 0x36, 0x41, 0x00, // '{'
+    0x00, 0x00, 0x77, 0x00, 0x00, // '|'
+    0x00, 0x41, 0x36, 0x08, 0x00, // '}'
+    0x02, 0x01, 0x02, 0x04, 0x02, // '~'
+};
+
+// Glyphs prepared at compile time, from '0' to ':'.
+static constexpr char FIRST_DIGIT  = '0';
+static constexpr char LAST_DIGIT   = ':';
+static constexpr uint32_t DIGITS   = LAST_DIGIT - FIRST_DIGIT + 1;
+static constexpr uint32_t WIDTH    = 5;
+static constexpr uint32_t HEIGHT   = 8;
+
+static constexpr bool font8x5Pixel(char c, uint32_t x, uint32_t y)
+{
+  return font8x5Columns[(c - ' ') * WIDTH + x] & (1 << y);
+}
+
+// The digits scaled by SCALE, each pixel a SCALE x SCALE square.
+template <uint32_t SCALE>
+struct ScaledDigits
+{
+  static constexpr uint32_t COLUMNS = WIDTH * SCALE;
+  static constexpr uint32_t PAGES   = HEIGHT * SCALE / 8;
+
+  uint8_t data[DIGITS * PAGES * COLUMNS];    ///< Flat, Glyphs reads across the glyphs.
+
+  constexpr ScaledDigits() : data{}
+  {
+    for (uint32_t glyph = 0; glyph < DIGITS; glyph++)
+    {
+      for (uint32_t x = 0; x < COLUMNS; x++)
+      {
+        for (uint32_t y = 0; y < HEIGHT * SCALE; y++)
+        {
+          if (font8x5Pixel(char(FIRST_DIGIT + glyph), x / SCALE, y / SCALE))
+          {
+            data[(glyph * PAGES + y / 8) * COLUMNS + x] |= 1 << (y % 8);
+          }
+        }
+      }
+    }
+  }
+};
+
+// The digits doubled three times with Scale2x, which rounds the corners of
+// the diagonals off where a plain scale leaves steps.
+struct SmoothDigits
+{
+  static constexpr uint32_t SCALE   = 8;
+  static constexpr uint32_t COLUMNS = WIDTH * SCALE;
+  static constexpr uint32_t ROWS    = HEIGHT * SCALE;
+  static constexpr uint32_t PAGES   = ROWS / 8;
+
+  uint8_t data[DIGITS * PAGES * COLUMNS];
+
+  constexpr SmoothDigits() : data{}
+  {
+    for (uint32_t glyph = 0; glyph < DIGITS; glyph++)
+    {
+      bool pixels[ROWS][COLUMNS] = {};
+      for (uint32_t x = 0; x < WIDTH; x++)
+      {
+        for (uint32_t y = 0; y < HEIGHT; y++)
+        {
+          pixels[y][x] = font8x5Pixel(char(FIRST_DIGIT + glyph), x, y);
+        }
+      }
+
+      for (uint32_t width = WIDTH, height = HEIGHT; width < COLUMNS; width *= 2, height *= 2)
+      {
+        bool doubled[ROWS][COLUMNS] = {};
+        for (uint32_t x = 0; x < width; x++)
+        {
+          for (uint32_t y = 0; y < height; y++)
+          {
+            bool p = pixels[y][x];
+            bool a = y > 0 ? pixels[y - 1][x] : p;
+            bool b = x + 1 < width ? pixels[y][x + 1] : p;
+            bool c = x > 0 ? pixels[y][x - 1] : p;
+            bool d = y + 1 < height ? pixels[y + 1][x] : p;
+
+            doubled[2 * y][2 * x]         = c == a and c != d and a != b ? a : p;
+            doubled[2 * y][2 * x + 1]     = a == b and a != c and b != d ? b : p;
+            doubled[2 * y + 1][2 * x]     = d == c and d != b and c != a ? c : p;
+            doubled[2 * y + 1][2 * x + 1] = b == d and b != a and d != c ? d : p;
+          }
+        }
+        for (uint32_t y = 0; y < ROWS; y++)
+        {
+          for (uint32_t x = 0; x < COLUMNS; x++)
+          {
+            pixels[y][x] = doubled[y][x];
+          }
+        }
+      }
+
+      for (uint32_t x = 0; x < COLUMNS; x++)
+      {
+        for (uint32_t y = 0; y < ROWS; y++)
+        {
+          if (pixels[y][x])
+          {
+            data[(glyph * PAGES + y / 8) * COLUMNS + x] |= 1 << (y % 8);
+          }
+        }
+      }
+    }
+  }
+};
+
+// Encodes count bytes as Glyphs describes it into out, or only counts the
+// bytes it takes unless WRITE. A repeat of three or more pays off.
+template <bool WRITE>
+static constexpr uint32_t encode(const uint8_t *raw, uint32_t count, uint8_t *out)
+{
+  uint32_t length = 0;
+  uint32_t i      = 0;
+  while (i < count)
+  {
+    uint32_t repeat = 1;
+    while (i + repeat < count and repeat < 128 and raw[i + repeat] == raw[i])
+    {
+      repeat++;
+    }
+
+    if (repeat >= 3)
+    {
+      if constexpr (WRITE)
+      {
+        out[length]     = uint8_t(Glyphs::REPEAT + repeat - 1);
+        out[length + 1] = raw[i];
+      }
+      length += 2;
+      i += repeat;
+      continue;
+    }
+
+    uint32_t literal = 0;
+    while (i + literal < count and literal < 128 and
+           not(i + literal + 2 < count and raw[i + literal] == raw[i + literal + 1] and
+               raw[i + literal] == raw[i + literal + 2]))
+    {
+      literal++;
+    }
+    if constexpr (WRITE)
+    {
+      out[length] = uint8_t(literal - 1);
+      for (uint32_t j = 0; j < literal; j++)
+      {
+        out[length + 1 + j] = raw[i + j];
+      }
+    }
+    length += 1 + literal;
+    i += literal;
+  }
+  return length;
+}
+
+template <uint32_t BYTES>
+struct Compressed
+{
+  uint8_t data[BYTES];
+  uint16_t offsets[DIGITS];
+
+  constexpr Compressed(const SmoothDigits &digits) : data{}, offsets{}
+  {
+    uint32_t length = 0;
+    for (uint32_t glyph = 0; glyph < DIGITS; glyph++)
+    {
+      offsets[glyph] = uint16_t(length);
+      length += encode<true>(&digits.data[glyph * SmoothDigits::PAGES * SmoothDigits::COLUMNS], SmoothDigits::PAGES * SmoothDigits::COLUMNS, &data[length]);
+    }
+  }
+};
+
+static constexpr uint32_t compressedBytes(const SmoothDigits &digits)
+{
+  uint32_t length = 0;
+  for (uint32_t glyph = 0; glyph < DIGITS; glyph++)
+  {
+    length += encode<false>(&digits.data[glyph * SmoothDigits::PAGES * SmoothDigits::COLUMNS], SmoothDigits::PAGES * SmoothDigits::COLUMNS, nullptr);
+  }
+  return length;
+}
+
+static constexpr ScaledDigits<4> digits4;
+static constexpr ScaledDigits<8> digits8;
+static constexpr SmoothDigits smooth;
+static constexpr Compressed<compressedBytes(smooth)> smoothCompressed(smooth);
+
+static constexpr Glyphs font8x5Digits4(ScaledDigits<4>::COLUMNS, ScaledDigits<4>::PAGES, (WIDTH + 1) * 4, FIRST_DIGIT,
+                                       LAST_DIGIT, digits4.data, sizeof(digits4.data));
+static constexpr Glyphs font8x5Digits8(ScaledDigits<8>::COLUMNS, ScaledDigits<8>::PAGES, (WIDTH + 1) * 8, FIRST_DIGIT,
+                                       LAST_DIGIT, digits8.data, sizeof(digits8.data));
+static constexpr const Glyphs *font8x5Scaled[] = {&font8x5Digits4, &font8x5Digits8};
+static constexpr uint8_t font8x5Scales[]       = {4, 8};
+
+const Font font8x5(5, 8, ' ', '~', font8x5Columns, font8x5Scaled, font8x5Scales, 2);
+
+const Glyphs smoothDigits(SmoothDigits::COLUMNS, SmoothDigits::PAGES, (WIDTH + 1) * SmoothDigits::SCALE, FIRST_DIGIT,
+                          LAST_DIGIT, smoothCompressed.data, sizeof(smoothCompressed.data) + sizeof(smoothCompressed.offsets),
+                          smoothCompressed.offsets);
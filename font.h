@@ -0,0 +1,115 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Glyphs from first to last drawn ahead of time at one size, in the page
+// layout of the panels: per glyph pages() rows of width() columns, page after
+// page, at most a panel wide. Raw glyphs are blitted as they are; compressed
+// ones are run-length encoded and decoded a page at a time while they are
+// drawn.
+//
+// The encoding is a sequence of runs, each starting with a count byte: below
+// 0x80 it is followed by count + 1 literal bytes, from 0x80 on by one byte
+// to repeat count - 0x7F times. Runs may span pages; every glyph starts
+// with a run of its own.
+class Glyphs
+{
+public:
+  static constexpr uint8_t REPEAT = 0x80;
+
+  constexpr Glyphs(uint8_t width, uint8_t pages, uint8_t advance, char first, char last, const uint8_t *data,
+                   uint32_t bytes, const uint16_t *offsets = nullptr)
+      : width_(width), pages_(pages), advance_(advance), first_(first), last_(last), data_(data), bytes_(bytes),
+        offsets_(offsets)
+  {
+  }
+
+  uint32_t width() const { return width_; }
+  uint32_t pages() const { return pages_; }
+  uint32_t advance() const { return advance_; }    ///< From one glyph to the next.
+  bool compressed() const { return offsets_ != nullptr; }
+  uint32_t bytes() const { return bytes_; }         ///< In flash.
+
+  // The data of c, nullptr for characters without a glyph.
+  const uint8_t *glyph(char c) const
+  {
+    if (c < first_ or c > last_)
+    {
+      return nullptr;
+    }
+    uint32_t index = c - first_;
+    return compressed() ? &data_[offsets_[index]] : &data_[index * pages_ * width_];
+  }
+
+private:
+  uint8_t width_;
+  uint8_t pages_;
+  uint8_t advance_;
+  char first_;
+  char last_;
+  const uint8_t *data_;
+  uint32_t bytes_;
+  const uint16_t *offsets_;     ///< Start of each glyph in data_, nullptr if raw.
+};
+
+// Column-wise bitmap font, least significant bit at the top, one byte per
+// column as the SSD1306 pages expect it. Glyphs it has been scaled to ahead
+// of time are drawn from those instead of pixel by pixel.
+class Font
+{
+public:
+  constexpr Font(uint8_t width, uint8_t height, char first, char last, const uint8_t *columns,
+                 const Glyphs *const *scaled = nullptr, const uint8_t *scales = nullptr, uint8_t count = 0)
+      : width_(width), height_(height), first_(first), last_(last), columns_(columns), scaled_(scaled),
+        scales_(scales), count_(count)
+  {
+  }
+
+  uint32_t width() const { return width_; }
+  uint32_t height() const { return height_; }
+
+  // The width() columns of c, a blank glyph for characters not in the font.
+  const uint8_t *glyph(char c) const
+  {
+    if (c < first_ or c > last_)
+    {
+      c = ' ';
+    }
+    return &columns_[(c - first_) * width_];
+  }
+
+  // Glyphs at scale, nullptr if the font has none prepared.
+  const Glyphs *scaled(uint32_t scale) const
+  {
+    for (uint32_t i = 0; i < count_; i++)
+    {
+      if (scales_[i] == scale)
+      {
+        return scaled_[i];
+      }
+    }
+    return nullptr;
+  }
+
+private:
+  uint8_t width_;
+  uint8_t height_;
+  char first_;
+  char last_;
+  const uint8_t *columns_;
+  const Glyphs *const *scaled_;
+  const uint8_t *scales_;
+  uint8_t count_;
+};
+
+// Digits and ':' are prepared at scales 4 and 8.
+extern const Font font8x5;
+
+// Digits and ':' of font8x5 at scale 8 with the steps of the diagonals
+// smoothed out, 40x64 pixels each, compressed.
+extern const Glyphs smoothDigits;
@@ -0,0 +1,68 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "animation.h"
+#include "menu.h"
+#include <stdint.h>
+
+// Everything the panels and the pixels show, as plain data. The state
+// machine fills it in on core0 and publishes it whenever it changed; the
+// Renderer on core1 turns it into pixels. Menu entries and keyframes are
+// pointers into constant tables, which never change.
+struct Frame
+{
+  static constexpr uint32_t PIXELS = 4;
+
+  enum class View : uint8_t
+  {
+    None,     ///< Nothing drawn yet, only used by the renderer.
+    Clock,    ///< hour on the left panel, minute on the right one.
+    Menu,     ///< menu on the left, the right one blank.
+    TimeSet,  ///< menu on the left, hour:minute with digit selected on the right.
+    Volume,   ///< "-" on the left and "+" on the right.
+    Snooze    ///< "Snooze" on the left, minute:second left of it on the right.
+  };
+
+  // How a digit of the clock that changes goes over to the new one.
+  enum class Transition : uint8_t
+  {
+    None,     ///< Drawn at once.
+    Roll,     ///< The old digit rolls up and out, the new one in from below.
+    Dither    ///< Crossfade through an ordered dither.
+  };
+
+  using Pixel = Rgb;
+
+  View view             = View::Clock;
+  uint8_t hour          = 0;
+  uint8_t minute        = 0;
+  uint8_t second        = 0;
+  uint8_t digit         = 0;
+  bool alarmOn          = false;   ///< Marked on top of the clock.
+  Menu::View menu;
+  uint8_t contrast      = 0xCF;
+  uint8_t brightness    = 15;
+  Transition transition = Transition::None;   ///< Of the clock's digits when the minute changes.
+  Pixel pixels[PIXELS];
+  Animation animations[PIXELS];   ///< Runs on core1 in place of the pixel while active.
+
+  bool operator==(const Frame &rhs) const
+  {
+    for (uint32_t i = 0; i < PIXELS; i++)
+    {
+      if (pixels[i] != rhs.pixels[i] or animations[i] != rhs.animations[i])
+      {
+        return false;
+      }
+    }
+    return view == rhs.view and hour == rhs.hour and minute == rhs.minute and second == rhs.second and
+           digit == rhs.digit and alarmOn == rhs.alarmOn and menu == rhs.menu and contrast == rhs.contrast and brightness == rhs.brightness and
+           transition == rhs.transition;
+  }
+
+  bool operator!=(const Frame &rhs) const { return not operator==(rhs); }
+};
@@ -0,0 +1,52 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Builds the profiling in: state and loop histograms, transfer times on the
+// bus and the Profiler that dumps them over USB serial. Off unless the build
+// sets it, then none of it is compiled.
+#ifndef ALARM_CLOCK_PROFILE
+#define ALARM_CLOCK_PROFILE 0
+#endif
+
+// Durations in microseconds by powers of two: bucket 0 counts 0, bucket b
+// counts 2^(b-1) up to 2^b - 1, the last bucket everything longer. Adding
+// is a count-leading-zeros and three adds, cheap enough for every pass.
+class Histogram
+{
+public:
+  static constexpr uint32_t BUCKETS = 16;
+
+  Histogram() : buckets_{}, count_(0), sumUs_(0), maxUs_(0) {}
+
+  void add(uint32_t us)
+  {
+    uint32_t bucket = us ? 32 - __builtin_clz(us) : 0;
+    buckets_[bucket < BUCKETS ? bucket : BUCKETS - 1]++;
+    count_++;
+    sumUs_ += us;
+    if (us > maxUs_)
+    {
+      maxUs_ = us;
+    }
+  }
+
+  // The shortest duration bucket b counts.
+  static uint32_t lowerUs(uint32_t bucket) { return bucket ? 1u << (bucket - 1) : 0; }
+
+  uint32_t bucket(uint32_t index) const { return buckets_[index]; }
+  uint32_t count() const { return count_; }
+  uint64_t sumUs() const { return sumUs_; }
+  uint32_t maxUs() const { return maxUs_; }
+
+private:
+  uint32_t buckets_[BUCKETS];
+  uint32_t count_;
+  uint64_t sumUs_;
+  uint32_t maxUs_;
+};
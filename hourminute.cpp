@@ -0,0 +1,226 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "hourminute.h"
+
+static constexpr uint32_t SECONDS_PER_DAY  = 24 * 60 * 60;
+static constexpr uint32_t MINUTES_PER_DAY  = 24 * 60;
+static constexpr uint32_t MINUTES_PER_WEEK = 7 * MINUTES_PER_DAY;
+static constexpr uint32_t LOCK_US          = 8000;   ///< Edge resolution a lock settles for.
+static constexpr int32_t MAX_DRIFT_PPM     = 1000;
+static constexpr uint32_t HOLD_MINUTES     = 2;      ///< Most a resync can find the timer ahead.
+
+HourMinute::HourMinute(cilo72::ic::SD2405 &rtc, I2cDma &bus, uint32_t resyncIntervalS)
+    : rtc_(rtc)
+    , bus_(bus)
+    , resyncIntervalS_(resyncIntervalS)
+    , synced_(false)
+    , weekday_(0)
+    , syncDay_(0)
+    , syncSecond_(0)
+    , syncUs_(0)
+    , driftPpm_(0)
+    , nextMinute_(nil_time)
+    , nextResync_(nil_time)
+    , shown_(NONE)
+    , locking_(false)
+    , measureDrift_(false)
+    , lockSecond_(0)
+    , lockLo_(0)
+    , lockHi_(0)
+    , nextRead_(nil_time)
+    , rtcReads_(0)
+{
+}
+
+void HourMinute::update()
+{
+  if (locking_)
+  {
+    if (time_reached(nextRead_))
+    {
+      lockStep();
+    }
+  }
+  else if (time_reached(nextResync_))
+  {
+    startLock(not synced_);
+  }
+
+  uint64_t elapsed = (time_us_64() - syncUs_) / usPerSecond();
+  uint32_t second  = (syncSecond_ + elapsed) % SECONDS_PER_DAY;
+  uint32_t weekday = (syncDay_ + (syncSecond_ + elapsed) / SECONDS_PER_DAY) % 7;
+  uint32_t minute  = weekday * MINUTES_PER_DAY + second / 60;
+
+  // Behind the shown minute after a resync: it stays until the RTC is past it.
+  uint32_t behind = shown_ == NONE ? 0 : (shown_ + MINUTES_PER_WEEK - minute) % MINUTES_PER_WEEK;
+  if (behind > HOLD_MINUTES)
+  {
+    behind = 0;
+  }
+  if (behind == 0)
+  {
+    weekday_ = weekday;
+    shown_   = minute;
+    now_.setHour(second / 3600);
+    now_.setMinute((second / 60) % 60);
+  }
+  nextMinute_ = from_us_since_boot(syncUs_ + (elapsed + (behind + 1) * 60 - second % 60) * usPerSecond());
+}
+
+void HourMinute::resync()
+{
+  startLock(true);
+}
+
+absolute_time_t HourMinute::deadline() const
+{
+  return absolute_time_min(nextMinute(), locking_ ? nextRead_ : nextResync_);
+}
+
+absolute_time_t HourMinute::nextMinute() const
+{
+  return nextMinute_;
+}
+
+uint32_t HourMinute::secondOfDay() const
+{
+  if (not synced_)
+  {
+    return 0;
+  }
+
+  uint64_t elapsed = (time_us_64() - syncUs_) / usPerSecond();
+  return (syncSecond_ + elapsed) % SECONDS_PER_DAY;
+}
+
+void HourMinute::setWeekday(uint32_t weekday)
+{
+  uint64_t days = (syncSecond_ + secondsSinceSync(time_us_64())) / SECONDS_PER_DAY;
+  syncDay_      = (weekday % 7 + 7 - days % 7) % 7;
+  weekday_      = weekday % 7;
+  shown_        = NONE;
+}
+
+uint64_t HourMinute::secondsSinceSync(uint64_t at) const
+{
+  return at > syncUs_ ? (at - syncUs_) / usPerSecond() : 0;
+}
+
+// Moves the sync point to the RTC second read at `at` and carries the
+// weekday over: the new second lands on the day that puts it closest to
+// where the timer had the clock, which also covers reads around midnight.
+void HourMinute::rebase(uint32_t second, uint64_t at)
+{
+  if (synced_)
+  {
+    int64_t now  = int64_t(syncDay_) * SECONDS_PER_DAY + syncSecond_ + int64_t(secondsSinceSync(at));
+    int64_t days = (now - int64_t(second) + SECONDS_PER_DAY / 2) / SECONDS_PER_DAY;
+    syncDay_     = uint32_t(days % 7);
+  }
+  syncSecond_ = second;
+}
+
+uint32_t HourMinute::usPerSecond() const
+{
+  return 1000000 + driftPpm_;
+}
+
+uint32_t HourMinute::read(uint64_t &at)
+{
+  I2cDma::Claim claim(bus_, RTC_ADDRESS, I2cDma::Priority::Clock);
+  at = time_us_64();
+  cilo72::ic::SD2405::Time time = rtc_.time();
+  rtcReads_++;
+  return (uint32_t(time.hour()) * 60 + time.minute()) * 60 + time.second();
+}
+
+void HourMinute::startLock(bool adopt)
+{
+  uint64_t at;
+  uint32_t second = read(at);
+
+  // The edge into this second happened within the last second.
+  locking_      = true;
+  measureDrift_ = not adopt;
+  lockSecond_   = second;
+  lockHi_       = at;
+  lockLo_       = int64_t(at) - usPerSecond();
+
+  if (adopt)
+  {
+    // The RTC may have been set back on purpose.
+    rebase(second, at);
+    syncUs_ = at > usPerSecond() / 2 ? at - usPerSecond() / 2 : 0;
+    synced_ = true;
+    shown_  = NONE;
+  }
+
+  scheduleRead();
+}
+
+// Reads next where the middle of the edge interval lands a whole number of
+// seconds later.
+void HourMinute::scheduleRead()
+{
+  int64_t mid   = lockLo_ + (lockHi_ - lockLo_) / 2;
+  int64_t now   = time_us_64() + 1000;
+  int64_t ahead = now > mid ? (now - mid) / usPerSecond() + 1 : 1;
+  nextRead_     = from_us_since_boot(mid + ahead * usPerSecond());
+}
+
+// A read at `at` returning `ahead` seconds past lockSecond_ puts the edge
+// within (at - (ahead + 1) s, at - ahead s], whenever the read happened.
+void HourMinute::lockStep()
+{
+  uint64_t at;
+  uint32_t second = read(at);
+  int64_t ahead   = (second + SECONDS_PER_DAY - lockSecond_) % SECONDS_PER_DAY;
+  int64_t upper   = int64_t(at) - ahead * usPerSecond();
+  int64_t lower   = upper - usPerSecond();
+
+  if (upper <= lockLo_ or lower >= lockHi_)
+  {
+    // The RTC jumped, start over without trusting the drift measurement.
+    startLock(true);
+    return;
+  }
+
+  lockLo_ = lower > lockLo_ ? lower : lockLo_;
+  lockHi_ = upper < lockHi_ ? upper : lockHi_;
+
+  if (lockHi_ - lockLo_ <= LOCK_US)
+  {
+    locked(lockLo_ + (lockHi_ - lockLo_) / 2);
+  }
+  else
+  {
+    scheduleRead();
+  }
+}
+
+void HourMinute::locked(uint64_t edge)
+{
+  if (measureDrift_ and edge > syncUs_)
+  {
+    // Whole RTC seconds since the last lock, checked against the RTC count.
+    uint64_t span    = edge - syncUs_;
+    uint64_t seconds = (span + usPerSecond() / 2) / usPerSecond();
+    if (seconds > 0 and seconds % SECONDS_PER_DAY == (lockSecond_ + SECONDS_PER_DAY - syncSecond_) % SECONDS_PER_DAY)
+    {
+      int32_t ppm = int32_t(int64_t(span / seconds) - 1000000);
+      if (ppm > -MAX_DRIFT_PPM and ppm < MAX_DRIFT_PPM)
+      {
+        driftPpm_ = ppm;
+      }
+    }
+  }
+
+  rebase(lockSecond_, edge);
+  syncUs_       = edge;
+  locking_      = false;
+  measureDrift_ = false;
+  nextResync_   = from_us_since_boot(edge + uint64_t(resyncIntervalS_) * 1000000);
+}
@@ -1,8 +1,16 @@
 #pragma once
 
 #include "cilo72/ic/sd2405.h"
+#include "i2cdma.h"
+#include "pico/time.h"
 #include <stdint.h>
 
+// Keeps the time of day from the RP2040 timer and only goes to the RTC to
+// resync. A resync locks onto the RTC second edge by bisection (a handful of
+// reads spread over a few seconds), which also yields the timer drift against
+// the RTC; the drift is applied until the next resync. A resync never takes
+// the shown minute back: when the timer ran ahead past a minute rollover,
+// the minute is held until the RTC has caught up.
 class HourMinute
 {
 public:
@@ -43,19 +51,35 @@ public:
     uint8_t minute_; ///< The minute component.
   };
 
-  HourMinute(cilo72::ic::SD2405 &rtc)
-      : rtc_(rtc)
-  {
-  }
+  // The SD2405's I2C address.
+  static constexpr uint8_t RTC_ADDRESS = 0x32;
 
-  void update()
-  {
-    cilo72::ic::SD2405::Time time = rtc_.time();
-    now_.setHour(time.hour());
-    now_.setMinute(time.minute());
-  }
+  // Reads claim the bus shared with the display DMA, ahead of flushes.
+  HourMinute(cilo72::ic::SD2405 &rtc, I2cDma &bus, uint32_t resyncIntervalS = 3600);
+
+  // Recomputes the time from the timer, reads the RTC when a resync is due.
+  void update();
+
+  // Takes over the RTC time at once and locks onto it again, e.g. after the
+  // RTC was set.
+  void resync();
+
+  // When update() next has work to do: the rollover of the current minute
+  // or an RTC read.
+  absolute_time_t deadline() const;
+  absolute_time_t nextMinute() const;
+
+  uint32_t secondOfDay() const;
 
-  operator const Time &()
+  // The RTC keeps no date, the weekday (0 Monday ... 6 Sunday) is counted
+  // here from midnight rollovers and starts at Monday unless set.
+  uint32_t weekday() const { return weekday_; }
+  void setWeekday(uint32_t weekday);
+
+  int32_t driftPpm() const { return driftPpm_; }
+  uint32_t rtcReads() const { return rtcReads_; }
+
+  operator const Time &() const
   {
     return now_;
   }
@@ -63,4 +87,36 @@ public:
 private:
   Time now_;
   cilo72::ic::SD2405 &rtc_;
-};
\ No newline at end of file
+  I2cDma &bus_;
+  uint32_t resyncIntervalS_;
+
+  bool synced_;
+  uint32_t weekday_;
+  uint32_t syncDay_;            ///< Weekday of syncSecond_.
+  uint32_t syncSecond_;         ///< RTC second of day at syncUs_.
+  uint64_t syncUs_;             ///< Timer value of that RTC second edge.
+  int32_t driftPpm_;            ///< Timer rate against the RTC.
+  absolute_time_t nextMinute_;  ///< Rollover of the minute in now_.
+  absolute_time_t nextResync_;
+  uint32_t shown_;              ///< Minute of the week in now_, NONE when any may follow.
+
+  bool locking_;
+  bool measureDrift_;
+  uint32_t lockSecond_;         ///< RTC second whose edge is being located.
+  int64_t lockLo_;              ///< The edge lies in (lockLo_, lockHi_].
+  int64_t lockHi_;
+  absolute_time_t nextRead_;
+
+  uint32_t rtcReads_;
+
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  uint32_t usPerSecond() const;
+  uint64_t secondsSinceSync(uint64_t at) const;
+  void rebase(uint32_t second, uint64_t at);
+  uint32_t read(uint64_t &at);
+  void startLock(bool adopt);
+  void scheduleRead();
+  void lockStep();
+  void locked(uint64_t edge);
+};
@@ -0,0 +1,292 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "i2cdma.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "pico/time.h"
+
+I2cDma *I2cDma::instances_[2];
+
+I2cDma::I2cDma(i2c_inst_t *i2c)
+    : i2c_(i2c)
+    , channel_(dma_claim_unused_channel(true))
+    , lock_(spin_lock_init(spin_lock_claim_unused(true)))
+    , queued_(0)
+    , current_(-1)
+    , claimed_(false)
+    , claimWaiting_(false)
+    , claimAddress_(0)
+    , claimPriority_(Priority::Clock)
+    , claimSince_(0)
+    , wireSince_(0)
+    , hz_(0)
+    , sequence_(0)
+    , transfers_(0)
+    , words_(0)
+    , device_{}
+    , devices_(0)
+{
+  uint32_t index          = i2c_hw_index(i2c);
+  instances_[index]       = this;
+
+  dma_channel_config config = dma_channel_get_default_config(channel_);
+  channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+  channel_config_set_read_increment(&config, true);
+  channel_config_set_write_increment(&config, false);
+  channel_config_set_dreq(&config, index ? DREQ_I2C1_TX : DREQ_I2C0_TX);
+  dma_channel_configure(channel_, &config, &i2c_get_hw(i2c)->data_cmd, nullptr, 0, false);
+
+  // STOP_DET stays masked while no transfer runs, the blocking SDK calls
+  // poll and clear it themselves.
+  i2c_get_hw(i2c)->intr_mask = 0;
+  irq_set_exclusive_handler(index ? I2C1_IRQ : I2C0_IRQ, index ? &I2cDma::onIrq1 : &I2cDma::onIrq0);
+  irq_set_enabled(index ? I2C1_IRQ : I2C0_IRQ, true);
+}
+
+void I2cDma::setSpeed(uint8_t address, uint32_t hz)
+{
+  uint32_t status     = spin_lock_blocking(lock_);
+  find(address).hz    = hz;
+  spin_unlock(lock_, status);
+}
+
+void I2cDma::submit(uint8_t address, const uint16_t *words, uint32_t count, volatile bool &busy, Priority priority)
+{
+  static constexpr uint32_t FULL = (1 << QUEUE) - 1;
+
+  uint32_t status = spin_lock_blocking(lock_);
+  while (queued_ == FULL)
+  {
+    spin_unlock(lock_, status);
+    __wfe();
+    status = spin_lock_blocking(lock_);
+  }
+
+  uint32_t slot = 0;
+  while (queued_ & (1 << slot))
+  {
+    slot++;
+  }
+
+  busy         = true;
+  queue_[slot] = Transfer{address, priority, words, count, sequence_++, time_us_64(), false, &busy};
+  queued_      = queued_ | (1 << slot);
+  transfers_++;
+  words_ += count;
+  find(address).requests++;
+
+  schedule();
+  spin_unlock(lock_, status);
+}
+
+void I2cDma::wait()
+{
+  while (busy())
+  {
+    __wfe();
+  }
+}
+
+void I2cDma::claim(uint8_t address, Priority priority)
+{
+  uint32_t status = spin_lock_blocking(lock_);
+  claimAddress_   = address;
+  claimPriority_  = priority;
+  claimSince_     = time_us_64();
+  claimWaiting_   = true;
+
+  Device &device  = find(address);
+  device.requests++;
+  device.transactions++;
+
+  schedule();
+  while (not claimed_)
+  {
+    spin_unlock(lock_, status);
+    __wfe();
+    status = spin_lock_blocking(lock_);
+  }
+  spin_unlock(lock_, status);
+}
+
+void I2cDma::release()
+{
+  uint32_t status = spin_lock_blocking(lock_);
+  find(claimAddress_).busyUs += time_us_64() - claimSince_;
+  claimed_ = false;
+  schedule();
+  spin_unlock(lock_, status);
+  __sev();
+}
+
+uint64_t I2cDma::busyUs() const
+{
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < devices_; i++)
+  {
+    sum += device_[i].busyUs;
+  }
+  return sum;
+}
+
+// Devices beyond DEVICES share the last entry.
+I2cDma::Device &I2cDma::find(uint8_t address)
+{
+  for (uint32_t i = 0; i < devices_; i++)
+  {
+    if (device_[i].address == address)
+    {
+      return device_[i];
+    }
+  }
+  if (devices_ == DEVICES)
+  {
+    return device_[DEVICES - 1];
+  }
+  device_[devices_]         = Device{};
+  device_[devices_].address = address;
+  device_[devices_].hz      = FAST_MODE;
+  return device_[devices_++];
+}
+
+// Between transactions only, the controller is idle then.
+void I2cDma::select(uint8_t address)
+{
+  uint32_t hz = find(address).hz;
+  if (hz != hz_)
+  {
+    i2c_set_baudrate(i2c_, hz);
+    hz_ = hz;
+  }
+}
+
+// The queued transfer of the highest priority, the oldest of those.
+int32_t I2cDma::next() const
+{
+  int32_t best = -1;
+  for (uint32_t slot = 0; slot < QUEUE; slot++)
+  {
+    if (not(queued_ & (1 << slot)))
+    {
+      continue;
+    }
+    const Transfer &transfer = queue_[slot];
+    if (best < 0 or transfer.priority < queue_[best].priority or
+        (transfer.priority == queue_[best].priority and int32_t(transfer.sequence - queue_[best].sequence) < 0))
+    {
+      best = slot;
+    }
+  }
+  return best;
+}
+
+// Hands the idle bus on, with the lock held: a waiting claim wins against
+// transfers of its priority and below.
+void I2cDma::schedule()
+{
+  if (current_ >= 0 or claimed_)
+  {
+    return;
+  }
+
+  int32_t slot = next();
+  if (claimWaiting_ and (slot < 0 or claimPriority_ <= queue_[slot].priority))
+  {
+    uint64_t now   = time_us_64();
+    Device &device = find(claimAddress_);
+    uint32_t wait  = uint32_t(now - claimSince_);
+    if (wait > device.maxWaitUs)
+    {
+      device.maxWaitUs = wait;
+    }
+    select(claimAddress_);
+    claimSince_   = now;
+    claimWaiting_ = false;
+    claimed_      = true;
+    __sev();
+  }
+  else if (slot >= 0)
+  {
+    current_ = slot;
+    start(queue_[slot]);
+  }
+}
+
+// Sends the next transaction of the transfer, up to and with its STOP.
+void I2cDma::start(Transfer &transfer)
+{
+  i2c_hw_t *hw = i2c_get_hw(i2c_);
+  uint64_t now = time_us_64();
+
+  if (not transfer.started)
+  {
+    Device &device = find(transfer.address);
+    uint32_t wait  = uint32_t(now - transfer.since);
+    if (wait > device.maxWaitUs)
+    {
+      device.maxWaitUs = wait;
+    }
+    transfer.started = true;
+  }
+
+  uint32_t length = 0;
+  while (length < transfer.count and not(transfer.words[length++] & STOP))
+  {
+  }
+
+  select(transfer.address);
+  hw->enable = 0;
+  hw->tar    = transfer.address;
+  hw->enable = 1;
+  (void)hw->clr_stop_det;
+  hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS;
+
+  Device &device = find(transfer.address);
+  device.transactions++;
+  device.bytes += length;
+
+  wireSince_ = now;
+  const uint16_t *words = transfer.words;
+  transfer.words += length;
+  transfer.count -= length;
+  dma_channel_transfer_from_buffer_now(channel_, words, length);
+}
+
+void I2cDma::onIrq()
+{
+  i2c_hw_t *hw = i2c_get_hw(i2c_);
+  (void)hw->clr_stop_det;
+
+  uint32_t status    = spin_lock_blocking(lock_);
+  Transfer &transfer = queue_[current_];
+  hw->intr_mask      = 0;
+  uint64_t now       = time_us_64();
+  Device &device     = find(transfer.address);
+  device.busyUs += now - wireSince_;
+  if (transfer.count == 0)
+  {
+#if ALARM_CLOCK_PROFILE
+    device.transferUs.add(uint32_t(now - transfer.since));
+#endif
+    *transfer.busy = false;
+    queued_        = queued_ & ~(1 << current_);
+  }
+  current_ = -1;
+  schedule();
+  spin_unlock(lock_, status);
+  __sev();
+}
+
+void I2cDma::onIrq0()
+{
+  instances_[0]->onIrq();
+}
+
+void I2cDma::onIrq1()
+{
+  instances_[1]->onIrq();
+}
@@ -0,0 +1,149 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "hardware/i2c.h"
+#include "hardware/sync.h"
+#include "histogram.h"
+#include <stdint.h>
+
+// Schedules the transactions on the shared I2C bus. Prepared IC_DATA_CMD
+// words stream to the controller by DMA so that writes to the displays run
+// while the CPU goes on with the state machine; blocking SDK calls of the
+// sensor drivers go between claim() and release(). The queue is guarded by
+// a hardware spin lock, so the core that renders can submit while the
+// interrupt runs on the other.
+//
+// The bus is handed out by priority at every STOP: a transfer goes out one
+// transaction at a time, and between two of them a claim or a transfer of
+// higher priority takes over, the rest follows afterwards. Equal priorities
+// go first come, first served. Each device runs at its own clock speed.
+//
+// Per device the scheduler keeps the time it held the bus, the longest wait
+// from a request to its first byte and what went out by DMA. The blocking
+// transfers of a claim count as one transaction, their bytes are up to the
+// driver and not seen here.
+class I2cDma
+{
+public:
+  enum class Priority : uint8_t
+  {
+    Clock,      ///< RTC time and alarm.
+    Display,
+    Light,
+    Count
+  };
+
+  class Claim
+  {
+  public:
+    Claim(I2cDma &bus, uint8_t address, Priority priority) : bus_(bus) { bus_.claim(address, priority); }
+    ~Claim() { bus_.release(); }
+
+  private:
+    I2cDma &bus_;
+  };
+
+  struct Device
+  {
+    uint8_t address;
+    uint32_t hz;
+    uint32_t requests;      ///< Transfers and claims.
+    uint64_t busyUs;        ///< On the bus or claimed.
+    uint32_t maxWaitUs;
+    uint32_t transactions;  ///< Ending in a STOP, a claim counts as one.
+    uint64_t bytes;         ///< Sent by DMA.
+#if ALARM_CLOCK_PROFILE
+    Histogram transferUs;   ///< From submit to the last STOP.
+#endif
+  };
+
+  // Marks the last byte of a transaction, the controller sends a STOP after it.
+  static constexpr uint16_t STOP = I2C_IC_DATA_CMD_STOP_BITS;
+
+  // A flush and a contrast command per panel, plus the free slot.
+  static constexpr uint32_t QUEUE = 5;
+  static constexpr uint32_t DEVICES = 6;
+
+  static constexpr uint32_t FAST_MODE      = 400000;
+  static constexpr uint32_t FAST_MODE_PLUS = 1000000;
+
+  I2cDma(i2c_inst_t *i2c);
+
+  i2c_inst_t *i2c() const { return i2c_; }
+
+  // The clock for the device, FAST_MODE unless set. FAST_MODE_PLUS only for
+  // parts rated for it.
+  void setSpeed(uint8_t address, uint32_t hz);
+
+  // Queues a transfer of count words, one or more transactions each ending
+  // in a STOP. The words must stay untouched until busy is cleared, which
+  // happens from the interrupt once the last STOP went out. Waits if the
+  // queue is full; never call it while holding a claim.
+  void submit(uint8_t address, const uint16_t *words, uint32_t count, volatile bool &busy,
+              Priority priority = Priority::Display);
+
+  bool busy() const { return queued_ != 0; }
+  void wait();
+
+  // For blocking transfers to the device, from core0 only. Waits for the
+  // transaction on the wire and for transfers of higher priority.
+  void claim(uint8_t address, Priority priority);
+  void release();
+
+  uint32_t transfers() const { return transfers_; }
+  uint64_t words() const { return words_; }
+
+  // The devices seen so far, in that order.
+  uint32_t devices() const { return devices_; }
+  const Device &device(uint32_t index) const { return device_[index]; }
+
+  // Time the bus was held since boot.
+  uint64_t busyUs() const;
+
+private:
+  struct Transfer
+  {
+    uint8_t address;
+    Priority priority;
+    const uint16_t *words;
+    uint32_t count;
+    uint32_t sequence;      ///< Submission order within a priority.
+    uint64_t since;         ///< Submitted.
+    bool started;           ///< The first transaction went out.
+    volatile bool *busy;
+  };
+
+  i2c_inst_t *i2c_;
+  uint32_t channel_;
+  spin_lock_t *lock_;
+  Transfer queue_[QUEUE];
+  volatile uint32_t queued_;      ///< A bit per slot in use.
+  volatile int32_t current_;      ///< Slot with a transaction on the wire, -1 if none.
+  volatile bool claimed_;
+  volatile bool claimWaiting_;
+  uint8_t claimAddress_;
+  Priority claimPriority_;
+  uint64_t claimSince_;           ///< Requested, then granted.
+  uint64_t wireSince_;            ///< Start of the transaction on the wire.
+  uint32_t hz_;                   ///< The controller's clock, 0 until set.
+  uint32_t sequence_;
+  uint32_t transfers_;
+  uint64_t words_;
+  Device device_[DEVICES];
+  uint32_t devices_;
+
+  static I2cDma *instances_[2];
+
+  Device &find(uint8_t address);
+  void select(uint8_t address);
+  int32_t next() const;
+  void schedule();
+  void start(Transfer &transfer);
+  void onIrq();
+  static void onIrq0();
+  static void onIrq1();
+};
@@ -0,0 +1,152 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "keys.h"
+
+Keys *Keys::instance_ = nullptr;
+
+Keys::Keys(std::initializer_list<uint8_t> pins, const KeyTiming &timing)
+    : timing_(timing)
+    , count_(0)
+    , dropped_(0)
+{
+  instance_ = this;
+
+  for (uint8_t pin : pins)
+  {
+    if (count_ == MAX_KEYS)
+    {
+      break;
+    }
+
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_IN);
+    gpio_pull_up(pin);
+
+    Key &key        = keys_[count_++];
+    key.pin         = pin;
+    key.down        = not gpio_get(pin);
+    key.settling    = false;
+    key.longPressed = false;
+    key.repeats     = 0;
+    key.interval    = timing_.repeatUs;
+    key.since       = 0;
+    key.next        = 0;
+    key.alarm       = 0;
+
+    gpio_set_irq_enabled_with_callback(pin, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true, &Keys::onEdge);
+  }
+}
+
+// Edges while settling are bounce, the sample at its end picks up the level.
+void Keys::edge(Key &key)
+{
+  if (key.settling)
+  {
+    return;
+  }
+
+  bool down = not gpio_get(key.pin);
+  if (down != key.down)
+  {
+    change(key, down, time_us_64());
+  }
+}
+
+void Keys::timer(Key &key)
+{
+  uint64_t now = time_us_64();
+  key.alarm    = 0;
+
+  if (key.settling)
+  {
+    key.settling = false;
+    bool down    = not gpio_get(key.pin);
+    if (down != key.down)
+    {
+      change(key, down, now);
+      return;
+    }
+  }
+  else if (key.down)
+  {
+    if (not key.longPressed and now >= key.since + timing_.longPressUs)
+    {
+      key.longPressed = true;
+      push(key, KeyEvent::Type::LongPress, 0, now);
+    }
+
+    if (now >= key.next)
+    {
+      push(key, KeyEvent::Type::Repeat, ++key.repeats, now);
+      key.next     = now > key.next + key.interval ? now + key.interval : key.next + key.interval;
+      key.interval = key.interval - key.interval / 8;
+      key.interval = key.interval < timing_.repeatMinUs ? timing_.repeatMinUs : key.interval;
+    }
+  }
+
+  if (key.down)
+  {
+    uint64_t longPress = key.since + timing_.longPressUs;
+    schedule(key, key.longPressed or key.next < longPress ? key.next : longPress);
+  }
+}
+
+void Keys::change(Key &key, bool down, uint64_t now)
+{
+  key.down        = down;
+  key.settling    = true;
+  key.longPressed = false;
+  key.repeats     = 0;
+  key.interval    = timing_.repeatUs;
+  key.since       = now;
+  key.next        = now + timing_.repeatDelayUs;
+
+  push(key, down ? KeyEvent::Type::Press : KeyEvent::Type::Release, 0, now);
+  schedule(key, now + timing_.debounceUs);
+}
+
+void Keys::push(const Key &key, KeyEvent::Type type, uint16_t count, uint64_t now)
+{
+  KeyEvent event;
+  event.type  = type;
+  event.key   = &key - keys_;
+  event.count = count;
+  event.us    = uint32_t(now);
+
+  if (not events_.push(event))
+  {
+    dropped_++;
+  }
+  __sev();
+}
+
+void Keys::schedule(Key &key, uint64_t at)
+{
+  if (key.alarm > 0)
+  {
+    cancel_alarm(key.alarm);
+  }
+
+  alarm_id_t id = add_alarm_at(from_us_since_boot(at), &Keys::onTimer, &key, true);
+  key.alarm     = id > 0 ? id : 0;
+}
+
+void Keys::onEdge(uint gpio, uint32_t events)
+{
+  for (uint8_t i = 0; i < instance_->count_; i++)
+  {
+    if (instance_->keys_[i].pin == gpio)
+    {
+      instance_->edge(instance_->keys_[i]);
+    }
+  }
+}
+
+int64_t Keys::onTimer(alarm_id_t id, void *key)
+{
+  instance_->timer(*static_cast<Key *>(key));
+  return 0;
+}
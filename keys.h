@@ -0,0 +1,97 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "ring.h"
+#include <initializer_list>
+#include <stdint.h>
+
+struct KeyEvent
+{
+  enum class Type : uint8_t
+  {
+    None,
+    Press,
+    Release,
+    LongPress,
+    Repeat
+  };
+
+  Type type      = Type::None;
+  uint8_t key    = 0; ///< Index of the pin in the list Keys was built with.
+  uint16_t count = 0; ///< Number of this repeat while the key is held.
+  uint32_t us    = 0; ///< time_us_32() of the edge or timer that caused it.
+
+  bool is(Type t, uint8_t k) const { return type == t and key == k; }
+};
+
+struct KeyTiming
+{
+  uint32_t debounceUs    = 20000;
+  uint32_t longPressUs   = 1000000;
+  uint32_t repeatDelayUs = 500000;  ///< Hold time before the first repeat.
+  uint32_t repeatUs      = 250000;  ///< First repeat interval ...
+  uint32_t repeatMinUs   = 50000;   ///< ... shrinking by 1/8 per repeat down to this.
+};
+
+// Keys read by GPIO interrupts. An edge takes effect at once and locks the
+// key for the debounce time, after which the level is sampled again so a
+// change during the bounce is not lost. While a key is held a timer alarm
+// emits one LongPress and Repeat events at an accelerating rate.
+//
+// Events reach the main loop through a ring. The GPIO and the timer
+// interrupts run at the same priority and do not preempt each other, so
+// the ring has a single producer.
+class Keys
+{
+public:
+  static constexpr uint32_t MAX_KEYS = 4;
+
+  // Keys are active low with the internal pull-up. Only one instance can
+  // exist, the SDK has a single GPIO callback per core.
+  Keys(std::initializer_list<uint8_t> pins, const KeyTiming &timing = KeyTiming());
+
+  bool pop(KeyEvent &event) { return events_.pop(event); }
+  bool pending() const { return not events_.empty(); }
+
+  // Debounced level.
+  bool isDown(uint8_t key) const { return key < count_ and keys_[key].down; }
+
+  uint32_t dropped() const { return dropped_; }
+
+private:
+  struct Key
+  {
+    uint8_t pin;
+    volatile bool down;
+    bool settling;     ///< Within the debounce time after a change.
+    bool longPressed;
+    uint16_t repeats;
+    uint32_t interval;
+    uint64_t since;    ///< Time of the last change.
+    uint64_t next;     ///< Time of the next repeat.
+    alarm_id_t alarm;
+  };
+
+  KeyTiming timing_;
+  Key keys_[MAX_KEYS];
+  uint8_t count_;
+  SpscRing<KeyEvent, 16> events_;
+  uint32_t dropped_;
+
+  static Keys *instance_;
+
+  void edge(Key &key);
+  void timer(Key &key);
+  void change(Key &key, bool down, uint64_t now);
+  void push(const Key &key, KeyEvent::Type type, uint16_t count, uint64_t now);
+  void schedule(Key &key, uint64_t at);
+
+  static void onEdge(uint gpio, uint32_t events);
+  static int64_t onTimer(alarm_id_t id, void *key);
+};
@@ -0,0 +1,78 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "hardware/sync.h"
+#include <stdint.h>
+
+// Hands the newest value of T from one core to the other without locking.
+// The producer brackets every write with a sequence count that is odd while
+// the write is in progress; the consumer copies the value and keeps the
+// copy only if the count was even and unchanged around it. Values the
+// consumer did not get to are skipped, which suits state to be shown.
+//
+// Both sides need only loads, stores and barriers; the Cortex-M0+ has no
+// exclusive access instructions.
+template <typename T>
+class Mailbox
+{
+public:
+  Mailbox()
+      : sequence_(0)
+      , taken_(0)
+      , retries_(0)
+  {
+  }
+
+  // Producer side. Wakes the other core out of WFE.
+  void publish(const T &value)
+  {
+    uint32_t sequence = sequence_;
+    sequence_         = sequence + 1;
+    __dmb();
+    value_ = value;
+    __dmb();
+    sequence_ = sequence + 2;
+    __sev();
+  }
+
+  // Consumer side. Copies the newest value if it was not taken yet.
+  bool take(T &value)
+  {
+    while (true)
+    {
+      uint32_t sequence = sequence_;
+      if (sequence == taken_)
+      {
+        return false;
+      }
+
+      if ((sequence & 1) == 0)
+      {
+        __dmb();
+        value = value_;
+        __dmb();
+        if (sequence_ == sequence)
+        {
+          taken_ = sequence;
+          return true;
+        }
+      }
+      retries_++;
+    }
+  }
+
+  bool fresh() const { return sequence_ != taken_; }
+
+  // Copies the consumer had to repeat because a write was in progress.
+  uint32_t retries() const { return retries_; }
+
+private:
+  T value_;
+  volatile uint32_t sequence_; ///< Written by the producer only.
+  uint32_t taken_;             ///< Sequence of the last value taken, consumer only.
+  uint32_t retries_;
+};
@@ -5,83 +5,103 @@
 
 #include "menu.h"
 
-Menu::Menu(cilo72::ic::SSD1306 &oled, const cilo72::fonts::Font &font)
-    : oled_(oled), font_(font), index_(0)
+Menu::Menu(const MenuItem *items, uint32_t count, const Font &font)
+    : font_(font), depth_(0)
 {
-}
-
-void Menu::add(MenuItem *item)
-{
-    items_.push_back(item);
+    levels_[0].items = items;
+    levels_[0].count = uint8_t(count);
 }
 
 void Menu::reset()
 {
-    index_ = 0;
-    updateSelect();
+    depth_           = 0;
+    levels_[0].index = 0;
+    levels_[0].top   = 0;
 }
 
 void Menu::up()
 {
-    if (index_ > 0)
+    View &l = level();
+    if (l.index > 0)
     {
-        index_--;
+        l.index--;
+    }
+    if (l.index < l.top)
+    {
+        l.top = l.index;
     }
-
-    updateSelect();
 }
 
 void Menu::down()
 {
-    if (index_ < (items_.size() - 1))
+    View &l = level();
+    if (l.index + 1 < l.count)
     {
-        index_++;
+        l.index++;
+    }
+    if (l.index >= l.top + rows())
+    {
+        l.top = l.index - rows() + 1;
     }
-    updateSelect();
 }
 
-const MenuItem *Menu::selected() const
+bool Menu::enter()
 {
-    uint32_t i = 0;
-    for (auto item : items_)
+    const MenuItem &item = selected();
+    if (item.type() != MenuItem::Type::Submenu or depth_ + 1 >= DEPTH)
     {
-        if (i == index_)
-        {
-            return item;
-        }
-        i++;
+        return false;
     }
-    return items_.front();
+
+    depth_++;
+    levels_[depth_]       = View();
+    levels_[depth_].items = item.items();
+    levels_[depth_].count = uint8_t(item.count());
+    return true;
 }
 
-void Menu::draw()
+bool Menu::leave()
 {
-    int x = 2;
-    int y = 1;
-    constexpr uint32_t scale = 2;
-    oled_.clear();
-    for (auto item : items_)
+    if (depth_ == 0)
     {
-        if (item->isSelected())
-        {
-            oled_.drawSquare(x, y, oled_.width(), font_.height() * scale, cilo72::ic::SSD1306::Color::White);
-            oled_.drawString(x, y, scale, item->text(), cilo72::ic::SSD1306::Color::Black, font_);
-        }
-        else
+        return false;
+    }
+
+    depth_--;
+    return true;
+}
+
+void Menu::draw(Layer &layer, const View &view, const View &shown, uint32_t width, const Font &font)
+{
+    if (view.items != shown.items or view.top != shown.top)
+    {
+        layer.clear(0, 0, width, Layer::HEIGHT);
+        for (uint32_t row = 0; row < rows(font) and view.top + row < view.count; row++)
         {
-            oled_.drawString(x, y, scale, item->text(), cilo72::ic::SSD1306::Color::White, font_);
+            drawRow(layer, view, row, width, font);
         }
-        y += font_.height() * scale;
     }
-    oled_.update();
+    else if (view.index != shown.index)
+    {
+        drawRow(layer, view, shown.index - view.top, width, font);
+        drawRow(layer, view, view.index - view.top, width, font);
+    }
 }
 
-void Menu::updateSelect()
+void Menu::drawRow(Layer &layer, const View &view, uint32_t row, uint32_t width, const Font &font)
 {
-    uint32_t i = 0;
-    for (auto item : items_)
+    const MenuItem &item = view.items[view.top + row];
+    int32_t x            = 2;
+    int32_t y            = row * rowHeight(font);
+
+    layer.drawSquare(0, y, width, rowHeight(font), Layer::Color::Black);
+    if (view.top + row == view.index)
+    {
+        layer.drawSquare(x, y, width - x, rowHeight(font), Layer::Color::White);
+        layer.drawString(x, y, SCALE, item.text(), Layer::Color::Black, font);
+    }
+    else
     {
-        item->select(i == index_);
-        i++;
+        layer.drawString(x, y, SCALE, item.text(), Layer::Color::White, font);
     }
 }
@@ -6,24 +6,68 @@
 #pragma once
 
 #include "menuitem.h"
-#include "cilo72/ic/ssd1306.h"
-#include "cilo72/fonts/font_8x5.h"
-#include <list>
+#include "compositor.h"
+#include "font.h"
+
+// Navigates a MenuItem tree. The rows that do not fit on the panel scroll
+// into view with the selection. Drawing is separate from navigation: draw()
+// paints a View, which is what the core that renders gets to see.
 class Menu
 {
 public:
-    Menu(cilo72::ic::SSD1306 &oled, const cilo72::fonts::Font &font = cilo72::fonts::Font8x5());
-    void add(MenuItem *item);
+    static constexpr uint32_t DEPTH = 4;
+    static constexpr uint32_t SCALE = 2;
+
+    // One level of the tree as shown.
+    struct View
+    {
+        const MenuItem *items = nullptr;
+        uint8_t count         = 0;
+        uint8_t index         = 0;
+        uint8_t top           = 0;  ///< Entry shown in the first row.
+
+        bool operator==(const View &rhs) const
+        {
+            return items == rhs.items and count == rhs.count and index == rhs.index and top == rhs.top;
+        }
+    };
+
+    template <size_t N>
+    Menu(const MenuItem (&items)[N], const Font &font = font8x5)
+        : Menu(items, N, font)
+    {
+    }
+
+    Menu(const MenuItem *items, uint32_t count, const Font &font = font8x5);
+
+    // Back to the first entry of the top level.
     void reset();
     void up();
     void down();
-    const MenuItem *selected() const;
-    void draw();
+    const MenuItem &selected() const { return view().items[view().index]; }
+    const View &view() const { return levels_[depth_]; }
+
+    // Opens the selected submenu. False if the selection is no submenu or the
+    // tree is deeper than DEPTH.
+    bool enter();
+    // Returns to the parent menu, false on the top level.
+    bool leave();
+
+    // Paints view over shown, which the layer holds, in the columns from 0
+    // to width. Only the rows whose selection changed are repainted unless
+    // the level or the scroll position differ.
+    static void draw(Layer &layer, const View &view, const View &shown, uint32_t width = Oled::WIDTH,
+                     const Font &font = font8x5);
 
 private:
-    cilo72::ic::SSD1306 &oled_;
-    const cilo72::fonts::Font &font_;
-    std::list<MenuItem *> items_;
-    uint32_t index_;
-    void updateSelect();
-};
\ No newline at end of file
+    const Font &font_;
+    View levels_[DEPTH];
+    uint32_t depth_;
+
+    View &level() { return levels_[depth_]; }
+    uint32_t rows() const { return rows(font_); }
+
+    static uint32_t rowHeight(const Font &font) { return font.height() * SCALE; }
+    static uint32_t rows(const Font &font) { return Layer::HEIGHT / rowHeight(font); }
+    static void drawRow(Layer &layer, const View &view, uint32_t row, uint32_t width, const Font &font);
+};
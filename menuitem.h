@@ -5,18 +5,54 @@
 
 #pragma once
 
-#include "state.h"
+#include <stddef.h>
+#include <stdint.h>
+#include "statemachinecommand.h"
 
+// One entry of a menu tree. Trees are built from constant arrays and stay in
+// flash. An entry issues a state machine command, opens a submenu or leads
+// back to the parent menu.
 class MenuItem
 {
   public:
-    MenuItem(const char * text, State * next = nullptr);
+    enum class Type : uint8_t
+    {
+        Command,
+        Submenu,
+        Up
+    };
+
+    constexpr MenuItem(const char * text, StateMachineCommand command)
+    : text_(text), type_(Type::Command), command_(command), items_(nullptr), count_(0)
+    {
+    }
+
+    template <size_t N>
+    constexpr MenuItem(const char * text, const MenuItem (&items)[N])
+    : text_(text), type_(Type::Submenu), command_(), items_(items), count_(N)
+    {
+    }
+
+    static constexpr MenuItem up(const char * text)
+    {
+        return MenuItem(text, Type::Up);
+    }
+
     const char * text() const { return text_; }
-    bool isSelected() const { return selected_; }
-    void select(bool value)  { selected_ = value; }
-    State * next() const { return next_; }
+    Type type() const { return type_; }
+    StateMachineCommand command() const { return command_; }
+    const MenuItem * items() const { return items_; }
+    uint32_t count() const { return count_; }
+
   private:
+    constexpr MenuItem(const char * text, Type type)
+    : text_(text), type_(type), command_(), items_(nullptr), count_(0)
+    {
+    }
+
     const char * text_;
-    bool selected_;
-    State * next_;
+    Type type_;
+    StateMachineCommand command_;
+    const MenuItem * items_;
+    uint8_t count_;
 };
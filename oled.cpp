@@ -0,0 +1,230 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "oled.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+Oled::Oled(I2cDma &bus, uint8_t address)
+    : bus_(bus)
+    , address_(address)
+    , full_(true)
+    , flushBusy_(false)
+    , commandBusy_(false)
+    , lastFlushBytes_(0)
+    , flushes_(0)
+    , flushBytes_(0)
+{
+  memset(buffer_, 0, sizeof(buffer_));
+  memset(shown_, 0, sizeof(shown_));
+  init();
+  invalidate();
+  update();
+}
+
+void Oled::init()
+{
+  static constexpr uint8_t sequence[] = {
+      0xAE,       // display off
+      0xD5, 0x80, // clock divide
+      0xA8, 0x3F, // multiplex 64
+      0xD3, 0x00, // display offset
+      0x40,       // start line 0
+      0x8D, 0x14, // charge pump on
+      0x20, 0x00, // horizontal addressing
+      0xA1,       // segment remap
+      0xC8,       // COM scan descending
+      0xDA, 0x12, // COM pins
+      0x81, 0xCF, // contrast
+      0xD9, 0xF1, // pre-charge
+      0xDB, 0x40, // VCOMH deselect
+      0xA4,       // display follows RAM
+      0xA6,       // not inverted
+      0x2E,       // no scrolling
+      0xAF,       // display on
+  };
+
+  command(sequence, sizeof(sequence));
+}
+
+void Oled::contrast(uint8_t value)
+{
+  wait(commandBusy_);
+  commandTx_[0] = 0x00;
+  commandTx_[1] = 0x81;
+  commandTx_[2] = value | I2cDma::STOP;
+  bus_.submit(address_, commandTx_, 3, commandBusy_);
+}
+
+void Oled::invalidate()
+{
+  full_ = true;
+  for (uint32_t page = 0; page < PAGES; page++)
+  {
+    dirtyFirst_[page] = 0;
+    dirtyLast_[page]  = WIDTH - 1;
+  }
+}
+
+void Oled::update()
+{
+  flushAsync();
+  waitFlush();
+}
+
+void Oled::waitFlush()
+{
+  wait(flushBusy_);
+}
+
+void Oled::wait(volatile bool &busy)
+{
+  while (busy)
+  {
+    __wfe();
+  }
+}
+
+void Oled::flushAsync()
+{
+  wait(flushBusy_);
+
+  int32_t first[PAGES];
+  int32_t last[PAGES];
+
+  // Shrink each page's range to the bytes that really differ from the panel.
+  for (uint32_t page = 0; page < PAGES; page++)
+  {
+    first[page] = dirtyFirst_[page];
+    last[page]  = dirtyLast_[page];
+
+    if (not full_)
+    {
+      while (first[page] <= last[page] and buffer_[page][first[page]] == shown_[page][first[page]])
+      {
+        first[page]++;
+      }
+      while (last[page] >= first[page] and buffer_[page][last[page]] == shown_[page][last[page]])
+      {
+        last[page]--;
+      }
+    }
+
+    dirtyFirst_[page] = WIDTH - 1;
+    dirtyLast_[page]  = 0;
+  }
+  full_ = false;
+
+  // Group pages into one window while the bytes a merged window sends in
+  // addition cost less than another transaction would, up to CHUNK bytes.
+  uint16_t *p    = tx_;
+  uint32_t stops = 0;
+  uint32_t bytes = 0;
+  uint32_t page  = 0;
+  while (page < PAGES)
+  {
+    if (first[page] > last[page])
+    {
+      page++;
+      continue;
+    }
+
+    int32_t firstColumn  = first[page];
+    int32_t lastColumn   = last[page];
+    uint32_t firstPage   = page;
+    uint32_t lastPage    = page;
+    uint32_t separate    = TRANSACTION_OVERHEAD + lastColumn - firstColumn + 1;
+
+    for (uint32_t next = page + 1; next < PAGES; next++)
+    {
+      if (first[next] > last[next])
+      {
+        continue;
+      }
+
+      int32_t f       = first[next] < firstColumn ? first[next] : firstColumn;
+      int32_t l       = last[next] > lastColumn ? last[next] : lastColumn;
+      uint32_t data   = (l - f + 1) * (next - firstPage + 1);
+      uint32_t merged = TRANSACTION_OVERHEAD + data;
+      uint32_t apart  = separate + TRANSACTION_OVERHEAD + last[next] - first[next] + 1;
+
+      if (merged > apart or data > CHUNK)
+      {
+        break;
+      }
+
+      firstColumn = f;
+      lastColumn  = l;
+      lastPage    = next;
+      separate    = merged;
+    }
+
+    bytes += window(p, firstColumn, lastColumn, firstPage, lastPage);
+    stops++;
+    page = lastPage + 1;
+  }
+
+  // A flush with nothing changed sends nothing and is not counted.
+  if (stops > 0)
+  {
+    bus_.submit(address_, tx_, p - tx_, flushBusy_);
+    lastFlushBytes_ = bytes;
+    flushBytes_ += bytes;
+    flushes_++;
+  }
+}
+
+void Oled::write(uint32_t page, uint32_t column, uint8_t value)
+{
+  if (buffer_[page][column] != value)
+  {
+    buffer_[page][column] = value;
+    if (column < dirtyFirst_[page])
+    {
+      dirtyFirst_[page] = column;
+    }
+    if (column > dirtyLast_[page])
+    {
+      dirtyLast_[page] = column;
+    }
+  }
+}
+
+// Only for init(), before any transfer went to the DMA.
+void Oled::command(const uint8_t *commands, uint32_t length)
+{
+  uint8_t tx[32];
+  tx[0] = 0x00;
+  memcpy(&tx[1], commands, length);
+  I2cDma::Claim claim(bus_, address_, I2cDma::Priority::Display);
+  i2c_write_blocking(bus_.i2c(), address_, tx, length + 1, false);
+}
+
+// Appends one transaction for the window to the transmit words, the panel
+// counts as showing it from here on.
+uint32_t Oled::window(uint16_t *&p, uint32_t firstColumn, uint32_t lastColumn, uint32_t firstPage, uint32_t lastPage)
+{
+  uint16_t *start = p;
+  *p++ = 0x80; *p++ = 0x21;
+  *p++ = 0x80; *p++ = uint16_t(firstColumn);
+  *p++ = 0x80; *p++ = uint16_t(lastColumn);
+  *p++ = 0x80; *p++ = 0x22;
+  *p++ = 0x80; *p++ = uint16_t(firstPage);
+  *p++ = 0x80; *p++ = uint16_t(lastPage);
+  *p++ = 0x40;
+
+  uint32_t columns = lastColumn - firstColumn + 1;
+  for (uint32_t page = firstPage; page <= lastPage; page++)
+  {
+    for (uint32_t column = firstColumn; column <= lastColumn; column++)
+    {
+      *p++ = buffer_[page][column];
+    }
+    memcpy(&shown_[page][firstColumn], &buffer_[page][firstColumn], columns);
+  }
+  p[-1] |= I2cDma::STOP;
+
+  return p - start + 1;
+}
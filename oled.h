@@ -0,0 +1,90 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "i2cdma.h"
+#include <stdint.h>
+
+// SSD1306 128x64 panel on I2C with a local framebuffer, which a Compositor
+// fills. Writing records per page the column range that changed; a flush
+// compares that range against what the panel already shows and sends only
+// the differing bytes, using column/page address windows so unchanged parts
+// never go over the bus.
+//
+// Flushes are double buffered: flushAsync() copies the changed windows into
+// a transmit buffer and hands that to the I2C DMA, so drawing the next frame
+// can start right away while the last one is still going out.
+class Oled
+{
+public:
+  static constexpr uint32_t WIDTH  = 128;
+  static constexpr uint32_t HEIGHT = 64;
+  static constexpr uint32_t PAGES  = HEIGHT / 8;
+
+  Oled(I2cDma &bus, uint8_t address);
+
+  uint32_t width() const { return WIDTH; }
+  uint32_t height() const { return HEIGHT; }
+  uint8_t address() const { return address_; }
+
+  // One byte of the framebuffer: 8 rows of a column, the top one in bit 0.
+  void write(uint32_t page, uint32_t column, uint8_t value);
+  void contrast(uint8_t value);
+
+  // Starts sending what changed since the last flush and returns at once.
+  // Waits only if the previous flush of this panel is still in flight.
+  void flushAsync();
+  bool flushing() const { return flushBusy_; }
+  // A flush or a command is in flight, the next one would wait.
+  bool busy() const { return flushBusy_ or commandBusy_; }
+  void waitFlush();
+
+  // Blocking flush, returns when the panel shows the framebuffer.
+  void update();
+
+  // Forgets what the panel shows, the next update() sends the whole frame.
+  void invalidate();
+
+  const uint8_t *page(uint32_t page) const { return buffer_[page]; }
+
+  uint32_t lastFlushBytes() const { return lastFlushBytes_; }
+  uint32_t flushes() const { return flushes_; }
+  uint64_t flushBytes() const { return flushBytes_; }
+
+private:
+  // Window setup in front of the data: Co=1 command pairs for the column and
+  // page address, then the data control byte.
+  static constexpr uint32_t WINDOW_OVERHEAD = 13;
+
+  // Every transaction also costs its address byte.
+  static constexpr uint32_t TRANSACTION_OVERHEAD = WINDOW_OVERHEAD + 1;
+
+  // Data bytes per window at most. The bus scheduler can hand the bus to
+  // the RTC between two windows, so a flush holds it up for a page at most.
+  static constexpr uint32_t CHUNK = WIDTH;
+
+  I2cDma &bus_;
+  uint8_t address_;
+  uint8_t buffer_[PAGES][WIDTH];
+  uint8_t shown_[PAGES][WIDTH];   ///< What the panel holds since the last update().
+  uint8_t dirtyFirst_[PAGES];     ///< Changed columns per page, first > last if clean.
+  uint8_t dirtyLast_[PAGES];
+  bool full_;
+
+  uint16_t tx_[PAGES * WINDOW_OVERHEAD + PAGES * WIDTH];  ///< IC_DATA_CMD words of the flush in flight.
+  uint16_t commandTx_[3];
+  volatile bool flushBusy_;
+  volatile bool commandBusy_;
+
+  uint32_t lastFlushBytes_;
+  uint32_t flushes_;
+  uint64_t flushBytes_;
+
+  void init();
+  void command(const uint8_t *commands, uint32_t length);
+  uint32_t window(uint16_t *&p, uint32_t firstColumn, uint32_t lastColumn, uint32_t firstPage, uint32_t lastPage);
+  static void wait(volatile bool &busy);
+};
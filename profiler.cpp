@@ -0,0 +1,173 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "profiler.h"
+
+#if ALARM_CLOCK_PROFILE
+
+#include <string.h>
+
+namespace
+{
+  const char *const PHASES[] = {"enter", "run", "exit"};
+
+  class CsvWriter
+  {
+  public:
+    CsvWriter(FILE *out) : out_(out) {}
+
+    void record(const char *kind) { fputs(kind, out_); }
+    void text(const char *s) { fprintf(out_, ",%s", s); }
+    void number(uint64_t value) { fprintf(out_, ",%llu", (unsigned long long)value); }
+    void end() { fputc('\n', out_); }
+
+  private:
+    FILE *out_;
+  };
+
+  class BinaryWriter
+  {
+  public:
+    BinaryWriter(FILE *out) : out_(out)
+    {
+      fputs("ACP", out_);
+      fputc(Profiler::VERSION, out_);
+    }
+
+    void record(const char *kind) { fputc(kind[0], out_); }
+
+    void text(const char *s)
+    {
+      size_t length = strlen(s);
+      number(length);
+      fwrite(s, 1, length, out_);
+    }
+
+    void number(uint64_t value)
+    {
+      while (value >= 0x80)
+      {
+        fputc(uint8_t(value) | 0x80, out_);
+        value >>= 7;
+      }
+      fputc(uint8_t(value), out_);
+    }
+
+    void end() {}
+
+  private:
+    FILE *out_;
+  };
+
+  template <typename Writer>
+  void histogram(Writer &writer, const char *name, const Histogram &histogram)
+  {
+    writer.record("hist");
+    writer.text(name);
+    writer.number(histogram.count());
+    writer.number(histogram.sumUs());
+    writer.number(histogram.maxUs());
+    for (uint32_t i = 0; i < Histogram::BUCKETS; i++)
+    {
+      writer.number(histogram.bucket(i));
+    }
+    writer.end();
+  }
+}
+
+Profiler::Profiler(const AlarmClock &alarmClock, const I2cDma &i2cDma, const DfPlayer &dfPlayer,
+                   const Oled &left, const Oled &right, const Renderer &renderer)
+    : alarmClock_(alarmClock)
+    , i2cDma_(i2cDma)
+    , dfPlayer_(dfPlayer)
+    , left_(left)
+    , right_(right)
+    , renderer_(renderer)
+    , loop_()
+{
+}
+
+void Profiler::dumpCsv(FILE *out) const
+{
+  CsvWriter writer(out);
+  dump(writer);
+  fflush(out);
+}
+
+void Profiler::dumpBinary(FILE *out) const
+{
+  BinaryWriter writer(out);
+  dump(writer);
+  fflush(out);
+}
+
+// The counters are read while the other core and the interrupts go on, a
+// record may be a pass or a transfer behind the next one.
+template <typename Writer>
+void Profiler::dump(Writer &writer) const
+{
+  char name[48];
+
+  histogram(writer, "loop", loop_);
+  for (uint8_t state = 0; state < alarmClock_.states(); state++)
+  {
+    for (uint8_t phase = 0; phase < uint8_t(StatePhase::Count); phase++)
+    {
+      snprintf(name, sizeof(name), "state.%s.%s", alarmClock_.stateName(state), PHASES[phase]);
+      histogram(writer, name, alarmClock_.stateProfile(state, StatePhase(phase)));
+    }
+  }
+
+  for (uint32_t i = 0; i < i2cDma_.devices(); i++)
+  {
+    const I2cDma::Device &device = i2cDma_.device(i);
+    snprintf(name, sizeof(name), "i2c.0x%02x.transfer", device.address);
+    histogram(writer, name, device.transferUs);
+
+    writer.record("i2c");
+    writer.number(device.address);
+    writer.number(device.requests);
+    writer.number(device.transactions);
+    writer.number(device.bytes);
+    writer.number(device.busyUs);
+    writer.number(device.maxWaitUs);
+    writer.end();
+  }
+
+  writer.record("uart");
+  writer.text("dfplayer");
+  writer.number(dfPlayer_.sent());
+  writer.number(dfPlayer_.coalesced());
+  writer.number(dfPlayer_.timeouts());
+  writer.number(dfPlayer_.failed());
+  writer.number(dfPlayer_.dropped());
+  writer.end();
+
+  const Oled *const displays[] = {&left_, &right_};
+  const char *const sides[]    = {"left", "right"};
+  for (uint32_t i = 0; i < 2; i++)
+  {
+    writer.record("display");
+    writer.text(sides[i]);
+    writer.number(displays[i]->address());
+    writer.number(displays[i]->flushes());
+    writer.number(displays[i]->flushBytes());
+    writer.end();
+  }
+
+  writer.record("transition");
+  writer.number(renderer_.transitionSteps());
+  writer.number(renderer_.droppedSteps());
+  writer.end();
+
+  writer.record("alarm");
+  writer.number(alarmClock_.alarmAudio().latencyUs());
+  writer.end();
+
+  writer.record("end");
+  writer.end();
+}
+
+#endif
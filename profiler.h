@@ -0,0 +1,66 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "histogram.h"
+
+#if ALARM_CLOCK_PROFILE
+
+#include <stdio.h>
+#include "alarmclock.h"
+#include "i2cdma.h"
+#include "dfplayer.h"
+#include "oled.h"
+#include "renderer.h"
+
+// Reports where the time goes, on request over USB serial: the Shell's
+// profile command dumps CSV or the same records in binary. tools/profile.py
+// reads either and plots them.
+//
+// CSV, one record per line:
+//   hist,<name>,<count>,<sum us>,<max us>,<bucket 0>,...,<bucket 15>
+//   i2c,<address>,<requests>,<transactions>,<bytes>,<busy us>,<max wait us>
+//   uart,dfplayer,<sent>,<coalesced>,<timeouts>,<failed>,<dropped>
+//   display,<left|right>,<address>,<flushes>,<bytes>
+//   transition,<steps>,<dropped>
+//   alarm,<latency us>
+//   end
+// The histograms are loop, state.<name>.<enter|run|exit> and
+// i2c.<address>.transfer; for a display the latter are its flushes and
+// contrast commands from submit to the last STOP. The alarm latency is from
+// the last alarm to the answer to the command that started its sound.
+//
+// Binary: "ACP" and VERSION, then each record as its first letter and the
+// fields, numbers as unsigned LEB128 and text as its length and characters.
+class Profiler
+{
+public:
+  static constexpr uint8_t VERSION = 3;
+
+  Profiler(const AlarmClock &alarmClock, const I2cDma &i2cDma, const DfPlayer &dfPlayer,
+           const Oled &left, const Oled &right, const Renderer &renderer);
+
+  // A pass of the main loop took us.
+  void loop(uint32_t us) { loop_.add(us); }
+  const Histogram &loops() const { return loop_; }
+
+  void dumpCsv(FILE *out) const;
+  void dumpBinary(FILE *out) const;
+
+private:
+  const AlarmClock &alarmClock_;
+  const I2cDma &i2cDma_;
+  const DfPlayer &dfPlayer_;
+  const Oled &left_;
+  const Oled &right_;
+  const Renderer &renderer_;
+  Histogram loop_;
+
+  template <typename Writer>
+  void dump(Writer &writer) const;
+};
+
+#endif
@@ -0,0 +1,421 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "renderer.h"
+#include "timeset.h"
+#include <stdio.h>
+
+Renderer::Renderer(Mailbox<Frame> &frames, Oled &left, Oled &right, cilo72::ic::WS2812 &pixels)
+    : mailbox_(frames)
+    , canvas_(left, right)
+    , pixels_(pixels)
+    , shownBrightness_(-1)
+    , nextStep_(at_the_end_of_time)
+    , shownContrast_(-1)
+    , shownAlarmOn_(false)
+    , clockDigits_(nullptr)
+    , ticked_(false)
+    , digits_{}
+    , transitionEpoch_(0)
+    , transitionStep_(0)
+    , nextTransition_(at_the_end_of_time)
+    , transitionSteps_(0)
+    , droppedSteps_(0)
+    , frames_(0)
+{
+  shownLeft_.view  = Frame::View::None;
+  shownRight_.view = Frame::View::None;
+
+  // Drawn once, left of the hour; showing it only composes the layer again.
+  Layer &marks = canvas_.layer(ZMarks);
+  marks.setVisible(false);
+  marks.drawSquare(0, 0, 33, 11, Layer::Color::Black);
+  marks.drawString(2, 2, 1, "ALARM");
+}
+
+// Layers are drawn as soon as a frame arrives, only the commits wait.
+bool Renderer::run()
+{
+  bool fresh      = mailbox_.take(next_);
+  bool step       = time_reached(nextStep_);
+  bool transition = time_reached(nextTransition_);
+  bool done       = fresh or step or transition;
+
+  if (fresh)
+  {
+    frames_++;
+
+    ticked_ = ticked();
+    if (not sameLeft(next_, shownLeft_))
+    {
+      drawLeft();
+    }
+    if (not sameRight(next_, shownRight_))
+    {
+      drawRight();
+    }
+    drawMarks();
+  }
+
+  if (transition)
+  {
+    stepTransitions(time_us_64());
+  }
+
+  if (canvas_.commit())
+  {
+    done = true;
+  }
+
+  Oled &left  = canvas_.panel(0);
+  Oled &right = canvas_.panel(1);
+  if (next_.contrast != shownContrast_ and not left.busy() and not right.busy())
+  {
+    left.contrast(next_.contrast);
+    right.contrast(next_.contrast);
+    shownContrast_ = next_.contrast;
+    done           = true;
+  }
+
+  if (fresh or step)
+  {
+    stepPixels(time_us_64());
+  }
+
+  if (not samePixels())
+  {
+    updatePixels();
+  }
+
+  return done;
+}
+
+bool Renderer::pending() const
+{
+  return canvas_.damaged() or next_.contrast != shownContrast_ or not samePixels() or transitioning();
+}
+
+absolute_time_t Renderer::deadline() const
+{
+  return absolute_time_min(absolute_time_min(nextStep_, nextTransition_), canvas_.deadline());
+}
+
+void Renderer::drawLeft()
+{
+  Layer &layer = canvas_.layer(ZView);
+  if (next_.view != Frame::View::Clock)
+  {
+    digits_[0].active = false;
+    digits_[1].active = false;
+  }
+
+  switch (next_.view)
+  {
+  case Frame::View::Clock:
+    drawClock(0, 40, next_.hour, shownLeft_.hour);
+    break;
+
+  case Frame::View::Menu:
+  case Frame::View::TimeSet:
+  {
+    // Repaints only the rows that changed if the panel shows the menu.
+    bool menu = shownLeft_.view == Frame::View::Menu or shownLeft_.view == Frame::View::TimeSet;
+    Menu::draw(layer, next_.menu, menu ? shownLeft_.menu : Menu::View());
+  }
+  break;
+
+  case Frame::View::Volume:
+    layer.clear(0, 0, Oled::WIDTH, Layer::HEIGHT);
+    layer.drawString(40, 1, 8, "-");
+    break;
+
+  case Frame::View::Snooze:
+    layer.clear(0, 0, Oled::WIDTH, Layer::HEIGHT);
+    layer.drawString(10, 22, 3, "Snooze");
+    break;
+
+  case Frame::View::None:
+    break;
+  }
+
+  shownLeft_ = next_;
+}
+
+void Renderer::drawRight()
+{
+  char s[20];
+  Layer &layer = canvas_.layer(ZView);
+  if (next_.view != Frame::View::Clock)
+  {
+    digits_[2].active = false;
+    digits_[3].active = false;
+  }
+
+  switch (next_.view)
+  {
+  case Frame::View::Clock:
+    drawClock(2, RIGHT + 1, next_.minute, shownRight_.minute);
+    break;
+
+  case Frame::View::Menu:
+    layer.clear(RIGHT, 0, Oled::WIDTH, Layer::HEIGHT);
+    break;
+
+  case Frame::View::TimeSet:
+    TimeSet::draw(layer, RIGHT, next_.hour, next_.minute, next_.digit);
+    break;
+
+  case Frame::View::Volume:
+    layer.clear(RIGHT, 0, Oled::WIDTH, Layer::HEIGHT);
+    layer.drawString(RIGHT + 1, 1, 8, "+");
+    break;
+
+  case Frame::View::Snooze:
+    sprintf(s, "%i:%02i", next_.minute, next_.second);
+    layer.clear(RIGHT, 0, Oled::WIDTH, Layer::HEIGHT);
+    layer.drawString(RIGHT + 1, 18, 4, s);
+    break;
+
+  case Frame::View::None:
+    break;
+  }
+
+  shownRight_ = next_;
+}
+
+void Renderer::drawMarks()
+{
+  bool alarmOn = next_.alarmOn and next_.view == Frame::View::Clock;
+  if (alarmOn != shownAlarmOn_)
+  {
+    canvas_.layer(ZMarks).setVisible(alarmOn);
+    shownAlarmOn_ = alarmOn;
+  }
+}
+
+const Glyphs &Renderer::clockDigits() const
+{
+  return clockDigits_ ? *clockDigits_ : *font8x5.scaled(8);
+}
+
+// The two digits of value from x on, digits_[first] and the one after. When
+// the clock moved on by a minute, those that differ from what is shown start
+// over to the new one with the frame's transition; anything else, such as the
+// alarm time shown while its key is held, is drawn at once and ends their
+// transitions. So does a panel that has not taken the old digits yet, as at
+// boot.
+void Renderer::drawClock(uint32_t first, int32_t x, uint8_t value, uint8_t shownValue)
+{
+  char s[4];
+  char was[4];
+  sprintf(s, "%02i", value);
+  sprintf(was, "%02i", shownValue);
+  const Glyphs &glyphs = clockDigits();
+
+  uint32_t panel = first / 2;
+  bool moving    = digits_[first].active or digits_[first + 1].active;
+  bool settled   = not canvas_.damaged(panel) and not canvas_.panel(panel).busy();
+  if (next_.transition == Transition::None or not ticked_ or not(moving or settled))
+  {
+    Layer &layer = canvas_.layer(ZView);
+    layer.clear(panel * RIGHT, 0, Oled::WIDTH, Layer::HEIGHT);
+    layer.drawString(x, 1, glyphs, s);
+    digits_[first].active     = false;
+    digits_[first + 1].active = false;
+    return;
+  }
+
+  if (not transitioning())
+  {
+    transitionEpoch_ = time_us_64();
+    transitionStep_  = 0;
+  }
+  uint32_t step = uint32_t((time_us_64() - transitionEpoch_) / STEP_US);
+
+  for (uint32_t i = 0; i < 2; i++)
+  {
+    Digit &digit = digits_[first + i];
+    char shownDigit = digit.active ? digit.to : was[i];
+    if (s[i] != shownDigit)
+    {
+      // One in transition already goes on from its target.
+      digit = Digit{x + int32_t(i * glyphs.advance()), shownDigit, s[i], step, true};
+      drawDigit(digit, 0);
+      nextTransition_ = from_us_since_boot(transitionEpoch_ + (step + 1) * STEP_US);
+    }
+  }
+}
+
+void Renderer::drawDigit(const Digit &digit, uint32_t step)
+{
+  Layer &layer         = canvas_.layer(ZView);
+  const Glyphs &glyphs = clockDigits();
+  char from[2]         = {digit.from, 0};
+  char to[2]           = {digit.to, 0};
+
+  layer.clear(digit.x, 0, glyphs.width(), Layer::HEIGHT);
+  switch (next_.transition)
+  {
+  case Transition::Roll:
+  {
+    int32_t offset = Layer::HEIGHT * step / STEPS;
+    layer.drawString(digit.x, 1 - offset, glyphs, from);
+    layer.drawString(digit.x, 1 + Layer::HEIGHT - offset, glyphs, to);
+  }
+  break;
+
+  case Transition::Dither:
+  {
+    uint32_t pattern = Layer::dither(Layer::DITHER_LEVELS * step / STEPS);
+    layer.drawString(digit.x, 1, glyphs, from, Layer::Color::White, ~pattern);
+    layer.drawString(digit.x, 1, glyphs, to, Layer::Color::White, pattern);
+  }
+  break;
+
+  case Transition::None:
+    layer.drawString(digit.x, 1, glyphs, to);
+    break;
+  }
+}
+
+// Draws the step of the transition clock that is due. A panel still damaged
+// from the step before never showed it.
+void Renderer::stepTransitions(uint64_t now)
+{
+  uint32_t step = uint32_t((now - transitionEpoch_) / STEP_US);
+  if (step > transitionStep_ + 1)
+  {
+    droppedSteps_ += step - transitionStep_ - 1;
+  }
+  transitionStep_ = step;
+
+  for (uint32_t panel = 0; panel < Compositor::PANELS; panel++)
+  {
+    if ((digits_[2 * panel].active or digits_[2 * panel + 1].active) and canvas_.damaged(panel))
+    {
+      droppedSteps_++;
+    }
+  }
+
+  for (Digit &digit : digits_)
+  {
+    if (digit.active)
+    {
+      uint32_t progress = step - digit.start < STEPS ? step - digit.start : STEPS;
+      drawDigit(digit, progress);
+      digit.active = progress < STEPS;
+    }
+  }
+  transitionSteps_++;
+
+  nextTransition_ = transitioning() ? from_us_since_boot(transitionEpoch_ + (step + 1) * STEP_US) : at_the_end_of_time;
+}
+
+// The clock view shows the minute after the one on the panels.
+bool Renderer::ticked() const
+{
+  static constexpr uint32_t DAY = 24 * 60;
+
+  if (next_.view != Frame::View::Clock or shownLeft_.view != Frame::View::Clock or
+      shownRight_.view != Frame::View::Clock)
+  {
+    return false;
+  }
+  return (shownLeft_.hour * 60u + shownRight_.minute + 1) % DAY == next_.hour * 60u + next_.minute;
+}
+
+bool Renderer::transitioning() const
+{
+  for (const Digit &digit : digits_)
+  {
+    if (digit.active)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Brings colours_ to now and finds the next step of the running animations.
+void Renderer::stepPixels(uint64_t now)
+{
+  nextStep_ = at_the_end_of_time;
+  for (uint32_t i = 0; i < Frame::PIXELS; i++)
+  {
+    const Animation &animation = next_.animations[i];
+    if (animation.active())
+    {
+      colours_[i] = animation.at(now);
+      nextStep_   = absolute_time_min(nextStep_, animation.nextStep(now));
+    }
+    else
+    {
+      colours_[i] = next_.pixels[i];
+    }
+  }
+}
+
+// An animation step that leaves every pixel as it is sends nothing.
+bool Renderer::samePixels() const
+{
+  if (next_.brightness != shownBrightness_)
+  {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < Frame::PIXELS; i++)
+  {
+    if (colours_[i] != shownColours_[i])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Renderer::updatePixels()
+{
+  for (uint32_t i = 0; i < Frame::PIXELS; i++)
+  {
+    pixels_.set(i, colours_[i].r, colours_[i].g, colours_[i].b);
+    shownColours_[i] = colours_[i];
+  }
+  pixels_.setBrightness(next_.brightness);
+  pixels_.update();
+  shownBrightness_ = next_.brightness;
+}
+
+// Menu and TimeSet both keep the menu on the left panel.
+bool Renderer::sameLeft(const Frame &a, const Frame &b)
+{
+  bool menuA = a.view == Frame::View::Menu or a.view == Frame::View::TimeSet;
+  bool menuB = b.view == Frame::View::Menu or b.view == Frame::View::TimeSet;
+
+  if (menuA and menuB)
+  {
+    return a.menu == b.menu;
+  }
+  return a.view == b.view and (a.view != Frame::View::Clock or a.hour == b.hour);
+}
+
+bool Renderer::sameRight(const Frame &a, const Frame &b)
+{
+  if (a.view != b.view)
+  {
+    return false;
+  }
+
+  switch (a.view)
+  {
+  case Frame::View::Clock:
+    return a.minute == b.minute;
+  case Frame::View::TimeSet:
+    return a.hour == b.hour and a.minute == b.minute and a.digit == b.digit;
+  case Frame::View::Snooze:
+    return a.minute == b.minute and a.second == b.second;
+  default:
+    return true;
+  }
+}
@@ -0,0 +1,123 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "cilo72/ic/ws2812.h"
+#include "frame.h"
+#include "mailbox.h"
+#include "compositor.h"
+#include <stdint.h>
+
+// Runs on core1 and owns the panels and the pixels: takes the newest Frame
+// from the mailbox and brings each of them to it. The panels form one
+// canvas of a Compositor, the left one at column 0 and the right one at
+// RIGHT. The view of a frame is drawn into its bottom layer, marks such as
+// the alarm indicator into the layer above it. The compositor commits a
+// panel when its half changed, its last transfer is through and the frame
+// rate allows, so run() never waits on the bus. Pixel animations step on
+// core1 alone: deadline() says when the next step or commit is due, core0
+// publishes nothing and may sleep meanwhile.
+class Renderer
+{
+public:
+  // A digit of the clock that changes goes over to the new one with the
+  // transition of the frame. Only the changing digits are drawn again, at
+  // TRANSITION_FPS, and the compositor sends only their columns.
+  using Transition = Frame::Transition;
+
+  // A step redraws 40x64 pixels per digit, 320 bytes or 7.2 ms of the bus at
+  // 400 kHz; four digits changing at once still fit into a step at 30 fps.
+  static constexpr uint32_t TRANSITION_MS  = 300;
+  static constexpr uint32_t TRANSITION_FPS = 30;
+
+  Renderer(Mailbox<Frame> &frames, Oled &left, Oled &right, cilo72::ic::WS2812 &pixels);
+
+  // One pass. False if there was nothing to do, the caller may then sleep
+  // until the next event.
+  bool run();
+
+  // The newest frame is not completely shown yet.
+  bool pending() const;
+
+  // The next animation step or a commit held back by the frame rate,
+  // at_the_end_of_time when neither is due.
+  absolute_time_t deadline() const;
+
+  // The digits of the clock, font8x5 at scale 8 if nullptr. Before core1
+  // starts only.
+  void setClockDigits(const Glyphs *digits) { clockDigits_ = digits; }
+
+  // Transition steps drawn, and those that never made it to a panel: core1
+  // ran late and skipped them, or the panel had not taken the step before.
+  uint32_t transitionSteps() const { return transitionSteps_; }
+  uint32_t droppedSteps() const { return droppedSteps_; }
+
+  uint32_t frames() const { return frames_; }
+  Compositor &canvas() { return canvas_; }
+
+private:
+  // Layers of the canvas, bottom to top.
+  enum Z : uint32_t
+  {
+    ZView,
+    ZMarks
+  };
+
+  static constexpr int32_t RIGHT = Oled::WIDTH;
+
+  // Two digits per panel, the left one first.
+  static constexpr uint32_t DIGITS = 4;
+  static constexpr uint32_t STEPS  = TRANSITION_MS * TRANSITION_FPS / 1000;
+  static constexpr uint64_t STEP_US = 1000000 / TRANSITION_FPS;
+
+  // A digit of the clock in transition.
+  struct Digit
+  {
+    int32_t x;
+    char from;
+    char to;
+    uint32_t start;     ///< Step of the transition clock it started at.
+    bool active;
+  };
+
+  Mailbox<Frame> &mailbox_;
+  Compositor canvas_;
+  cilo72::ic::WS2812 &pixels_;
+
+  Frame next_;
+  Frame shownLeft_;        ///< The frame the left half of the view was last drawn from.
+  Frame shownRight_;
+  Frame::Pixel colours_[Frame::PIXELS];       ///< The pixels of next_ at the last step.
+  Frame::Pixel shownColours_[Frame::PIXELS];
+  int16_t shownBrightness_;                   ///< -1 until the first update.
+  absolute_time_t nextStep_;
+  int16_t shownContrast_;  ///< -1 until the first contrast command.
+  bool shownAlarmOn_;      ///< The alarm indicator is visible.
+  const Glyphs *clockDigits_;
+  bool ticked_;                       ///< The frame taken moves the clock on by a minute.
+  Digit digits_[DIGITS];
+  uint64_t transitionEpoch_;          ///< Step 0 of the transition clock, reset when all digits stand still.
+  uint32_t transitionStep_;           ///< The last step drawn.
+  absolute_time_t nextTransition_;
+  uint32_t transitionSteps_;
+  uint32_t droppedSteps_;
+  uint32_t frames_;
+
+  void drawLeft();
+  void drawRight();
+  void drawMarks();
+  const Glyphs &clockDigits() const;
+  void drawClock(uint32_t first, int32_t x, uint8_t value, uint8_t shownValue);
+  void drawDigit(const Digit &digit, uint32_t step);
+  void stepTransitions(uint64_t now);
+  bool ticked() const;
+  bool transitioning() const;
+  void stepPixels(uint64_t now);
+  bool samePixels() const;
+  void updatePixels();
+  static bool sameLeft(const Frame &a, const Frame &b);
+  static bool sameRight(const Frame &a, const Frame &b);
+};
@@ -0,0 +1,65 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "hardware/sync.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Lock-free ring for one producer and one consumer, e.g. an interrupt
+// handing data to the main loop. Each side writes only its own index; the
+// barrier orders the slot against the index that publishes or frees it.
+template <typename T, size_t N>
+class SpscRing
+{
+  static_assert(N >= 2 and (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+  SpscRing()
+      : head_(0)
+      , tail_(0)
+  {
+  }
+
+  // Producer side. False when the ring is full, the value is then dropped.
+  bool push(const T &value)
+  {
+    uint32_t head = head_;
+    if (head - tail_ == N)
+    {
+      return false;
+    }
+
+    slots_[head & (N - 1)] = value;
+    __dmb();
+    head_ = head + 1;
+    return true;
+  }
+
+  // Consumer side.
+  bool pop(T &value)
+  {
+    uint32_t tail = tail_;
+    if (head_ == tail)
+    {
+      return false;
+    }
+
+    __dmb();
+    value = slots_[tail & (N - 1)];
+    __dmb();
+    tail_ = tail + 1;
+    return true;
+  }
+
+  bool empty() const { return head_ == tail_; }
+  size_t size() const { return head_ - tail_; }
+
+private:
+  T slots_[N];
+  volatile uint32_t head_; ///< Next slot to fill, written by the producer.
+  volatile uint32_t tail_; ///< Next slot to read, written by the consumer.
+};
@@ -0,0 +1,38 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "scheduler.h"
+#include "shell.h"
+#include "hardware/sync.h"
+
+Scheduler::Scheduler(const Keys &keys, const DfPlayer &dfPlayer, const Shell *shell)
+    : keys_(keys)
+    , dfPlayer_(dfPlayer)
+    , shell_(shell)
+    , wakeups_(0)
+{
+}
+
+bool Scheduler::pending() const
+{
+  return keys_.pending() or dfPlayer_.pending() or (shell_ and shell_->pending());
+}
+
+void Scheduler::sleepUntil(absolute_time_t deadline)
+{
+  if (pending() or time_reached(deadline))
+  {
+    return;
+  }
+
+  // Other interrupts (debounce timers, USB traffic) also end a WFE, only
+  // the deadline, a key event, a player answer or shell input hands control
+  // back to the state machine.
+  while (not pending() and not best_effort_wfe_or_timeout(deadline))
+  {
+  }
+
+  wakeups_++;
+}
@@ -0,0 +1,36 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "pico/stdlib.h"
+#include "keys.h"
+#include "dfplayer.h"
+#include <stdint.h>
+
+class Shell;
+
+// Puts the core to sleep between state machine passes. It wakes at the
+// deadline the current state declares, when a key event is pending, when
+// the player answered or when input for the shell arrived; debouncing,
+// repeats and UART and USB reception run from interrupts, so there is
+// nothing to poll.
+class Scheduler
+{
+public:
+  Scheduler(const Keys &keys, const DfPlayer &dfPlayer, const Shell *shell = nullptr);
+
+  void sleepUntil(absolute_time_t deadline);
+
+  uint32_t wakeups() const { return wakeups_; }
+
+private:
+  const Keys &keys_;
+  const DfPlayer &dfPlayer_;
+  const Shell *shell_;
+  uint32_t wakeups_;
+
+  bool pending() const;
+};
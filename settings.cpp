@@ -0,0 +1,155 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "settings.h"
+
+Settings::Settings(FlashStore &store, AlarmClock &alarmClock, DfPlayer &dfPlayer)
+    : store_(store)
+    , alarmClock_(alarmClock)
+    , dfPlayer_(dfPlayer)
+    , changed_(nil_time)
+{
+  restore();
+  for (uint8_t key = 0; key < Count; key++)
+  {
+    seen_[key] = value(key);
+  }
+}
+
+uint32_t Settings::value(uint8_t key) const
+{
+  if (key == Transition)
+  {
+    return uint32_t(alarmClock_.transition());
+  }
+
+  if (key >= Brightness0)
+  {
+    const Ambient::Brightness &brightness = alarmClock_.ambient().brightness(key - Brightness0);
+    return brightness.oled | brightness.pixel << 8;
+  }
+
+  if (key >= Alarm0)
+  {
+    uint32_t index = key - Alarm0;
+    if (index >= alarmClock_.alarms().count())
+    {
+      return 0;
+    }
+    const Alarms::Alarm &alarm = alarmClock_.alarms().alarm(index);
+    return alarm.hour | alarm.minute << 8 | alarm.weekdays << 16 | uint32_t(alarm.flags) << 24;
+  }
+
+  const AlarmAudio &audio = alarmClock_.alarmAudio();
+  switch (key)
+  {
+    case Volume:     return dfPlayer_.volume();
+    case AlarmOn:    return alarmClock_.alarmOn();
+    case Sunrise:    return alarmClock_.sunriseMinutes();
+    case Snooze:     return alarmClock_.snoozeMinutes();
+    case Snoozes:    return alarmClock_.maxSnoozes();
+    case Prewarm:    return audio.prewarmSeconds();
+    case Ramp:       return audio.rampSeconds() | uint32_t(audio.curve()) << 16;
+    case AlarmCount: return alarmClock_.alarms().count();
+    default:         return 0;
+  }
+}
+
+// The alarms replace the one the RTC seeded, once there are stored ones.
+void Settings::restore()
+{
+  AlarmAudio &audio = alarmClock_.alarmAudio();
+  if (store_.has(Volume))
+  {
+    dfPlayer_.setVolume(store_.get(Volume));
+  }
+  if (store_.has(AlarmOn))
+  {
+    alarmClock_.setAlarmOn(store_.get(AlarmOn));
+  }
+  if (store_.has(Sunrise))
+  {
+    alarmClock_.setSunriseMinutes(store_.get(Sunrise));
+  }
+  if (store_.has(Snooze))
+  {
+    alarmClock_.setSnoozeMinutes(store_.get(Snooze));
+  }
+  if (store_.has(Snoozes))
+  {
+    alarmClock_.setMaxSnoozes(store_.get(Snoozes));
+  }
+  if (store_.has(Prewarm))
+  {
+    audio.setPrewarmSeconds(store_.get(Prewarm));
+  }
+  if (store_.has(Ramp))
+  {
+    uint32_t ramp = store_.get(Ramp);
+    audio.setRamp(ramp & 0xFFFF, AlarmAudio::Curve(ramp >> 16));
+  }
+
+  if (store_.has(AlarmCount))
+  {
+    while (alarmClock_.alarms().count() > 0)
+    {
+      alarmClock_.removeAlarm(alarmClock_.alarms().count() - 1);
+    }
+    uint32_t count = store_.get(AlarmCount);
+    for (uint32_t i = 0; i < count and i < Alarms::CAPACITY; i++)
+    {
+      uint32_t packed = store_.get(Alarm0 + i);
+      alarmClock_.addAlarm({uint8_t(packed), uint8_t(packed >> 8), uint8_t(packed >> 16), uint8_t(packed >> 24)});
+    }
+  }
+
+  for (uint8_t level = 0; level < Ambient::LEVELS; level++)
+  {
+    if (store_.has(Brightness0 + level))
+    {
+      uint32_t packed = store_.get(Brightness0 + level);
+      alarmClock_.setBrightness(level, {uint8_t(packed), uint8_t(packed >> 8)});
+    }
+  }
+
+  if (store_.has(Transition) and store_.get(Transition) <= uint32_t(Frame::Transition::Dither))
+  {
+    alarmClock_.setTransition(Frame::Transition(store_.get(Transition)));
+  }
+}
+
+void Settings::run()
+{
+  if (not alarmClock_.quiet())
+  {
+    return;
+  }
+
+  for (uint8_t key = 0; key < Count; key++)
+  {
+    uint32_t now = value(key);
+    if (now != seen_[key])
+    {
+      seen_[key] = now;
+      store_.set(key, now);
+      changed_   = get_absolute_time();
+    }
+  }
+
+  if (store_.dirty() and time_reached(delayed_by_ms(changed_, DELAY_MS)))
+  {
+    store_.flush();
+  }
+}
+
+// While the clock is not quiet, whatever ends that wakes the loop anyway.
+absolute_time_t Settings::deadline() const
+{
+  if (not store_.dirty() or not alarmClock_.quiet())
+  {
+    return at_the_end_of_time;
+  }
+  return delayed_by_ms(changed_, DELAY_MS);
+}
@@ -0,0 +1,62 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "pico/time.h"
+#include "alarmclock.h"
+#include "dfplayer.h"
+#include "flashstore.h"
+
+// What the user sets and the RTC does not keep, in a FlashStore: the
+// volume, the alarm switch, the alarms, sunrise, snooze, prewarm and ramp,
+// the brightness curve and the digit transition. The constructor puts back
+// what was stored; the rest keeps its default and is only written once it
+// changes.
+//
+// run() compares the settings against what it saw last and hands changes
+// to the store. They are written once nothing changed for DELAY_MS and the
+// clock is quiet(), so a menu visit goes out as one batch and a flash erase
+// never holds up an alarm; a change while the alarm rings waits for it.
+class Settings
+{
+public:
+  static constexpr uint32_t DELAY_MS = 5000;
+
+  Settings(FlashStore &store, AlarmClock &alarmClock, DfPlayer &dfPlayer);
+
+  void run();
+  absolute_time_t deadline() const;
+
+  const FlashStore &store() const { return store_; }
+
+private:
+  // Each value fits a key of the store, packed a byte a field, low first.
+  enum Key : uint8_t
+  {
+    Volume,
+    AlarmOn,
+    Sunrise,
+    Snooze,
+    Snoozes,
+    Prewarm,
+    Ramp,         ///< Seconds in 16 bits, then the curve.
+    AlarmCount,
+    Alarm0,       ///< Hour, minute, weekdays, flags; one key per alarm.
+    Brightness0   = Alarm0 + Alarms::CAPACITY,   ///< Contrast, pixel; one key per level.
+    Transition    = Brightness0 + Ambient::LEVELS,
+    Count
+  };
+  static_assert(Count <= FlashStore::KEYS, "the store has a key for each setting");
+
+  FlashStore &store_;
+  AlarmClock &alarmClock_;
+  DfPlayer &dfPlayer_;
+  uint32_t seen_[Count];
+  absolute_time_t changed_;
+
+  uint32_t value(uint8_t key) const;
+  void restore();
+};
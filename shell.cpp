@@ -0,0 +1,631 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "shell.h"
+#include "pico/stdlib.h"
+#include <string.h>
+
+namespace
+{
+  // In the order of AlarmClock::Key, AlarmAudio::Curve and Frame::Transition.
+  const char *const KEYS[]        = {"plus", "minus", "alarm", "enter"};
+  const char *const CURVES[]      = {"linear", "quadratic", "cubic"};
+  const char *const TRANSITIONS[] = {"none", "roll", "dither"};
+  const char DAYS[]               = "MTWTFSS";
+
+  int32_t find(const char *const *names, uint32_t count, const char *name)
+  {
+    for (uint32_t i = 0; i < count; i++)
+    {
+      if (strcmp(names[i], name) == 0)
+      {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  // A decimal number up to max.
+  bool number(const char *s, uint32_t max, uint32_t &value)
+  {
+    uint32_t n = 0;
+    if (*s == 0)
+    {
+      return false;
+    }
+    for (; *s; s++)
+    {
+      if (*s < '0' or *s > '9')
+      {
+        return false;
+      }
+      n = n * 10 + uint32_t(*s - '0');
+      if (n > max)
+      {
+        return false;
+      }
+    }
+    value = n;
+    return true;
+  }
+
+  // HH:MM or HH:MM:SS.
+  bool clock(const char *s, uint32_t &hour, uint32_t &minute, uint32_t &second)
+  {
+    uint32_t fields[3] = {0, 0, 0};
+    uint32_t count     = 0;
+    uint32_t digits    = 0;
+    for (;; s++)
+    {
+      if (*s >= '0' and *s <= '9' and digits < 2)
+      {
+        fields[count] = fields[count] * 10 + uint32_t(*s - '0');
+        digits++;
+      }
+      else if (digits > 0 and (*s == 0 or (*s == ':' and count < 2)))
+      {
+        count++;
+        digits = 0;
+        if (*s == 0)
+        {
+          break;
+        }
+      }
+      else
+      {
+        return false;
+      }
+    }
+    hour   = fields[0];
+    minute = fields[1];
+    second = fields[2];
+    return count >= 2 and hour < 24 and minute < 60 and second < 60;
+  }
+
+  bool days(const char *s, uint8_t &weekdays)
+  {
+    if (strcmp(s, "any") == 0)
+    {
+      weekdays = 0;
+      return true;
+    }
+    if (strlen(s) != 7)
+    {
+      return false;
+    }
+    weekdays = 0;
+    for (uint32_t day = 0; day < 7; day++)
+    {
+      if ((s[day] & ~0x20) == DAYS[day])
+      {
+        weekdays |= 1 << day;
+      }
+      else if (s[day] != '-')
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool flags(char *s, uint8_t &value)
+  {
+    value = 0;
+    if (strcmp(s, "-") == 0)
+    {
+      return true;
+    }
+    for (char *flag = strtok(s, ","); flag; flag = strtok(nullptr, ","))
+    {
+      if (strcmp(flag, "enabled") == 0)
+      {
+        value |= Alarms::Alarm::Enabled;
+      }
+      else if (strcmp(flag, "oneshot") == 0)
+      {
+        value |= Alarms::Alarm::OneShot;
+      }
+      else if (strcmp(flag, "skipnext") == 0)
+      {
+        value |= Alarms::Alarm::SkipNext;
+      }
+      else
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+Shell::Shell(AlarmClock &alarmClock, DfPlayer &dfPlayer, const I2cDma &i2cDma, const Renderer &renderer, FILE *out)
+    : alarmClock_(alarmClock)
+    , dfPlayer_(dfPlayer)
+    , i2cDma_(i2cDma)
+    , renderer_(renderer)
+    , out_(out)
+#if ALARM_CLOCK_PROFILE
+    , profiler_(nullptr)
+#endif
+    , length_(0)
+    , overflow_(false)
+    , input_(false)
+    , commands_(0)
+    , errors_(0)
+{
+  stdio_set_chars_available_callback(&Shell::onChars, this);
+}
+
+Shell::~Shell()
+{
+  stdio_set_chars_available_callback(nullptr, nullptr);
+}
+
+// Called from the USB interrupt.
+void Shell::onChars(void *shell)
+{
+  static_cast<Shell *>(shell)->input_ = true;
+}
+
+void Shell::poll()
+{
+  input_ = false;
+  int c;
+  while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT)
+  {
+    if (feed(char(c)))
+    {
+      // More may be waiting, the next pass takes it.
+      input_ = true;
+      return;
+    }
+  }
+}
+
+bool Shell::feed(char c)
+{
+  if (c == '\b' or c == 0x7F)
+  {
+    length_ -= length_ > 0 ? 1 : 0;
+    return false;
+  }
+  if (c != '\r' and c != '\n')
+  {
+    if (length_ + 1 < LINE)
+    {
+      line_[length_++] = c;
+    }
+    else
+    {
+      overflow_ = true;
+    }
+    return false;
+  }
+
+  line_[length_] = 0;
+  char *argv[ARGS];
+  uint32_t argc = 0;
+  bool tooMany  = false;
+  for (char *arg = strtok(line_, " \t"); arg; arg = strtok(nullptr, " \t"))
+  {
+    tooMany = argc == ARGS;
+    if (tooMany)
+    {
+      break;
+    }
+    argv[argc++] = arg;
+  }
+  bool overflow = overflow_;
+  length_       = 0;
+  overflow_     = false;
+
+  // Blank lines, also the \n of a \r\n.
+  if (argc == 0 and not overflow)
+  {
+    return false;
+  }
+
+  const char *error = overflow ? "line too long" : tooMany ? "too many arguments" : run(argc, argv);
+  commands_++;
+  if (error)
+  {
+    errors_++;
+    fprintf(out_, "error: %s\n", error);
+  }
+  else
+  {
+    fputs("ok\n", out_);
+  }
+  fflush(out_);
+  return true;
+}
+
+const char *Shell::run(uint32_t argc, char **argv)
+{
+  const char *command = argv[0];
+  if (strcmp(command, "help") == 0)
+  {
+    fputs("time [HH:MM[:SS] [weekday]]\n"
+          "alarm [on|off]\n"
+          "alarm <n> HH:MM [MTWTFSS|any] [enabled,oneshot,skipnext|-]\n"
+          "alarm <n> delete\n"
+          "volume [0-30]\n"
+          "brightness [<level> <contrast> <pixel>]\n"
+          "set [sunrise|snooze|snoozes|prewarm|ramp|curve|transition <value>]\n"
+          "stats\n"
+          "key plus|minus|alarm|enter [click|press|release|long|repeat]\n"
+          "profile csv|binary\n",
+          out_);
+    return nullptr;
+  }
+  if (strcmp(command, "time") == 0)
+  {
+    return time(argc, argv);
+  }
+  if (strcmp(command, "alarm") == 0)
+  {
+    return alarm(argc, argv);
+  }
+  if (strcmp(command, "volume") == 0)
+  {
+    return volume(argc, argv);
+  }
+  if (strcmp(command, "brightness") == 0)
+  {
+    return brightness(argc, argv);
+  }
+  if (strcmp(command, "set") == 0)
+  {
+    return set(argc, argv);
+  }
+  if (strcmp(command, "stats") == 0 and argc == 1)
+  {
+    return stats();
+  }
+  if (strcmp(command, "key") == 0)
+  {
+    return key(argc, argv);
+  }
+  if (strcmp(command, "profile") == 0)
+  {
+    return profile(argc, argv);
+  }
+  return "unknown command, see help";
+}
+
+const char *Shell::time(uint32_t argc, char **argv)
+{
+  if (argc > 3)
+  {
+    return "usage: time [HH:MM[:SS] [weekday]]";
+  }
+  if (argc > 1)
+  {
+    uint32_t hour, minute, second, weekday = 0;
+    if (not clock(argv[1], hour, minute, second))
+    {
+      return "not a time of day";
+    }
+    if (argc == 3 and not number(argv[2], 6, weekday))
+    {
+      return "weekday is 0 (Monday) to 6";
+    }
+    alarmClock_.setTime(cilo72::ic::SD2405::Time(hour, minute, second));
+    if (argc == 3)
+    {
+      alarmClock_.setWeekday(weekday);
+    }
+  }
+
+  const HourMinute &hm = alarmClock_.hourMinute();
+  uint32_t second      = hm.secondOfDay();
+  fprintf(out_, "time %02u:%02u:%02u weekday %u\n", unsigned(second / 3600), unsigned(second / 60 % 60),
+          unsigned(second % 60), unsigned(hm.weekday()));
+  return nullptr;
+}
+
+void Shell::printAlarm(uint32_t index)
+{
+  const Alarms::Alarm &alarm = alarmClock_.alarms().alarm(index);
+
+  char days[8] = "any";
+  if (alarm.weekdays)
+  {
+    for (uint32_t day = 0; day < 7; day++)
+    {
+      days[day] = alarm.weekdays & (1 << day) ? DAYS[day] : '-';
+    }
+    days[7] = 0;
+  }
+
+  char flags[24] = "";
+  const char *const names[] = {"enabled", "oneshot", "skipnext"};
+  for (uint32_t bit = 0; bit < 3; bit++)
+  {
+    if (alarm.flags & (1 << bit))
+    {
+      strcat(flags, flags[0] ? "," : "");
+      strcat(flags, names[bit]);
+    }
+  }
+
+  fprintf(out_, "alarm %u %02u:%02u %s %s\n", unsigned(index), alarm.hour, alarm.minute, days,
+          flags[0] ? flags : "-");
+}
+
+const char *Shell::alarm(uint32_t argc, char **argv)
+{
+  const Alarms &alarms = alarmClock_.alarms();
+
+  if (argc == 1)
+  {
+    for (uint32_t i = 0; i < alarms.count(); i++)
+    {
+      printAlarm(i);
+    }
+    fprintf(out_, "alarm %s\n", alarmClock_.alarmOn() ? "on" : "off");
+    return nullptr;
+  }
+  if (argc == 2 and (strcmp(argv[1], "on") == 0 or strcmp(argv[1], "off") == 0))
+  {
+    alarmClock_.setAlarmOn(strcmp(argv[1], "on") == 0);
+    fprintf(out_, "alarm %s\n", argv[1]);
+    return nullptr;
+  }
+
+  uint32_t index;
+  if (argc < 3 or argc > 5 or not number(argv[1], alarms.count(), index))
+  {
+    return "usage: alarm <n> HH:MM [days] [flags], n up to the number of alarms";
+  }
+
+  if (strcmp(argv[2], "delete") == 0 and argc == 3)
+  {
+    // The menu and the RTC alarm register always work on the first one.
+    if (index == alarms.count() or alarms.count() == 1)
+    {
+      return "no such alarm or the last one";
+    }
+    alarmClock_.removeAlarm(index);
+    return nullptr;
+  }
+
+  Alarms::Alarm alarm = index < alarms.count() ? alarms.alarm(index)
+                                                : Alarms::Alarm{0, 0, Alarms::EVERY_DAY, Alarms::Alarm::Enabled};
+  uint32_t hour, minute, second;
+  if (not clock(argv[2], hour, minute, second))
+  {
+    return "not a time of day";
+  }
+  alarm.hour   = uint8_t(hour);
+  alarm.minute = uint8_t(minute);
+  alarm.flags |= Alarms::Alarm::Enabled;
+  if (argc > 3 and not days(argv[3], alarm.weekdays))
+  {
+    return "days are MTWTFSS with - for a day off, or any";
+  }
+  if (argc > 4 and not flags(argv[4], alarm.flags))
+  {
+    return "flags are enabled, oneshot and skipnext, or -";
+  }
+
+  if (index == alarms.count())
+  {
+    int32_t added = alarmClock_.addAlarm(alarm);
+    if (added < 0)
+    {
+      return "all alarms are taken";
+    }
+    index = added;
+  }
+  else
+  {
+    alarmClock_.setAlarm(index, alarm);
+  }
+  printAlarm(index);
+  return nullptr;
+}
+
+const char *Shell::volume(uint32_t argc, char **argv)
+{
+  uint32_t volume;
+  if (argc > 2 or (argc == 2 and not number(argv[1], DfPlayer::MAX_VOLUME, volume)))
+  {
+    return "usage: volume [0-30]";
+  }
+  if (argc == 2)
+  {
+    dfPlayer_.setVolume(volume);
+  }
+  fprintf(out_, "volume %d\n", int(dfPlayer_.volume()));
+  return nullptr;
+}
+
+const char *Shell::brightness(uint32_t argc, char **argv)
+{
+  const Ambient &ambient = alarmClock_.ambient();
+
+  if (argc == 1)
+  {
+    for (uint32_t level = 0; level < Ambient::LEVELS; level++)
+    {
+      fprintf(out_, "brightness %u %u %u\n", unsigned(level), ambient.brightness(level).oled,
+              ambient.brightness(level).pixel);
+    }
+    return nullptr;
+  }
+
+  uint32_t level, contrast, pixel;
+  if (argc != 4 or not number(argv[1], Ambient::LEVELS - 1, level) or not number(argv[2], 255, contrast) or
+      not number(argv[3], 15, pixel))
+  {
+    return "usage: brightness <level 0-15> <contrast 0-255> <pixel 0-15>";
+  }
+  alarmClock_.setBrightness(level, Ambient::Brightness{uint8_t(contrast), uint8_t(pixel)});
+  fprintf(out_, "brightness %u %u %u\n", unsigned(level), unsigned(contrast), unsigned(pixel));
+  return nullptr;
+}
+
+const char *Shell::set(uint32_t argc, char **argv)
+{
+  AlarmAudio &audio = alarmClock_.alarmAudio();
+
+  if (argc == 3)
+  {
+    const char *name = argv[1];
+    uint32_t value;
+    int32_t curve      = find(CURVES, 3, argv[2]);
+    int32_t transition = find(TRANSITIONS, 3, argv[2]);
+    if (strcmp(name, "curve") == 0)
+    {
+      if (curve < 0)
+      {
+        return "curve is linear, quadratic or cubic";
+      }
+      audio.setRamp(audio.rampSeconds(), AlarmAudio::Curve(curve));
+    }
+    else if (strcmp(name, "transition") == 0)
+    {
+      if (transition < 0)
+      {
+        return "transition is none, roll or dither";
+      }
+      alarmClock_.setTransition(Frame::Transition(transition));
+    }
+    else if (strcmp(name, "ramp") == 0 and number(argv[2], 3600, value))
+    {
+      audio.setRamp(value, audio.curve());
+    }
+    else if (not number(argv[2], 255, value))
+    {
+      return "usage: set <name> <value>";
+    }
+    else if (strcmp(name, "sunrise") == 0)
+    {
+      alarmClock_.setSunriseMinutes(value);
+    }
+    else if (strcmp(name, "snooze") == 0)
+    {
+      alarmClock_.setSnoozeMinutes(value);
+    }
+    else if (strcmp(name, "snoozes") == 0)
+    {
+      alarmClock_.setMaxSnoozes(value);
+    }
+    else if (strcmp(name, "prewarm") == 0)
+    {
+      audio.setPrewarmSeconds(value);
+    }
+    else
+    {
+      return "settings are sunrise, snooze, snoozes, prewarm, ramp, curve and transition";
+    }
+  }
+  else if (argc != 1)
+  {
+    return "usage: set [<name> <value>]";
+  }
+
+  // What the setters made of the values.
+  fprintf(out_,
+          "sunrise %u\nsnooze %u\nsnoozes %u\nprewarm %u\nramp %u\ncurve %s\ntransition %s\n",
+          alarmClock_.sunriseMinutes(), alarmClock_.snoozeMinutes(), alarmClock_.maxSnoozes(),
+          audio.prewarmSeconds(), audio.rampSeconds(), CURVES[uint8_t(audio.curve())],
+          TRANSITIONS[uint8_t(alarmClock_.transition())]);
+  return nullptr;
+}
+
+const char *Shell::stats()
+{
+  const HourMinute &hm   = alarmClock_.hourMinute();
+  const Ambient &ambient = alarmClock_.ambient();
+
+  fprintf(out_, "state %s\n", alarmClock_.stateName());
+  fprintf(out_, "uptime_s %llu\n", (unsigned long long)(time_us_64() / 1000000));
+  fprintf(out_, "rtc_reads %u\ndrift_ppm %d\n", unsigned(hm.rtcReads()), int(hm.driftPpm()));
+  fprintf(out_, "lux %u\nlevel %u\n", unsigned(ambient.lux()), alarmClock_.level());
+  fprintf(out_, "player_sent %u\nplayer_coalesced %u\nplayer_timeouts %u\nplayer_failed %u\nplayer_late %u\n"
+          "player_dropped %u\n", unsigned(dfPlayer_.sent()), unsigned(dfPlayer_.coalesced()),
+          unsigned(dfPlayer_.timeouts()), unsigned(dfPlayer_.failed()), unsigned(dfPlayer_.late()),
+          unsigned(dfPlayer_.dropped()));
+  fprintf(out_, "transition_steps %u\ntransition_dropped %u\n", unsigned(renderer_.transitionSteps()),
+          unsigned(renderer_.droppedSteps()));
+  fprintf(out_, "alarm_latency_us %u\n", unsigned(alarmClock_.alarmAudio().latencyUs()));
+  for (uint32_t i = 0; i < i2cDma_.devices(); i++)
+  {
+    const I2cDma::Device &device = i2cDma_.device(i);
+    fprintf(out_, "i2c 0x%02x requests %u transactions %u bytes %llu busy_us %llu max_wait_us %u\n",
+            device.address, unsigned(device.requests), unsigned(device.transactions),
+            (unsigned long long)device.bytes, (unsigned long long)device.busyUs, unsigned(device.maxWaitUs));
+  }
+  fprintf(out_, "shell_commands %u\nshell_errors %u\n", unsigned(commands_), unsigned(errors_));
+  return nullptr;
+}
+
+const char *Shell::key(uint32_t argc, char **argv)
+{
+  int32_t key = argc > 1 ? find(KEYS, 4, argv[1]) : -1;
+  const char *type = argc > 2 ? argv[2] : "click";
+  if (argc > 3 or key < 0)
+  {
+    return "usage: key plus|minus|alarm|enter [click|press|release|long|repeat]";
+  }
+
+  KeyEvent event;
+  event.key = uint8_t(key);
+  event.us  = time_us_32();
+  if (strcmp(type, "click") == 0 or strcmp(type, "press") == 0)
+  {
+    event.type = KeyEvent::Type::Press;
+  }
+  else if (strcmp(type, "release") == 0)
+  {
+    event.type = KeyEvent::Type::Release;
+  }
+  else if (strcmp(type, "long") == 0)
+  {
+    event.type = KeyEvent::Type::LongPress;
+  }
+  else if (strcmp(type, "repeat") == 0)
+  {
+    event.type  = KeyEvent::Type::Repeat;
+    event.count = 1;
+  }
+  else
+  {
+    return "key events are click, press, release, long and repeat";
+  }
+
+  bool queued = alarmClock_.inject(event);
+  if (queued and strcmp(type, "click") == 0)
+  {
+    event.type = KeyEvent::Type::Release;
+    queued     = alarmClock_.inject(event);
+  }
+  return queued ? nullptr : "too many key events waiting";
+}
+
+const char *Shell::profile(uint32_t argc, char **argv)
+{
+#if ALARM_CLOCK_PROFILE
+  if (profiler_ == nullptr)
+  {
+    return "no profiler";
+  }
+  if (argc == 2 and strcmp(argv[1], "csv") == 0)
+  {
+    profiler_->dumpCsv(out_);
+    return nullptr;
+  }
+  if (argc == 2 and strcmp(argv[1], "binary") == 0)
+  {
+    profiler_->dumpBinary(out_);
+    return nullptr;
+  }
+  return "usage: profile csv|binary";
+#else
+  return "built without ALARM_CLOCK_PROFILE";
+#endif
+}
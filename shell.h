@@ -0,0 +1,93 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "alarmclock.h"
+#include "dfplayer.h"
+#include "i2cdma.h"
+#include "profiler.h"
+#include "renderer.h"
+
+// A line protocol over USB serial, to set clocks up without the keys and to
+// drive them from test scripts. poll() takes what has arrived without
+// waiting and runs at most one complete line per pass, so a pasted script
+// spreads over passes and never holds up the state machine. A command
+// answers with its output lines, then "ok" or "error: <reason>".
+//
+//   help
+//   time [HH:MM[:SS] [weekday]]            weekday 0 Monday ... 6 Sunday
+//   alarm [on|off]                         list, or switch the alarm
+//   alarm <n> HH:MM [days] [flags]         set, n = count adds one
+//   alarm <n> delete
+//   volume [0-30]
+//   brightness [<level> <contrast> <pixel>]
+//   set [<name> <value>]                   sunrise, snooze, snoozes, prewarm,
+//                                          ramp, curve, transition
+//   stats
+//   key plus|minus|alarm|enter [click|press|release|long|repeat]
+//   profile csv|binary                     with ALARM_CLOCK_PROFILE
+//
+// Days are seven characters from Monday, '-' for a day off (MTWTF--), or
+// any; flags a comma list of enabled, oneshot and skipnext, or - for none.
+// Nothing is echoed.
+class Shell
+{
+public:
+  static constexpr uint32_t LINE = 96;
+  static constexpr uint32_t ARGS = 8;
+
+  // The renderer is only read, for its counters.
+  Shell(AlarmClock &alarmClock, DfPlayer &dfPlayer, const I2cDma &i2cDma, const Renderer &renderer,
+        FILE *out = stdout);
+  ~Shell();
+
+#if ALARM_CLOCK_PROFILE
+  void setProfiler(const Profiler *profiler) { profiler_ = profiler; }
+#endif
+
+  // Reads the input that arrived, up to and with the end of a line.
+  void poll();
+
+  // Input may be waiting for poll(), the loop must not sleep.
+  bool pending() const { return input_; }
+
+  // Takes one character; true when it ended a line that then ran.
+  bool feed(char c);
+
+  uint32_t commands() const { return commands_; }
+  uint32_t errors() const { return errors_; }
+
+private:
+  AlarmClock &alarmClock_;
+  DfPlayer &dfPlayer_;
+  const I2cDma &i2cDma_;
+  const Renderer &renderer_;
+  FILE *out_;
+#if ALARM_CLOCK_PROFILE
+  const Profiler *profiler_;
+#endif
+  char line_[LINE];
+  uint32_t length_;
+  bool overflow_;           ///< The line is longer than LINE, it is dropped.
+  volatile bool input_;     ///< Set from the stdio callback.
+  uint32_t commands_;
+  uint32_t errors_;
+
+  const char *run(uint32_t argc, char **argv);
+  const char *time(uint32_t argc, char **argv);
+  const char *alarm(uint32_t argc, char **argv);
+  const char *volume(uint32_t argc, char **argv);
+  const char *brightness(uint32_t argc, char **argv);
+  const char *set(uint32_t argc, char **argv);
+  const char *stats();
+  const char *key(uint32_t argc, char **argv);
+  const char *profile(uint32_t argc, char **argv);
+  void printAlarm(uint32_t index);
+
+  static void onChars(void *shell);
+};
@@ -0,0 +1,74 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "signalgraph.h"
+
+SignalGraph::Node::Node(SignalGraph &graph, const char *name, Evaluate evaluate, std::initializer_list<const Node *> inputs)
+    : graph_(graph)
+    , evaluations_(0)
+    , name_(name)
+    , evaluate_(evaluate)
+    , bit_(0)
+    , inputs_(0)
+{
+  for (const Node *input : inputs)
+  {
+    inputs_ |= input->bit_;
+  }
+  bit_ = graph.add(this);
+}
+
+SignalGraph::SignalGraph()
+    : nodes_{}
+    , count_(0)
+    , changed_(0)
+    , forced_(0)
+    , commits_(0)
+{
+}
+
+// A node past CAPACITY gets no bit: it is never evaluated and its changes
+// reach nobody.
+uint32_t SignalGraph::add(Node *node)
+{
+  if (count_ == CAPACITY)
+  {
+    return 0;
+  }
+  nodes_[count_] = node;
+  return 1u << count_++;
+}
+
+void SignalGraph::commit()
+{
+  if (changed_ == 0 and forced_ == 0)
+  {
+    return;
+  }
+  commits_++;
+
+  // Inputs come before the nodes reading them, one pass in order sees every
+  // change. A node evaluated here only marks its own bit, so changed grows
+  // in the direction of the walk. A signal an effect sets marks changed_
+  // afresh and waits for the next commit; behind the walk it would be lost.
+  uint32_t changed = changed_;
+  uint32_t forced  = forced_;
+  changed_         = 0;
+  forced_          = 0;
+
+  for (uint32_t i = 0; i < count_; i++)
+  {
+    Node &node = *nodes_[i];
+    if (node.evaluate_ == nullptr or ((node.inputs_ & changed) == 0 and (forced & node.bit_) == 0))
+    {
+      continue;
+    }
+    node.evaluations_++;
+    if (node.evaluate_(node))
+    {
+      changed |= node.bit_;
+    }
+  }
+}
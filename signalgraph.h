@@ -0,0 +1,182 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <initializer_list>
+#include <stdint.h>
+
+// Values that depend on each other: Signals are set from outside, Computed
+// values derive from other nodes and Effects act on them. A node names its
+// inputs when it is built, so it comes after them in the graph and the
+// order nodes were added in is a topological one.
+//
+// Setting a signal only marks it. commit() then walks the nodes once in
+// order and evaluates those with a changed input; a Computed whose value
+// comes out the same does not pass the change on. Effects run at most once
+// per commit, after everything they read is up to date. A signal set while
+// the walk is under way waits for the next commit, pending() tells.
+//
+// Computed functions and Effect actions are member functions of their owner
+// bound at compile time through call<>, the way a state table binds its
+// handlers: a plain function pointer and the owner, no type erasure.
+class SignalGraph
+{
+public:
+  static constexpr uint32_t CAPACITY = 32;
+
+  class Node
+  {
+  public:
+    Node(const Node &) = delete;
+    Node &operator=(const Node &) = delete;
+
+    const char *name() const { return name_; }
+
+    // Changes of a signal, evaluations of a Computed or an Effect.
+    uint32_t evaluations() const { return evaluations_; }
+
+  protected:
+    using Evaluate = bool (*)(Node &);
+
+    Node(SignalGraph &graph, const char *name, Evaluate evaluate, std::initializer_list<const Node *> inputs);
+
+    SignalGraph &graph_;
+    uint32_t evaluations_;
+
+    void changed() { graph_.changed_ |= bit_; }
+    void force() { graph_.forced_ |= bit_; }
+
+  private:
+    friend class SignalGraph;
+
+    const char *name_;
+    Evaluate evaluate_;     ///< Null for a signal. True when the value changed.
+    uint32_t bit_;
+    uint32_t inputs_;       ///< A bit per node read.
+  };
+
+  SignalGraph();
+
+  void commit();
+
+  // Signals were set or effects scheduled since the last commit.
+  bool pending() const { return changed_ != 0 or forced_ != 0; }
+
+  uint32_t commits() const { return commits_; }
+  uint32_t count() const { return count_; }
+  const Node &node(uint32_t index) const { return *nodes_[index]; }
+
+private:
+  Node *nodes_[CAPACITY];
+  uint32_t count_;
+  uint32_t changed_;      ///< Signals set since the last commit.
+  uint32_t forced_;       ///< Nodes to evaluate whether or not an input changed.
+  uint32_t commits_;
+
+  uint32_t add(Node *node);
+};
+
+template <typename T>
+class Signal : public SignalGraph::Node
+{
+public:
+  Signal(SignalGraph &graph, const char *name, const T &value = T())
+      : Node(graph, name, nullptr, {})
+      , value_(value)
+  {
+  }
+
+  const T &get() const { return value_; }
+
+  void set(const T &value)
+  {
+    if (value != value_)
+    {
+      value_ = value;
+      evaluations_++;
+      changed();
+    }
+  }
+
+private:
+  T value_;
+};
+
+// The function gets the value so far, e.g. for hysteresis.
+template <typename T, typename Owner>
+class Computed : public SignalGraph::Node
+{
+public:
+  using Function = T (*)(Owner &, const T &last);
+
+  template <T (Owner::*F)(const T &)>
+  static T call(Owner &owner, const T &last)
+  {
+    return (owner.*F)(last);
+  }
+
+  Computed(SignalGraph &graph, const char *name, std::initializer_list<const Node *> inputs, Owner &owner,
+           Function function, const T &value = T())
+      : Node(graph, name, &Computed::evaluate, inputs)
+      , value_(value)
+      , owner_(owner)
+      , function_(function)
+  {
+  }
+
+  const T &get() const { return value_; }
+
+private:
+  T value_;
+  Owner &owner_;
+  Function function_;
+
+  static bool evaluate(Node &node)
+  {
+    Computed &self = static_cast<Computed &>(node);
+    T value        = self.function_(self.owner_, self.value_);
+    if (value != self.value_)
+    {
+      self.value_ = value;
+      return true;
+    }
+    return false;
+  }
+};
+
+template <typename Owner>
+class Effect : public SignalGraph::Node
+{
+public:
+  using Action = void (*)(Owner &);
+
+  template <void (Owner::*F)()>
+  static void call(Owner &owner)
+  {
+    (owner.*F)();
+  }
+
+  Effect(SignalGraph &graph, const char *name, std::initializer_list<const Node *> inputs, Owner &owner, Action action)
+      : Node(graph, name, &Effect::evaluate, inputs)
+      , owner_(owner)
+      , action_(action)
+  {
+  }
+
+  // Runs the action with the next commit even if no input changed.
+  void schedule() { force(); }
+
+private:
+  Owner &owner_;
+  Action action_;
+
+  static bool evaluate(Node &node)
+  {
+    Effect &self = static_cast<Effect &>(node);
+    self.action_(self.owner_);
+    return false;
+  }
+};
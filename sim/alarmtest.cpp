@@ -0,0 +1,600 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "alarmtest.h"
+#include "alarms.h"
+#include "simulation.h"
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+using Alarm = Alarms::Alarm;
+
+static constexpr uint32_t WEEK = Alarms::MINUTES_PER_WEEK;
+
+static Alarm randomAlarm(std::mt19937 &random)
+{
+  Alarm alarm;
+  alarm.hour     = random() % 24;
+  alarm.minute   = random() % 60;
+  alarm.weekdays = random() % 4 == 0 ? 0 : random() % 128;
+  alarm.flags    = 0;
+  if (random() % 8 != 0)
+  {
+    alarm.flags |= Alarm::Enabled;
+  }
+  if (random() % 4 == 0)
+  {
+    alarm.flags |= Alarm::OneShot;
+  }
+  if (random() % 4 == 0)
+  {
+    alarm.flags |= Alarm::SkipNext;
+  }
+  return alarm;
+}
+
+static bool due(const Alarm &alarm, uint32_t minute)
+{
+  uint8_t weekdays = alarm.weekdays ? alarm.weekdays : Alarms::EVERY_DAY;
+  uint32_t day     = minute / Alarms::MINUTES_PER_DAY;
+  return alarm.is(Alarm::Enabled) and (weekdays & (1 << day)) and
+         minute % Alarms::MINUTES_PER_DAY == uint32_t(alarm.hour) * 60 + alarm.minute;
+}
+
+// Walks every minute the tick covers, like a clock that never sleeps.
+static uint32_t reference(Alarm *alarms, uint32_t count, uint32_t from, uint32_t to)
+{
+  uint32_t fired = 0;
+  for (uint32_t m = from; m != (to + 1) % WEEK; m = (m + 1) % WEEK)
+  {
+    for (uint32_t i = 0; i < count; i++)
+    {
+      if (not due(alarms[i], m))
+      {
+        continue;
+      }
+      if (alarms[i].is(Alarm::SkipNext))
+      {
+        alarms[i].flags &= ~Alarm::SkipNext;
+        continue;
+      }
+      fired |= 1u << i;
+      if (alarms[i].is(Alarm::OneShot))
+      {
+        alarms[i].flags &= ~Alarm::Enabled;
+      }
+    }
+  }
+  return fired;
+}
+
+// Minutes from `from` to the next minute the alarm is due, WEEK if never.
+static uint32_t untilDue(const Alarm &alarm, uint32_t from)
+{
+  for (uint32_t d = 0; d < WEEK; d++)
+  {
+    if (due(alarm, (from + d) % WEEK))
+    {
+      return d;
+    }
+  }
+  return WEEK;
+}
+
+// Random alarms, random tick gaps of up to an hour, now and then a step back
+// of a few minutes, random edits on the way.
+static int engine(uint32_t seed)
+{
+  std::mt19937 random(seed);
+  Alarms alarms;
+  Alarm model[Alarms::CAPACITY];
+  uint32_t count = 2 + random() % (Alarms::CAPACITY - 1);
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    model[i] = randomAlarm(random);
+    alarms.add(model[i]);
+  }
+
+  uint32_t minute    = random() % WEEK;
+  uint32_t from      = minute;
+  uint32_t fires     = 0;
+  uint32_t rtcWrites = 0;
+
+  // The first pass ticks the start minute, which only starts counting but
+  // fires what is due right then.
+  for (uint32_t elapsed = 0, pass = 0; elapsed < 2 * WEEK; pass++)
+  {
+    // Now and then the clock steps back a little, as when it is pulled back
+    // to the RTC; those minutes were ticked already.
+    bool back = pass > 0 and random() % 50 == 0;
+    if (back)
+    {
+      minute = (from + WEEK - 1 - random() % Alarms::BEHIND_MINUTES) % WEEK;
+    }
+    else if (pass > 0)
+    {
+      uint32_t step = 1 + (random() % 4 == 0 ? random() % 60 : 0);
+      elapsed += step;
+      minute = (from + step - 1) % WEEK;
+    }
+
+    uint32_t expected = back ? 0 : reference(model, count, from, minute);
+    uint32_t fired    = alarms.tick(minute);
+    if (not back)
+    {
+      from = (minute + 1) % WEEK;
+    }
+
+    if (fired != expected)
+    {
+      printf("FAIL: seed %u minute %u fired 0x%02x, expected 0x%02x\n", seed, minute, fired, expected);
+      return 1;
+    }
+    fires += __builtin_popcount(fired);
+
+    if (random() % 200 == 0)
+    {
+      uint32_t index = random() % count;
+      model[index]   = randomAlarm(random);
+      alarms.set(index, model[index]);
+    }
+
+    // next() must be the alarm due soonest from the next minute on.
+    uint32_t soonest = WEEK;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      soonest = std::min(soonest, untilDue(model[i], from));
+    }
+    int32_t next = alarms.next();
+    if ((next < 0) != (soonest == WEEK) or (next >= 0 and untilDue(model[next], from) != soonest))
+    {
+      printf("FAIL: seed %u minute %u next alarm %d is not the soonest\n", seed, minute, next);
+      return 1;
+    }
+
+    rtcWrites += alarms.nextChanged();
+  }
+
+  printf("  seed %-4u : %u alarms, %3u fired, %3u RTC alarm writes in two weeks\n", seed, count, fires, rtcWrites);
+  return 0;
+}
+
+// 12:00, 12:01 and 12:00 again must not take the step back for a week ahead.
+static int backward()
+{
+  Alarms alarms;
+  alarms.add({12, 30, 0, Alarm::Enabled});
+  alarms.add({18, 0, 0, Alarm::Enabled});
+
+  uint32_t noon  = 12 * 60;
+  uint32_t fired = alarms.tick(noon) | alarms.tick(noon + 1) | alarms.tick(noon);
+  fired         |= alarms.tick(noon + 2 - Alarms::BEHIND_MINUTES);
+  uint32_t half  = alarms.tick(noon + 30);
+  if (fired != 0 or half != 0x1)
+  {
+    printf("FAIL: stepping back fired 0x%02x, 12:30 fired 0x%02x\n", fired, half);
+    return 1;
+  }
+  printf("  backward  : ticks up to %u minutes back fire nothing\n", Alarms::BEHIND_MINUTES - 1);
+  return 0;
+}
+
+// The whole clock over a week: armed every evening, the daily alarm has to
+// ring every morning exactly once and the weekday has to follow.
+static int clock()
+{
+  using S = Simulation;
+  static constexpr uint64_t DAY = 24 * 60 * S::MINUTE;
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+  sim::flash().reset();
+
+  Simulation s(5, true, cilo72::ic::SD2405::Time(7, 0, 0));
+  s.rtc.simSetTime(cilo72::ic::SD2405::Time(12, 0, 0));
+  s.runUntil(S::SECOND);
+
+  int failures     = 0;
+  uint32_t weekday = s.alarmClock().hourMinute().weekday();
+
+  for (uint32_t day = 0; day < 7; day++)
+  {
+    // 22:00 arm, 06:59 quiet, 07:01 ringing, 07:05 stopped.
+    uint64_t evening = 10 * 60 * S::MINUTE + day * DAY;
+    uint64_t morning = evening + 9 * 60 * S::MINUTE;
+    s.press(S::KEY_ALARM, evening);
+    s.press(S::KEY_ALARM, morning + 4 * S::MINUTE);
+
+    s.runUntil(morning - S::MINUTE);
+    bool early = s.alarmClock().alarmIsPlaying();
+    s.runUntil(morning + S::MINUTE);
+    bool ringing = s.alarmClock().alarmIsPlaying();
+    s.runUntil(morning + 5 * S::MINUTE);
+    bool stopped = not s.alarmClock().alarmIsPlaying();
+
+    uint32_t expected = (weekday + day + 1) % 7;
+    uint32_t actual   = s.alarmClock().hourMinute().weekday();
+    if (early or not ringing or not stopped or actual != expected)
+    {
+      printf("FAIL: day %u early %d ringing %d stopped %d weekday %u expected %u\n", day, early, ringing, stopped,
+             actual, expected);
+      failures++;
+    }
+  }
+
+  printf("  clock     : 7 mornings, %d failed\n", failures);
+  return failures;
+}
+
+// A timer 900 ppm fast runs over 3 s ahead of the RTC in the hour before the
+// first resync. Started at the seconds around the one that has the resync
+// fall just after a minute rollover, the shown minute must never go back and
+// must follow the RTC again once it has caught up.
+static int resync()
+{
+  using S = Simulation;
+  static constexpr uint64_t STEP = 100000;
+
+  int failures  = 0;
+  uint32_t held = 0;
+  for (uint32_t start = 56; start < 62; start++)
+  {
+    sim::clock().reset();
+    sim::i2c().reset();
+    sim::uart().reset();
+    sim::flash().reset();
+
+    Simulation s(5, true, cilo72::ic::SD2405::Time(7, 0, 0));
+    s.rtc.simSetDrift(-900);
+    s.rtc.simSetTime(cilo72::ic::SD2405::Time(12, start / 60, start % 60));
+    s.runUntil(59 * S::MINUTE);
+
+    const HourMinute &hm = s.alarmClock().hourMinute();
+    const HourMinute::Time &shown = hm;
+    uint32_t last  = shown.hour() * 60 + shown.minute();
+    bool holding   = false;
+    for (uint64_t t = 59 * S::MINUTE; t < 63 * S::MINUTE; t += STEP)
+    {
+      s.runUntil(t);
+      uint32_t minute = shown.hour() * 60 + shown.minute();
+      if (minute != last and minute != (last + 1) % (24 * 60))
+      {
+        printf("FAIL: started at second %u, the minute went from %u to %u\n", start, last, minute);
+        failures++;
+        break;
+      }
+      last = minute;
+
+      cilo72::ic::SD2405::Time rtc = s.rtc.simTime();
+      int32_t error = int32_t(hm.secondOfDay()) - int32_t((rtc.hour() * 60 + rtc.minute()) * 60 + rtc.second());
+      if (hm.secondOfDay() / 60 != minute)
+      {
+        holding = true;
+      }
+      else if (t > 62 * S::MINUTE and (error < -1 or error > 1))
+      {
+        printf("FAIL: started at second %u, %d s off the RTC after the resync\n", start, error);
+        failures++;
+        break;
+      }
+    }
+    held += holding;
+  }
+
+  if (held == 0)
+  {
+    printf("FAIL: no resync found the timer ahead past a rollover\n");
+    failures++;
+  }
+  printf("  resync    : 6 starts at 900 ppm, %u held the minute, %d failed\n", held, failures);
+  return failures;
+}
+
+// One morning with a 20 minute sunrise: the pixels stay dark before it,
+// only get brighter through it, reach daylight at the alarm and go out when
+// it is stopped. Core0 is not woken for the animation.
+static int sunrise()
+{
+  using S = Simulation;
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+  sim::flash().reset();
+
+  Simulation s(5, true, cilo72::ic::SD2405::Time(7, 0, 0));
+  s.rtc.simSetTime(cilo72::ic::SD2405::Time(6, 0, 0));
+  s.lux.simSetProfile([](uint64_t) { return 1.0; });
+  s.press(S::KEY_ALARM, S::MINUTE);
+
+  uint64_t alarm   = 60 * S::MINUTE;
+  uint64_t start   = alarm - uint64_t(s.alarmClock().sunriseMinutes()) * S::MINUTE;
+  int failures     = 0;
+  uint32_t last    = 0;
+  uint32_t wakeups = 0;
+  s.press(S::KEY_ALARM, alarm + 2 * S::MINUTE);
+
+  auto light = [&s]()
+  {
+    const cilo72::ic::WS2812::Pixel &pixel = s.pixels.simPixel(0);
+    return uint32_t(pixel.r) + pixel.g + pixel.b;
+  };
+
+  s.runUntil(start - S::SECOND);
+  if (light() != 0)
+  {
+    printf("FAIL: sunrise lit %u before its start\n", light());
+    failures++;
+  }
+
+  wakeups = s.scheduler().wakeups();
+  for (uint64_t t = start; t < alarm; t += 10 * S::SECOND)
+  {
+    s.runUntil(t);
+    if (light() < last)
+    {
+      printf("FAIL: sunrise darkened from %u to %u at %llu s\n", last, light(), (unsigned long long)(t / S::SECOND));
+      failures++;
+    }
+    last = light();
+  }
+  wakeups = s.scheduler().wakeups() - wakeups;
+
+  s.runUntil(alarm + S::MINUTE);
+  const cilo72::ic::WS2812::Pixel &day = s.pixels.simPixel(0);
+  if (not s.alarmClock().alarmIsPlaying() or day.r != 255 or day.g < day.b or day.b == 0 or
+      s.pixels.simBrightness() != 15)
+  {
+    printf("FAIL: at the alarm the sunrise shows %u %u %u at %u\n", day.r, day.g, day.b, s.pixels.simBrightness());
+    failures++;
+  }
+
+  s.runUntil(alarm + 3 * S::MINUTE);
+  if (light() != 0)
+  {
+    printf("FAIL: the sunrise stays lit after the alarm\n");
+    failures++;
+  }
+
+  printf("  sunrise   : %u core0 wakeups in %u minutes, %d failed\n", wakeups, s.alarmClock().sunriseMinutes(),
+         failures);
+  return failures;
+}
+
+// The alarm sound with and without the prewarm: the track is loaded
+// silently ahead, starts within 100 ms of the alarm and gets louder step by
+// step up to the user's volume, which the player has again once stopped.
+static int crescendo(uint8_t prewarmSeconds)
+{
+  using S = Simulation;
+  static constexpr uint64_t MAX_LATENCY_US = 100000;
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+  sim::flash().reset();
+
+  Simulation s(5, true, cilo72::ic::SD2405::Time(7, 0, 0));
+  // Booting took a while, the RTC seconds start from here.
+  uint64_t alarm = sim::clock().now() + 2 * S::MINUTE;
+  s.rtc.simSetTime(cilo72::ic::SD2405::Time(6, 58, 0));
+  AlarmAudio &audio = s.alarmClock().alarmAudio();
+  audio.setPrewarmSeconds(prewarmSeconds);
+  audio.setRamp(30, AlarmAudio::Curve::Quadratic);
+  s.press(S::KEY_ALARM, 10 * S::SECOND);
+
+  int failures = 0;
+  s.press(S::KEY_ALARM, alarm + 2 * S::MINUTE);
+
+  s.runUntil(alarm - S::SECOND);
+  if (s.dfPlayerModel.playing() or not audio.armed() or s.dfPlayerModel.volume() != (prewarmSeconds > 0 ? 1 : 15))
+  {
+    printf("FAIL: before the alarm the player %s at %d\n", s.dfPlayerModel.playing() ? "plays" : "waits",
+           s.dfPlayerModel.volume());
+    failures++;
+  }
+
+  s.runUntil(alarm + S::SECOND);
+  uint64_t late = s.dfPlayerModel.startedAt() - alarm;
+  if (not s.dfPlayerModel.playing() or late > MAX_LATENCY_US or audio.latencyUs() > MAX_LATENCY_US or
+      s.dfPlayerModel.loudestBefore() > 0)
+  {
+    printf("FAIL: the sound started %.1f ms after the alarm, %.1f ms logged, %d before\n", late / 1000.0,
+           audio.latencyUs() / 1000.0, s.dfPlayerModel.loudestBefore());
+    failures++;
+  }
+
+  s.runUntil(alarm + (audio.rampSeconds() + 1) * S::SECOND);
+  const auto &volumes = s.dfPlayerModel.volumes();
+  for (size_t i = 1; i < volumes.size(); i++)
+  {
+    if (volumes[i].second < volumes[i - 1].second)
+    {
+      printf("FAIL: the volume dropped from %d to %d\n", volumes[i - 1].second, volumes[i].second);
+      failures++;
+    }
+  }
+  if (volumes.empty() or volumes.front().second != 1 or volumes.back().second != 15 or
+      volumes.size() > AlarmAudio::STEPS)
+  {
+    printf("FAIL: %zu volume steps up to %d\n", volumes.size(), volumes.empty() ? 0 : volumes.back().second);
+    failures++;
+  }
+
+  s.runUntil(alarm + 3 * S::MINUTE);
+  if (s.dfPlayerModel.playing() or s.dfPlayerModel.volume() != 15)
+  {
+    printf("FAIL: after the alarm the player %s at %d\n", s.dfPlayerModel.playing() ? "plays" : "waits",
+           s.dfPlayerModel.volume());
+    failures++;
+  }
+
+  printf("  %-9s : sound %.1f ms after the alarm, %zu volume steps, %d failed\n", prewarmSeconds ? "prewarmed" : "cold",
+         late / 1000.0, volumes.size(), failures);
+  return failures;
+}
+
+// A full snooze chain: every snooze rings again after exactly its length,
+// within a timer tick of the press, while the panels count down. Once the
+// chain is through a key no longer snoozes, the alarm key ends it all.
+static int snoozeChain()
+{
+  using S = Simulation;
+  static constexpr uint64_t TICK_US = 1000;
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+  sim::flash().reset();
+
+  Simulation s(5, true, cilo72::ic::SD2405::Time(7, 0, 0));
+  uint64_t ring = sim::clock().now() + S::MINUTE;
+  s.rtc.simSetTime(cilo72::ic::SD2405::Time(6, 59, 0));
+  s.alarmClock().setSnoozeMinutes(5);
+  s.press(S::KEY_ALARM, 5 * S::SECOND);
+
+  uint64_t length  = uint64_t(s.alarmClock().snoozeMinutes()) * S::MINUTE;
+  int failures     = 0;
+  uint64_t maxLate = 0;
+  s.runUntil(ring + S::SECOND);
+
+  static constexpr uint8_t keys[] = {S::KEY_PLUS, S::KEY_MINUS, S::KEY_ENTER};
+  for (uint32_t i = 0; i < s.alarmClock().maxSnoozes(); i++)
+  {
+    uint64_t press = ring + 20 * S::SECOND + i * 777;
+    s.press(keys[i % 3], press);
+    s.runUntil(press + 1500 * 1000);
+
+    const Frame &frame = s.alarmClock().frame();
+    if (s.alarmClock().alarmIsPlaying() or not s.alarmClock().snoozing() or s.dfPlayerModel.playing() or
+        frame.view != Frame::View::Snooze or uint32_t(frame.minute) * 60 + frame.second != length / S::SECOND - 1)
+    {
+      printf("FAIL: snooze %u shows %u:%02u, playing %d\n", i + 1, frame.minute, frame.second,
+             s.alarmClock().alarmIsPlaying());
+      failures++;
+    }
+
+    // It must not ring before press + length, and rings at most a tick and
+    // a loop pass after.
+    s.runUntil(press + length - TICK_US);
+    if (s.alarmClock().alarmIsPlaying())
+    {
+      printf("FAIL: snooze %u rang early\n", i + 1);
+      failures++;
+    }
+    for (uint64_t t = press + length - TICK_US; t < press + length + 10 * TICK_US; t += 50)
+    {
+      s.runUntil(t);
+      if (s.alarmClock().alarmIsPlaying())
+      {
+        ring = t;
+        break;
+      }
+    }
+    if (not s.alarmClock().alarmIsPlaying() or ring < press + length)
+    {
+      printf("FAIL: snooze %u did not ring on time\n", i + 1);
+      failures++;
+      break;
+    }
+    maxLate = ring - (press + length) > maxLate ? ring - (press + length) : maxLate;
+  }
+
+  // The chain is through, the next presses leave the alarm ringing and
+  // Enter opens no menu over it.
+  s.press(S::KEY_PLUS, ring + 10 * S::SECOND);
+  s.press(S::KEY_ENTER, ring + 12 * S::SECOND);
+  s.runUntil(ring + 14 * S::SECOND);
+  if (not s.alarmClock().alarmIsPlaying() or s.alarmClock().snoozes() != s.alarmClock().maxSnoozes() or
+      strcmp(s.alarmClock().stateName(), "Idle") != 0 or not s.dfPlayerModel.playing())
+  {
+    printf("FAIL: snoozed %u times, %u allowed, state %s\n", s.alarmClock().snoozes(), s.alarmClock().maxSnoozes(),
+           s.alarmClock().stateName());
+    failures++;
+  }
+
+  s.press(S::KEY_ALARM, ring + 20 * S::SECOND);
+  s.runUntil(ring + 22 * S::SECOND);
+  if (s.alarmClock().alarmIsPlaying() or s.alarmClock().snoozing() or s.alarmClock().snoozes() != 0 or
+      s.dfPlayerModel.playing() or s.alarmClock().frame().view != Frame::View::Clock)
+  {
+    printf("FAIL: the alarm key did not end the chain\n");
+    failures++;
+  }
+
+  if (maxLate > TICK_US)
+  {
+    printf("FAIL: a snooze rang %.3f ms late\n", maxLate / 1000.0);
+    failures++;
+  }
+
+  printf("  snooze    : %u snoozes of %u min, rang up to %.3f ms after, %d failed\n", s.alarmClock().maxSnoozes(),
+         s.alarmClock().snoozeMinutes(), maxLate / 1000.0, failures);
+  return failures;
+}
+
+// Without any alarm, e.g. restored from a stored count of 0, the alarm menu
+// adds a daily one at the time set instead of writing to an empty slot.
+static int menuWithoutAlarms()
+{
+  using S = Simulation;
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+  sim::flash().reset();
+
+  Simulation s(5, true, cilo72::ic::SD2405::Time(7, 0, 0));
+  s.rtc.simSetTime(cilo72::ic::SD2405::Time(12, 0, 0));
+  s.runUntil(S::SECOND);
+  s.alarmClock().removeAlarm(0);
+
+  // Menu, its first entry Alarm, then hour up by ten and the four fields.
+  uint64_t at = 2 * S::SECOND;
+  s.press(S::KEY_ENTER, at);
+  s.press(S::KEY_ENTER, at += S::SECOND);
+  s.press(S::KEY_PLUS, at += S::SECOND);
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    s.press(S::KEY_ENTER, at += S::SECOND);
+  }
+  s.runUntil(at + S::SECOND);
+
+  const Alarms &alarms = s.alarmClock().alarms();
+  if (alarms.count() != 1 or alarms.next() != 0 or alarms.alarm(0).hour != 22 or alarms.alarm(0).minute != 0 or
+      alarms.alarm(0).weekdays != Alarms::EVERY_DAY)
+  {
+    printf("FAIL: the alarm menu left %u alarms, next %d\n", alarms.count(), alarms.next());
+    return 1;
+  }
+  printf("  no alarms : the menu adds one at 22:00\n");
+  return 0;
+}
+
+int alarmsTest()
+{
+  int failures = 0;
+
+  printf("alarm engine:\n");
+  for (uint32_t seed = 1; seed <= 20; seed++)
+  {
+    failures += engine(seed);
+  }
+  failures += backward();
+  failures += menuWithoutAlarms();
+
+  failures += clock();
+  failures += resync();
+  failures += sunrise();
+  failures += crescendo(AlarmAudio::PREWARM_SECONDS);
+  failures += crescendo(0);
+  failures += snoozeChain();
+
+  printf(failures ? "FAIL: %d\n" : "OK\n", failures);
+  return failures;
+}
@@ -0,0 +1,11 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+// Replays simulated weeks against the alarm engine and the whole clock and
+// checks that every alarm fires exactly once per due time, and that an RTC
+// resync never takes the shown minute back. Returns the number of failures.
+int alarmsTest();
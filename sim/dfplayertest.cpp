@@ -0,0 +1,209 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "dfplayertest.h"
+#include "dfplayer.h"
+#include "simclock.h"
+#include "simhw.h"
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// What the module expects next and how it answers: nullptr stays silent.
+struct Step
+{
+  const char *command;
+  const char *answer;
+  uint32_t delayMs;
+};
+
+static const Step script[] = {
+  {"AT+VOL=?",      "VOL = [12]\r\n", 5},
+  // play() and ten quick volume steps while the play mode is on the wire.
+  {"AT+PLAYMODE=4", "OK\r\n",         20},
+  {"AT+PLAY=NEXT",  "OK\r\n",         5},
+  {"AT+VOL=22",     "OK\r\n",         5},
+  // The pause is carried out but answered only after the timeout: sent
+  // again it would play, and its OK must not count for the play mode.
+  {"AT+PLAY=PP",    "OK\r\n",         400},
+  // The second pause is a toggle of its own, and the step after the play
+  // mode does not overtake the pauses into the volume before them.
+  {"AT+PLAY=PP",    "OK\r\n",         5},
+  {"AT+PLAYMODE=1", "error\r\n",      5},
+  {"AT+VOL=23",     "OK\r\n",         5},
+  // The first answer gets lost, the volume goes out again and is refused.
+  {"AT+VOL=30",     nullptr,          0},
+  {"AT+VOL=30",     "error\r\n",      5},
+};
+
+static constexpr uint32_t STEPS = sizeof(script) / sizeof(script[0]);
+
+// The module side: reads lines from the terminal and plays the script.
+static void module(int fd, std::atomic<uint32_t> &step, std::atomic<bool> &stop, std::vector<std::string> &mismatches)
+{
+  std::string line;
+  while (not stop and step < STEPS)
+  {
+    pollfd p = {fd, POLLIN, 0};
+    if (poll(&p, 1, 10) <= 0)
+    {
+      continue;
+    }
+
+    char c;
+    if (read(fd, &c, 1) != 1)
+    {
+      continue;
+    }
+    if (c != '\n')
+    {
+      line += c;
+      continue;
+    }
+
+    if (not line.empty() and line.back() == '\r')
+    {
+      line.pop_back();
+    }
+
+    const Step &s = script[step];
+    if (line != s.command)
+    {
+      mismatches.push_back("expected " + std::string(s.command) + ", got " + line);
+    }
+    if (s.answer)
+    {
+      usleep(s.delayMs * 1000);
+      if (write(fd, s.answer, strlen(s.answer)) < 0)
+      {
+        mismatches.push_back("write failed");
+      }
+    }
+    line.clear();
+    step++;
+  }
+}
+
+// Runs poll() with the simulated clock following the wall clock, until the
+// player has nothing left or the timeout.
+static void run(DfPlayer &player, int master, uint32_t timeoutMs)
+{
+  auto start = std::chrono::steady_clock::now();
+  auto last  = start;
+
+  while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(timeoutMs))
+  {
+    uint8_t buffer[64];
+    ssize_t n = read(master, buffer, sizeof(buffer));
+    if (n > 0)
+    {
+      sim::uartPort(0).send(buffer, n);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    sim::clock().advance(std::chrono::duration_cast<std::chrono::microseconds>(now - last).count());
+    last = now;
+
+    player.poll();
+    if (player.idle())
+    {
+      return;
+    }
+    usleep(500);
+  }
+}
+
+int dfPlayerTest()
+{
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 or grantpt(master) != 0 or unlockpt(master) != 0)
+  {
+    printf("FAIL: no pseudo terminal\n");
+    return 1;
+  }
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+
+  termios raw;
+  tcgetattr(slave, &raw);
+  cfmakeraw(&raw);
+  tcsetattr(slave, TCSANOW, &raw);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+  sim::clock().reset();
+  sim::uartPort(0).attach([master](const uint8_t *data, size_t length)
+  {
+    if (write(master, data, length) < 0)
+    {
+      printf("FAIL: write to the terminal\n");
+    }
+  });
+
+  std::atomic<uint32_t> step(0);
+  std::atomic<bool> stop(false);
+  std::vector<std::string> mismatches;
+  std::thread fake([&]() { module(slave, step, stop, mismatches); });
+
+  int failures = 0;
+  DfPlayer player(uart0, 17, 16);
+  run(player, master, 1000);
+  if (player.volume() != 12)
+  {
+    printf("FAIL: volume %d after the query, the module has 12\n", player.volume());
+    failures++;
+  }
+
+  player.setPlayMode(DfPlayer::PlayMode::Random);
+  player.next();
+  for (uint32_t i = 0; i < 10; i++)
+  {
+    player.incVolume(1);
+  }
+  player.pause();
+  player.pause();
+  player.setPlayMode(DfPlayer::PlayMode::RepeatOne);
+  player.incVolume(1);
+  run(player, master, 3000);
+
+  player.setVolume(40);
+  run(player, master, 1000);
+
+  stop = true;
+  fake.join();
+  sim::uartPort(0).attach(nullptr);
+  close(slave);
+  close(master);
+
+  for (const std::string &mismatch : mismatches)
+  {
+    printf("FAIL: %s\n", mismatch.c_str());
+    failures++;
+  }
+  if (step != STEPS or not player.idle())
+  {
+    printf("FAIL: script at step %u of %u, player %s\n", uint32_t(step), STEPS, player.idle() ? "idle" : "busy");
+    failures++;
+  }
+  if (player.coalesced() != 9 or player.timeouts() != 2 or player.failed() != 3 or player.late() != 1 or
+      player.volume() != 30)
+  {
+    printf("FAIL: %u coalesced, %u timeouts, %u failed, %u late, volume %d\n", player.coalesced(),
+           player.timeouts(), player.failed(), player.late(), player.volume());
+    failures++;
+  }
+
+  printf("DFPlayer over a pty: %u commands sent, %u coalesced, %u timeouts, %u failed, %u late\n", player.sent(),
+         player.coalesced(), player.timeouts(), player.failed(), player.late());
+  printf(failures ? "FAIL: %d\n" : "OK\n", failures);
+  return failures;
+}
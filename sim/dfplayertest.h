@@ -0,0 +1,13 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+// Runs DfPlayer against a scripted DFPlayer Pro on the other end of a
+// pseudo terminal, in real time, and checks what reaches the module:
+// queued volume steps coalesce, a lost answer to a volume is retried but
+// one to a pause is not, a late answer is not taken for the next command's
+// and a refused command is given up. Returns the number of failures.
+int dfPlayerTest();
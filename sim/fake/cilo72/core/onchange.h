@@ -0,0 +1,45 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <functional>
+
+namespace cilo72
+{
+    namespace core
+    {
+        template <typename T>
+        class OnChange
+        {
+        public:
+            OnChange(const T &value, std::function<void(const T &last, const T &now)> action, std::function<void()> update = []() {})
+                : value_(value), last_(value), action_(action), update_(update)
+            {
+            }
+
+            void evaluate(bool force = false)
+            {
+                update_();
+                if (force or value_ != last_)
+                {
+                    action_(last_, value_);
+                    last_ = value_;
+                }
+            }
+
+            void action()
+            {
+                action_(last_, value_);
+            }
+
+        private:
+            const T &value_;
+            T last_;
+            std::function<void(const T &last, const T &now)> action_;
+            std::function<void()> update_;
+        };
+    }
+}
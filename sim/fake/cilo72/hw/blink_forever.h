@@ -0,0 +1,22 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+namespace cilo72
+{
+    namespace hw
+    {
+        class BlinkForever
+        {
+        public:
+            BlinkForever(uint8_t pin, uint32_t hz)
+            {
+            }
+        };
+    }
+}
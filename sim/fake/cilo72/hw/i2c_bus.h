@@ -0,0 +1,28 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "simbus.h"
+
+namespace cilo72
+{
+    namespace hw
+    {
+        class I2CBus
+        {
+        public:
+            I2CBus(uint8_t pinSDA, uint8_t pinSCL)
+            {
+            }
+
+            void transfer(uint8_t address, uint32_t bytes)
+            {
+                sim::i2c().transfer(address, bytes);
+            }
+        };
+    }
+}
@@ -0,0 +1,51 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include "pico/stdlib.h"
+#include "cilo72/hw/i2c_bus.h"
+
+namespace cilo72
+{
+    namespace ic
+    {
+        // Fake light sensor: the simulation supplies lux as a function of time.
+        class BH1750FVI
+        {
+        public:
+            static constexpr uint8_t ADDRESS = 0x23;
+
+            BH1750FVI(hw::I2CBus &bus)
+                : bus_(bus), lux_(0.0), profile_([](uint64_t) { return 50.0; })
+            {
+                sim::i2c().name(ADDRESS, "BH1750FVI");
+            }
+
+            void update()
+            {
+                bus_.transfer(ADDRESS, 3);
+                lux_ = profile_(time_us_64());
+            }
+
+            operator const double &() const
+            {
+                return lux_;
+            }
+
+            void simSetProfile(std::function<double(uint64_t us)> profile)
+            {
+                profile_ = profile;
+            }
+
+        private:
+            hw::I2CBus &bus_;
+            double lux_;
+            std::function<double(uint64_t us)> profile_;
+        };
+    }
+}
@@ -0,0 +1,123 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "cilo72/hw/i2c_bus.h"
+
+namespace cilo72
+{
+    namespace ic
+    {
+        // Fake RTC: runs off the simulated clock, optionally with a drift in
+        // ppm, and charges every register access to the I2C bus.
+        class SD2405
+        {
+        public:
+            static constexpr uint8_t ADDRESS = 0x32;
+
+            class Time
+            {
+            public:
+                Time(uint8_t hour = 0, uint8_t minute = 0, uint8_t second = 0)
+                    : hour_(hour), minute_(minute), second_(second)
+                {
+                }
+
+                uint8_t hour() const { return hour_; }
+                uint8_t minute() const { return minute_; }
+                uint8_t second() const { return second_; }
+
+                void setHour(uint8_t value) { hour_ = wrap(value, 24); }
+                void setMinute(uint8_t value) { minute_ = wrap(value, 60); }
+                void setSecond(uint8_t value) { second_ = wrap(value, 60); }
+
+            private:
+                uint8_t hour_;
+                uint8_t minute_;
+                uint8_t second_;
+
+                static uint8_t wrap(uint8_t value, uint8_t modulo)
+                {
+                    if (value >= modulo)
+                    {
+                        value = value > 127 ? value + modulo : value - modulo;
+                    }
+                    return value;
+                }
+            };
+
+            // The alarm register is battery backed, it already holds the
+            // alarm when the clock boots.
+            SD2405(hw::I2CBus &bus, const Time &alarm = Time(0, 0, 0))
+                : bus_(bus), alarm_(alarm), offsetUs_(0), driftPpm_(0)
+            {
+                sim::i2c().name(ADDRESS, "SD2405");
+            }
+
+            Time time()
+            {
+                bus_.transfer(ADDRESS, 2);
+                bus_.transfer(ADDRESS, 8);
+                return simTime();
+            }
+
+            Time alarm()
+            {
+                bus_.transfer(ADDRESS, 2);
+                bus_.transfer(ADDRESS, 4);
+                return alarm_;
+            }
+
+            void setTime(const Time &time)
+            {
+                bus_.transfer(ADDRESS, 9);
+                simSetTime(time);
+            }
+
+            void setAlarm(const Time &time)
+            {
+                bus_.transfer(ADDRESS, 5);
+                alarm_ = time;
+            }
+
+            Time simTime() const
+            {
+                uint64_t s = simNowUs() / 1000000;
+                return Time((s / 3600) % 24, (s / 60) % 60, s % 60);
+            }
+
+            void simSetTime(const Time &time)
+            {
+                uint64_t us = (uint64_t(time.hour()) * 3600 + time.minute() * 60 + time.second()) * 1000000;
+                offsetUs_   = int64_t(us) - int64_t(simLocalUs());
+            }
+
+            void simSetAlarm(const Time &time) { alarm_ = time; }
+            void simSetDrift(int32_t ppm) { driftPpm_ = ppm; }
+
+        private:
+            hw::I2CBus &bus_;
+            Time alarm_;
+            int64_t offsetUs_;
+            int32_t driftPpm_;
+
+            uint64_t simLocalUs() const
+            {
+                uint64_t now = time_us_64();
+                return now + int64_t(now) * driftPpm_ / 1000000;
+            }
+
+            uint64_t simNowUs() const
+            {
+                int64_t us = int64_t(simLocalUs()) + offsetUs_;
+                int64_t day = int64_t(24) * 3600 * 1000000;
+                return uint64_t(((us % day) + day) % day);
+            }
+        };
+    }
+}
@@ -0,0 +1,76 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <vector>
+#include "pico/stdlib.h"
+
+namespace cilo72
+{
+    namespace ic
+    {
+        // Fake pixel chain: update() costs the 30 us per pixel the PIO needs.
+        class WS2812
+        {
+        public:
+            struct Pixel
+            {
+                uint8_t r = 0;
+                uint8_t g = 0;
+                uint8_t b = 0;
+            };
+
+            WS2812(uint8_t pin, uint32_t count)
+                : pixels_(count), brightness_(15), updates_(0)
+            {
+            }
+
+            void set(uint32_t index, uint8_t r, uint8_t g, uint8_t b)
+            {
+                if (index < pixels_.size())
+                {
+                    pixels_[index] = Pixel{r, g, b};
+                }
+            }
+
+            void set(uint8_t r, uint8_t g, uint8_t b)
+            {
+                for (auto &pixel : pixels_)
+                {
+                    pixel = Pixel{r, g, b};
+                }
+            }
+
+            void setBrightness(uint32_t brightness)
+            {
+                brightness_ = brightness;
+            }
+
+            void update()
+            {
+                sleep_us(30 * pixels_.size());
+                updates_++;
+                if (onUpdate_)
+                {
+                    onUpdate_();
+                }
+            }
+
+            void simOnUpdate(std::function<void()> onUpdate) { onUpdate_ = onUpdate; }
+            const Pixel &simPixel(uint32_t index) const { return pixels_[index]; }
+            uint32_t simBrightness() const { return brightness_; }
+            uint32_t simUpdates() const { return updates_; }
+
+        private:
+            std::vector<Pixel> pixels_;
+            uint32_t brightness_;
+            uint32_t updates_;
+            std::function<void()> onUpdate_;
+        };
+    }
+}
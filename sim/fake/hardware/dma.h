@@ -0,0 +1,100 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "simhw.h"
+
+enum dma_channel_transfer_size
+{
+    DMA_SIZE_8  = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+#define DREQ_PIO0_TX0 0
+#define DREQ_PIO0_TX1 1
+#define DREQ_PIO0_TX2 2
+#define DREQ_PIO0_TX3 3
+#define DREQ_I2C0_TX  32
+#define DREQ_I2C1_TX  34
+#define DREQ_UART0_TX 20
+#define DREQ_UART1_TX 22
+
+struct dma_channel_config
+{
+    uint32_t size;
+    bool readIncrement;
+    bool writeIncrement;
+    uint32_t dreq;
+};
+
+inline int dma_claim_unused_channel(bool required)
+{
+    return sim::dma().claim();
+}
+
+inline dma_channel_config dma_channel_get_default_config(unsigned int channel)
+{
+    return dma_channel_config{DMA_SIZE_32, true, false, 0x3f};
+}
+
+inline void channel_config_set_transfer_data_size(dma_channel_config *c, dma_channel_transfer_size size)
+{
+    c->size = size;
+}
+
+inline void channel_config_set_read_increment(dma_channel_config *c, bool increment)
+{
+    c->readIncrement = increment;
+}
+
+inline void channel_config_set_write_increment(dma_channel_config *c, bool increment)
+{
+    c->writeIncrement = increment;
+}
+
+inline void channel_config_set_dreq(dma_channel_config *c, unsigned int dreq)
+{
+    c->dreq = dreq;
+}
+
+inline void dma_channel_configure(unsigned int channel, const dma_channel_config *config, volatile void *write_addr,
+                                  const volatile void *read_addr, unsigned int transfer_count, bool trigger)
+{
+    sim::Dma::Channel &c = sim::dma().channel(channel);
+    c.write              = write_addr;
+    c.size               = 1u << config->size;
+    if (trigger)
+    {
+        sim::dma().start(channel, const_cast<const void *>(read_addr), transfer_count);
+    }
+}
+
+inline void dma_channel_transfer_from_buffer_now(unsigned int channel, const volatile void *read_addr, uint32_t transfer_count)
+{
+    sim::dma().start(channel, const_cast<const void *>(read_addr), transfer_count);
+}
+
+inline bool dma_channel_is_busy(unsigned int channel)
+{
+    return sim::dma().channel(channel).busy;
+}
+
+inline void dma_channel_set_irq0_enabled(unsigned int channel, bool enabled)
+{
+    sim::dma().channel(channel).irq0 = enabled;
+}
+
+inline bool dma_channel_get_irq0_status(unsigned int channel)
+{
+    return sim::dma().channel(channel).irq0Status;
+}
+
+inline void dma_channel_acknowledge_irq0(unsigned int channel)
+{
+    sim::dma().channel(channel).irq0Status = false;
+}
@@ -0,0 +1,27 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "simhw.h"
+
+#define FLASH_PAGE_SIZE       sim::Flash::PAGE
+#define FLASH_SECTOR_SIZE     sim::Flash::SECTOR
+#define PICO_FLASH_SIZE_BYTES sim::Flash::SIZE
+
+// Flash reads go through the XIP window, here the simulated image.
+#define XIP_BASE (reinterpret_cast<uintptr_t>(sim::flash().image()))
+
+inline void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    sim::flash().erase(flash_offs, count);
+}
+
+inline void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    sim::flash().program(flash_offs, data, count);
+}
@@ -0,0 +1,150 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include "simclock.h"
+
+typedef unsigned int uint;
+
+enum gpio_irq_level
+{
+    GPIO_IRQ_LEVEL_LOW  = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL  = 0x4u,
+    GPIO_IRQ_EDGE_RISE  = 0x8u,
+};
+
+#define GPIO_IN  false
+#define GPIO_OUT true
+
+enum gpio_function
+{
+    GPIO_FUNC_I2C  = 3,
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_SIO  = 5,
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+namespace sim
+{
+    // Input levels and GPIO interrupt routing. Keys are active low, so a
+    // press is a falling edge.
+    class Gpio
+    {
+    public:
+        static Gpio &instance()
+        {
+            static Gpio gpio;
+            return gpio;
+        }
+
+        void enable(uint gpio, uint32_t events, bool enabled)
+        {
+            if (enabled)
+            {
+                events_[gpio] |= events;
+            }
+            else
+            {
+                events_[gpio] &= ~events;
+            }
+        }
+
+        void setCallback(gpio_irq_callback_t callback)
+        {
+            callback_ = callback;
+        }
+
+        void pullUp(uint gpio)
+        {
+            if (levels_.find(gpio) == levels_.end())
+            {
+                levels_[gpio] = true;
+            }
+        }
+
+        bool get(uint gpio) const
+        {
+            auto it = levels_.find(gpio);
+            return it != levels_.end() and it->second;
+        }
+
+        // Drives the pin from outside and raises its edge interrupt.
+        void set(uint gpio, bool high)
+        {
+            if (get(gpio) != high)
+            {
+                levels_[gpio] = high;
+                edge(gpio, high);
+            }
+        }
+
+        void edge(uint gpio, bool rise)
+        {
+            uint32_t event = rise ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+            auto it        = events_.find(gpio);
+            if (callback_ and it != events_.end() and (it->second & event))
+            {
+                callback_(gpio, event);
+                clock().wake();
+            }
+        }
+
+    private:
+        Gpio()
+            : callback_(nullptr)
+        {
+        }
+
+        gpio_irq_callback_t callback_;
+        std::map<uint, uint32_t> events_;
+        std::map<uint, bool> levels_;
+    };
+
+    inline Gpio &gpio() { return Gpio::instance(); }
+}
+
+inline void gpio_init(uint gpio)
+{
+}
+
+inline void gpio_set_dir(uint gpio, bool out)
+{
+}
+
+inline void gpio_set_function(uint gpio, gpio_function fn)
+{
+}
+
+inline void gpio_pull_up(uint gpio)
+{
+    sim::gpio().pullUp(gpio);
+}
+
+inline bool gpio_get(uint gpio)
+{
+    return sim::gpio().get(gpio);
+}
+
+inline void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled)
+{
+    sim::gpio().enable(gpio, events, enabled);
+}
+
+inline void gpio_set_irq_callback(gpio_irq_callback_t callback)
+{
+    sim::gpio().setCallback(callback);
+}
+
+inline void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback)
+{
+    gpio_set_irq_enabled(gpio, events, enabled);
+    gpio_set_irq_callback(callback);
+}
@@ -0,0 +1,69 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "simbus.h"
+
+#define I2C_IC_DATA_CMD_STOP_BITS        0x00000200u
+#define I2C_IC_INTR_MASK_M_STOP_DET_BITS 0x00000200u
+#define I2C_IC_STATUS_ACTIVITY_BITS      0x00000001u
+
+// The registers the DMA path touches. Writes of IC_DATA_CMD words arrive
+// through the DMA model, see sim::Dma.
+struct i2c_hw_t
+{
+    volatile uint32_t enable;
+    volatile uint32_t tar;
+    volatile uint32_t data_cmd;
+    volatile uint32_t intr_mask;
+    volatile uint32_t clr_stop_det;
+    volatile uint32_t txflr;
+    volatile uint32_t status;
+};
+
+struct i2c_inst_t
+{
+    i2c_hw_t *hw;
+    uint32_t index;
+};
+
+inline i2c_hw_t i2c0_hw_inst = {};
+inline i2c_hw_t i2c1_hw_inst = {};
+inline i2c_inst_t i2c0_inst  = {&i2c0_hw_inst, 0};
+inline i2c_inst_t i2c1_inst  = {&i2c1_hw_inst, 1};
+
+inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c)
+{
+    return i2c->hw;
+}
+
+inline unsigned int i2c_hw_index(i2c_inst_t *i2c)
+{
+    return i2c->index;
+}
+
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+inline unsigned int i2c_set_baudrate(i2c_inst_t *i2c, unsigned int baudrate)
+{
+    sim::i2c().setHz(baudrate);
+    return baudrate;
+}
+
+inline int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    sim::i2c().write(addr, src, len);
+    return int(len);
+}
+
+inline int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop)
+{
+    sim::i2c().read(addr, dst, len);
+    return int(len);
+}
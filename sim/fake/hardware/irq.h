@@ -0,0 +1,39 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "simhw.h"
+
+#define TIMER_IRQ_0 0
+#define TIMER_IRQ_1 1
+#define TIMER_IRQ_2 2
+#define TIMER_IRQ_3 3
+#define DMA_IRQ_0   11
+#define DMA_IRQ_1   12
+#define UART0_IRQ   20
+#define UART1_IRQ   21
+#define I2C0_IRQ    23
+#define I2C1_IRQ    24
+
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+typedef void (*irq_handler_t)();
+
+inline void irq_set_exclusive_handler(unsigned int num, irq_handler_t handler)
+{
+    sim::irq().setHandler(num, handler);
+}
+
+inline void irq_add_shared_handler(unsigned int num, irq_handler_t handler, uint8_t order_priority)
+{
+    sim::irq().setHandler(num, handler);
+}
+
+inline void irq_set_enabled(unsigned int num, bool enabled)
+{
+    sim::irq().enable(num, enabled);
+}
@@ -0,0 +1,69 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "simclock.h"
+
+// A real fence: the mailbox test runs the two cores as host threads.
+inline void __dmb()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+inline void __sev()
+{
+    sim::clock().wake();
+}
+
+inline void __wfe()
+{
+    sim::clock().sleepUntil(sim::Clock::never);
+}
+
+inline void __wfi()
+{
+    sim::clock().sleepUntil(sim::Clock::never);
+}
+
+inline uint32_t save_and_disable_interrupts()
+{
+    return 0;
+}
+
+inline void restore_interrupts(uint32_t status)
+{
+}
+
+// Hardware spin locks; the simulation runs both cores on one thread, so
+// taking one never has to wait.
+typedef volatile uint32_t spin_lock_t;
+
+inline int spin_lock_claim_unused(bool required)
+{
+    static int next = 0;
+    return 16 + next++ % 16;
+}
+
+inline spin_lock_t *spin_lock_init(uint32_t lock_num)
+{
+    static spin_lock_t locks[32];
+    locks[lock_num] = 0;
+    return &locks[lock_num];
+}
+
+inline uint32_t spin_lock_blocking(spin_lock_t *lock)
+{
+    *lock = 1;
+    return save_and_disable_interrupts();
+}
+
+inline void spin_unlock(spin_lock_t *lock, uint32_t saved_irq)
+{
+    *lock = 0;
+    restore_interrupts(saved_irq);
+}
@@ -0,0 +1,69 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "simhw.h"
+#include "hardware/irq.h"
+
+enum uart_parity_t
+{
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD
+};
+
+struct uart_inst_t
+{
+    uint32_t index;
+};
+
+inline uart_inst_t uart0_inst = {0};
+inline uart_inst_t uart1_inst = {1};
+
+#define uart0 (&uart0_inst)
+#define uart1 (&uart1_inst)
+
+inline unsigned int uart_get_index(uart_inst_t *uart)
+{
+    return uart->index;
+}
+
+inline unsigned int uart_init(uart_inst_t *uart, unsigned int baudrate)
+{
+    sim::uartPort(uart->index).reset();
+    return baudrate;
+}
+
+inline void uart_set_format(uart_inst_t *uart, unsigned int data_bits, unsigned int stop_bits, uart_parity_t parity)
+{
+}
+
+inline void uart_set_fifo_enabled(uart_inst_t *uart, bool enabled)
+{
+}
+
+inline void uart_set_irq_enables(uart_inst_t *uart, bool rx_has_data, bool tx_needs_data)
+{
+    sim::uartPort(uart->index).enableRxIrq(rx_has_data);
+}
+
+// Takes the bytes into the TX FIFO at once, see sim::UartPort.
+inline void uart_write_blocking(uart_inst_t *uart, const uint8_t *src, size_t len)
+{
+    sim::uartPort(uart->index).write(src, len);
+}
+
+inline bool uart_is_readable(uart_inst_t *uart)
+{
+    return sim::uartPort(uart->index).readable();
+}
+
+inline char uart_getc(uart_inst_t *uart)
+{
+    return char(sim::uartPort(uart->index).getc());
+}
@@ -0,0 +1,20 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+// The simulation runs core1 between the passes of core0, it never has to
+// be held.
+inline void multicore_lockout_victim_init()
+{
+}
+
+inline void multicore_lockout_start_blocking()
+{
+}
+
+inline void multicore_lockout_end_blocking()
+{
+}
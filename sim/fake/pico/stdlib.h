@@ -0,0 +1,36 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+// Host stand-in for the parts of the Pico SDK the alarm clock uses.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/uart.h"
+#include "simhw.h"
+
+#define PICO_DEFAULT_LED_PIN 25
+#define PICO_ERROR_TIMEOUT   -1
+
+inline bool stdio_init_all()
+{
+    return true;
+}
+
+// Returns at once, the sim has no host to wait for.
+inline int getchar_timeout_us(uint32_t timeout_us)
+{
+    int c = sim::console().getc();
+    return c < 0 ? PICO_ERROR_TIMEOUT : c;
+}
+
+inline void stdio_set_chars_available_callback(void (*fn)(void *), void *param)
+{
+    sim::console().setCallback(fn, param);
+}
@@ -0,0 +1,123 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "simclock.h"
+#include "simhw.h"
+
+typedef uint64_t absolute_time_t;
+
+static constexpr absolute_time_t at_the_end_of_time = UINT64_MAX;
+static constexpr absolute_time_t nil_time           = 0;
+
+inline uint64_t time_us_64()
+{
+    return sim::clock().now();
+}
+
+inline uint32_t time_us_32()
+{
+    return static_cast<uint32_t>(sim::clock().now());
+}
+
+inline uint64_t to_us_since_boot(absolute_time_t t)
+{
+    return t;
+}
+
+inline uint32_t to_ms_since_boot(absolute_time_t t)
+{
+    return static_cast<uint32_t>(t / 1000);
+}
+
+inline absolute_time_t from_us_since_boot(uint64_t us)
+{
+    return us;
+}
+
+inline absolute_time_t get_absolute_time()
+{
+    return sim::clock().now();
+}
+
+inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us)
+{
+    return t >= at_the_end_of_time - us ? at_the_end_of_time : t + us;
+}
+
+inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms)
+{
+    return delayed_by_us(t, uint64_t(ms) * 1000);
+}
+
+inline absolute_time_t make_timeout_time_us(uint64_t us)
+{
+    return delayed_by_us(get_absolute_time(), us);
+}
+
+inline absolute_time_t make_timeout_time_ms(uint32_t ms)
+{
+    return delayed_by_ms(get_absolute_time(), ms);
+}
+
+inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{
+    return int64_t(to - from);
+}
+
+inline absolute_time_t absolute_time_min(absolute_time_t a, absolute_time_t b)
+{
+    return a < b ? a : b;
+}
+
+inline bool is_at_the_end_of_time(absolute_time_t t)
+{
+    return t == at_the_end_of_time;
+}
+
+inline bool time_reached(absolute_time_t t)
+{
+    return sim::clock().now() >= t;
+}
+
+inline void sleep_us(uint64_t us)
+{
+    sim::clock().advance(us);
+}
+
+inline void sleep_ms(uint32_t ms)
+{
+    sim::clock().advance(uint64_t(ms) * 1000);
+}
+
+// The simulated core sleeps until the deadline or until an interrupt fires.
+inline bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp)
+{
+    return sim::clock().sleepUntil(timeout_timestamp);
+}
+
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+inline alarm_id_t add_alarm_at(absolute_time_t time, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    if (not fire_if_past and time_reached(time))
+    {
+        return 0;
+    }
+    return sim::timer().add(time, callback, user_data);
+}
+
+inline alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    return add_alarm_at(make_timeout_time_us(us), callback, user_data, fire_if_past);
+}
+
+inline bool cancel_alarm(alarm_id_t alarm_id)
+{
+    return sim::timer().cancel(alarm_id);
+}
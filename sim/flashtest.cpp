@@ -0,0 +1,247 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "flashtest.h"
+#include "flashstore.h"
+#include "simulation.h"
+#include <algorithm>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static constexpr uint32_t KEYS = FlashStore::KEYS;
+
+struct Values
+{
+  bool present[KEYS] = {};
+  uint32_t value[KEYS] = {};
+};
+
+static Values read(const FlashStore &store)
+{
+  Values values;
+  for (uint8_t key = 0; key < KEYS; key++)
+  {
+    values.present[key] = store.has(key);
+    values.value[key]   = store.get(key);
+  }
+  return values;
+}
+
+static bool same(const Values &values, uint8_t key, bool present, uint32_t value)
+{
+  return values.present[key] == present and (not present or values.value[key] == value);
+}
+
+// A few keys change most of the time and now and then all of them, so
+// sectors fill and compact often, and cuts hit compactions in a row.
+static int torture(uint32_t cycles)
+{
+  char path[] = "/tmp/alarm_clock_flashXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0 or not sim::flash().open(path))
+  {
+    printf("FAIL: no flash image file\n");
+    return 1;
+  }
+  close(fd);
+
+  sim::clock().reset();
+  sim::flash().reset();
+  std::mt19937 random(25);
+
+  int failures = 0;
+  Values committed;
+  Values pending;
+  Values restored;
+  bool changed[KEYS] = {};
+  uint32_t compactions = 0;
+
+  for (uint32_t cycle = 0; cycle <= cycles; cycle++)
+  {
+    FlashStore store;
+    restored = read(store);
+    for (uint8_t key = 0; key < KEYS; key++)
+    {
+      bool before = same(restored, key, committed.present[key], committed.value[key]);
+      bool after  = changed[key] and same(restored, key, true, pending.value[key]);
+      if (not before and not after)
+      {
+        printf("FAIL: cycle %u key %u is %s%08x\n", cycle, key, restored.present[key] ? "" : "absent ",
+               restored.value[key]);
+        failures++;
+      }
+    }
+    if (failures > 0 or cycle == cycles)
+    {
+      break;
+    }
+
+    committed = restored;
+    std::fill(changed, changed + KEYS, false);
+    uint32_t batch = random() % 8 == 0 ? KEYS : 1 + random() % 6;
+    for (uint32_t i = 0; i < batch; i++)
+    {
+      uint8_t key         = random() % (random() % 4 == 0 ? KEYS : 4);
+      pending.value[key]  = random();
+      changed[key]        = true;
+      store.set(key, pending.value[key]);
+    }
+
+    if (random() % 2 == 0)
+    {
+      // In an append, in an erase, or in the copies after one.
+      static constexpr uint32_t from[] = {0, 0, FLASH_SECTOR_SIZE};
+      static constexpr uint32_t span[] = {FLASH_PAGE_SIZE, FLASH_SECTOR_SIZE, (KEYS + 2) * FlashStore::RECORD};
+      uint32_t where = random() % 3;
+      sim::flash().cutAfter(from[where] + random() % span[where], random());
+    }
+    try
+    {
+      store.flush();
+      compactions += store.compactions();
+      for (uint8_t key = 0; key < KEYS; key++)
+      {
+        if (changed[key])
+        {
+          committed.present[key] = true;
+          committed.value[key]   = pending.value[key];
+        }
+      }
+      std::fill(changed, changed + KEYS, false);
+    }
+    catch (const sim::Flash::PowerCut &)
+    {
+    }
+    sim::flash().cutAfter(sim::Flash::never);
+  }
+
+  // The file keeps the image over a remap, as over a run of its own.
+  sim::flash().close();
+  sim::flash().open(path);
+  Values reopened = read(FlashStore());
+  for (uint8_t key = 0; key < KEYS; key++)
+  {
+    if (not same(reopened, key, restored.present[key], restored.value[key]))
+    {
+      printf("FAIL: key %u lost with the image file\n", key);
+      failures++;
+    }
+  }
+  sim::flash().close();
+  unlink(path);
+
+  uint32_t first = FlashStore::OFFSET / FLASH_SECTOR_SIZE;
+  uint32_t least = UINT32_MAX;
+  uint32_t most  = 0;
+  for (uint32_t i = 0; i < FlashStore::SECTORS; i++)
+  {
+    least = std::min(least, sim::flash().erases(first + i));
+    most  = std::max(most, sim::flash().erases(first + i));
+  }
+  if (sim::flash().misuses() > 0)
+  {
+    printf("FAIL: %u misaligned programs or erases, or programs that needed an erase\n", sim::flash().misuses());
+    failures++;
+  }
+  if (most > least + least / 10 + 2)
+  {
+    printf("FAIL: sectors erased %u to %u times\n", least, most);
+    failures++;
+  }
+
+  printf("  torture   : %u cycles, %llu power cuts, %u compactions, %u to %u erases per sector\n", cycles,
+         (unsigned long long)sim::flash().cuts(), compactions, least, most);
+  return failures;
+}
+
+// Settings changed well before the alarm reach flash, the volume turned up
+// just before it only once the alarm is stopped; after a power cycle the
+// clock comes back with all of it.
+static int restart()
+{
+  using S = Simulation;
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+  sim::flash().reset();
+
+  int failures = 0;
+  uint32_t before;
+  uint32_t around;
+  uint32_t sequence;
+  uint32_t appended;
+  {
+    Simulation s(5, true, cilo72::ic::SD2405::Time(7, 0, 0));
+    s.rtc.simSetTime(cilo72::ic::SD2405::Time(6, 50, 0));
+    s.alarmClock().setAlarmOn(true);
+    s.alarmClock().setSunriseMinutes(0);
+    s.alarmClock().setSnoozeMinutes(5);
+    s.alarmClock().setBrightness(4, {77, 9});
+    s.alarmClock().addAlarm({8, 15, 0x60, Alarms::Alarm::Enabled | Alarms::Alarm::OneShot});
+    s.alarmClock().alarmAudio().setRamp(30, AlarmAudio::Curve::Cubic);
+    s.alarmClock().setTransition(Frame::Transition::Dither);
+    s.runUntil(S::MINUTE);
+    if (s.settings().store().sequence() == 0)
+    {
+      printf("FAIL: the settings were not written\n");
+      failures++;
+    }
+
+    // The alarm rings at 07:00, 10 minutes in.
+    s.runUntil(8 * S::MINUTE + 30 * S::SECOND);
+    s.dfPlayer.setVolume(22);
+    before = sim::flash().programs();
+    s.press(S::KEY_ALARM, 12 * S::MINUTE);
+    s.runUntil(12 * S::MINUTE + S::SECOND);
+    around = sim::flash().programs();
+    s.alarmClock().setAlarmOn(true);
+    s.runUntil(14 * S::MINUTE);
+
+    if (around != before or sim::flash().programs() == around)
+    {
+      printf("FAIL: %u flash programs around the alarm, %u after it\n", around - before,
+             sim::flash().programs() - around);
+      failures++;
+    }
+    sequence = s.settings().store().sequence();
+    appended = s.settings().store().appended();
+  }
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+
+  Simulation s(5, true, cilo72::ic::SD2405::Time(7, 0, 0));
+  s.runUntil(S::SECOND);
+  AlarmClock &clock     = s.alarmClock();
+  const Alarms &alarms  = clock.alarms();
+  bool alarmsBack       = alarms.count() == 2 and alarms.alarm(1).hour == 8 and alarms.alarm(1).minute == 15 and
+                          alarms.alarm(1).weekdays == 0x60 and alarms.alarm(1).is(Alarms::Alarm::OneShot);
+  bool rampBack         = clock.alarmAudio().rampSeconds() == 30 and clock.alarmAudio().curve() == AlarmAudio::Curve::Cubic;
+  if (not clock.alarmOn() or clock.sunriseMinutes() != 0 or clock.snoozeMinutes() != 5 or
+      clock.ambient().brightness(4).oled != 77 or clock.ambient().brightness(4).pixel != 9 or not alarmsBack or
+      not rampBack or s.dfPlayer.volume() != 22 or s.dfPlayerModel.volume() != 22 or
+      clock.transition() != Frame::Transition::Dither)
+  {
+    printf("FAIL: settings after the power cycle: alarm %d, sunrise %u, snooze %u, brightness %u/%u, alarms %d, "
+           "ramp %d, volume %d, transition %u\n", clock.alarmOn(), clock.sunriseMinutes(), clock.snoozeMinutes(),
+           clock.ambient().brightness(4).oled, clock.ambient().brightness(4).pixel, alarmsBack, rampBack,
+           s.dfPlayer.volume(), unsigned(clock.transition()));
+    failures++;
+  }
+
+  printf("  restart   : log at sequence %u, %u records appended\n", sequence, appended);
+  return failures;
+}
+
+int flashTest(uint32_t cycles)
+{
+  int failures = torture(cycles) + restart();
+  printf(failures ? "FAIL: %d\n" : "OK\n", failures);
+  return failures;
+}
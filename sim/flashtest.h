@@ -0,0 +1,15 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Cuts the power to a FlashStore in a file-backed flash image at random
+// points of cycles batches of changes, mid-program and mid-erase, and checks
+// after every restart that each key holds its old or its new value. Then
+// takes the clock's settings through a power cycle and checks that nothing
+// was written to flash around the alarm. Returns the number of failures.
+int flashTest(uint32_t cycles);
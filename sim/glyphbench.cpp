@@ -0,0 +1,195 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "glyphbench.h"
+#include "compositor.h"
+#include <chrono>
+#include <stdio.h>
+
+// What Layer::drawString did before the glyphs were prepared: a square per
+// pixel of the font.
+static void legacyDrawString(Layer &layer, int32_t x, int32_t y, uint32_t scale, const char *s, Layer::Color color)
+{
+  for (; *s; s++)
+  {
+    const uint8_t *glyph = font8x5.glyph(*s);
+    for (uint32_t column = 0; column < font8x5.width(); column++)
+    {
+      for (uint32_t bit = 0; bit < font8x5.height(); bit++)
+      {
+        if (glyph[column] & (1 << bit))
+        {
+          layer.drawSquare(x + column * scale, y + bit * scale, scale, scale, color);
+        }
+      }
+    }
+    x += (font8x5.width() + 1) * scale;
+  }
+}
+
+static uint32_t differences(const Layer &a, const Layer &b)
+{
+  uint32_t count = 0;
+  for (int32_t x = 0; x < int32_t(Layer::WIDTH); x++)
+  {
+    for (int32_t y = 0; y < int32_t(Layer::HEIGHT); y++)
+    {
+      if (a.pixel(x, y) != b.pixel(x, y) or a.covers(x, y) != b.covers(x, y))
+      {
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+// Each digit and ':' at both prepared scales, in both colours, off the page
+// grid and across the seam and the edges of the canvas, over a background.
+static int same()
+{
+  static const char *strings[] = {"0123", "4567", "89:", "12:34"};
+  static const int32_t xs[]    = {-7, 0, 1, 40, 100, 129, 230};
+  static const int32_t ys[]    = {-5, 0, 1, 4, 18, 33};
+
+  int failures = 0;
+  for (uint32_t scale : {4u, 8u})
+  {
+    for (const char *s : strings)
+    {
+      for (int32_t x : xs)
+      {
+        for (int32_t y : ys)
+        {
+          for (Layer::Color color : {Layer::Color::White, Layer::Color::Black})
+          {
+            Layer legacy;
+            Layer prepared;
+            for (Layer *layer : {&legacy, &prepared})
+            {
+              layer->drawSquare(20, 10, 150, 20, Layer::Color::White);
+              layer->clear(60, 12, 10, 40);
+            }
+            legacyDrawString(legacy, x, y, scale, s, color);
+            prepared.drawString(x, y, scale, s, color);
+
+            uint32_t count = differences(legacy, prepared);
+            if (count > 0)
+            {
+              printf("FAIL: \"%s\" at scale %u at (%d, %d) differs in %u pixels\n", s, scale, x, y, count);
+              failures++;
+            }
+          }
+        }
+      }
+    }
+  }
+  return failures;
+}
+
+// Scale2x only rounds the corners of the diagonals off: the smooth digit
+// keeps two thirds of the block one at least and stays in its box.
+static int smooth()
+{
+  int failures = 0;
+  for (char c = '0'; c <= ':'; c++)
+  {
+    char s[2] = {c, 0};
+    Layer block;
+    Layer smooth;
+    block.drawString(0, 0, 8, s);
+    smooth.drawString(0, 0, smoothDigits, s);
+
+    uint32_t set     = 0;
+    uint32_t missing = 0;
+    uint32_t outside = 0;
+    for (int32_t x = 0; x < int32_t(Layer::WIDTH); x++)
+    {
+      for (int32_t y = 0; y < int32_t(Layer::HEIGHT); y++)
+      {
+        set += block.pixel(x, y) ? 1 : 0;
+        missing += block.pixel(x, y) and not smooth.pixel(x, y) ? 1 : 0;
+        outside += smooth.pixel(x, y) and x >= int32_t(smoothDigits.width()) ? 1 : 0;
+      }
+    }
+    if (differences(block, smooth) == 0 and c != '1' and c != ':')
+    {
+      printf("FAIL: smooth '%c' is the block glyph\n", c);
+      failures++;
+    }
+    if (missing * 3 > set or outside > 0)
+    {
+      printf("FAIL: smooth '%c' misses %u of %u pixels, %u outside\n", c, missing, set, outside);
+      failures++;
+    }
+  }
+  return failures;
+}
+
+// Both halves of the clock view as Renderer draws them, for every minute of
+// the day. The best of a few rounds, the host is not quiet.
+template <typename Draw>
+static double redrawNs(uint32_t redraws, Draw draw)
+{
+  static constexpr uint32_t ROUNDS = 5;
+
+  Layer layer;
+  char s[4];
+  double best = 0.0;
+  for (uint32_t round = 0; round < ROUNDS; round++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < redraws / ROUNDS; i++)
+    {
+      uint32_t minute = i % (24 * 60);
+      sprintf(s, "%02u", minute / 60);
+      layer.clear(0, 0, Oled::WIDTH, Layer::HEIGHT);
+      draw(layer, 40, s);
+      sprintf(s, "%02u", minute % 60);
+      layer.clear(Oled::WIDTH, 0, Oled::WIDTH, Layer::HEIGHT);
+      draw(layer, Oled::WIDTH + 1, s);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                (redraws / ROUNDS);
+    best = round == 0 or ns < best ? ns : best;
+  }
+  return best;
+}
+
+int glyphBench(uint32_t redraws)
+{
+  int failures = same() + smooth();
+
+  double clearNs = redrawNs(redraws, [](Layer &, int32_t, const char *) {});
+  double legacyNs = redrawNs(redraws, [](Layer &layer, int32_t x, const char *s)
+  {
+    legacyDrawString(layer, x, 1, 8, s, Layer::Color::White);
+  });
+  double preparedNs = redrawNs(redraws, [](Layer &layer, int32_t x, const char *s)
+  {
+    layer.drawString(x, 1, 8, s);
+  });
+  double smoothNs = redrawNs(redraws, [](Layer &layer, int32_t x, const char *s)
+  {
+    layer.drawString(x, 1, smoothDigits, s);
+  });
+
+  const Glyphs &digits8 = *font8x5.scaled(8);
+  printf("clock redraws       : %u\n", redraws);
+  printf("                      %12s %12s %12s\n", "pixels", "scaled", "smooth");
+  printf("ns per redraw       : %12.1f %12.1f %12.1f\n", legacyNs, preparedNs, smoothNs);
+  printf("  drawing digits    : %12.1f %12.1f %12.1f\n", legacyNs - clearNs, preparedNs - clearNs, smoothNs - clearNs);
+  printf("  speedup           : %12.2f %12.2f %12.2f\n", 1.0, (legacyNs - clearNs) / (preparedNs - clearNs),
+         (legacyNs - clearNs) / (smoothNs - clearNs));
+  printf("flash bytes         : %12u %12u %12u (%u uncompressed)\n", 0, digits8.bytes(), smoothDigits.bytes(),
+         digits8.bytes());
+
+  if (failures > 0)
+  {
+    printf("FAIL: %d\n", failures);
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,13 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Cost of a clock redraw with the pre-scaled and the compressed digits
+// against drawing font8x5 pixel by pixel, and that the pre-scaled glyphs
+// draw exactly what the pixels did.
+int glyphBench(uint32_t redraws);
@@ -0,0 +1,155 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "i2ctest.h"
+#include "i2cdma.h"
+#include "simbus.h"
+#include "simclock.h"
+#include <random>
+#include <stdio.h>
+
+static constexpr uint8_t RTC   = 0x32;
+static constexpr uint8_t LUX   = 0x23;
+static constexpr uint8_t LEFT  = 0x3D;
+static constexpr uint8_t RIGHT = 0x3C;
+
+static constexpr uint32_t PAGES = 8;
+static constexpr uint32_t WIDTH = 128;
+
+// A window per page like Oled sends them: the data control byte and a page.
+struct Flush
+{
+  uint16_t words[PAGES * (WIDTH + 1)];
+  volatile bool busy = false;
+
+  Flush()
+  {
+    uint16_t *p = words;
+    for (uint32_t page = 0; page < PAGES; page++)
+    {
+      *p++ = 0x40;
+      for (uint32_t column = 0; column < WIDTH; column++)
+      {
+        *p++ = uint16_t((page * WIDTH + column) & 0xFF);
+      }
+      p[-1] |= I2cDma::STOP;
+    }
+  }
+};
+
+// A window at 400 kHz with its address byte, the most an RTC read waits.
+static uint64_t windowUs()
+{
+  return (uint64_t(WIDTH + 2) * 9 * 1000000 + I2cDma::FAST_MODE - 1) / I2cDma::FAST_MODE;
+}
+
+static uint64_t flushUs(I2cDma &bus, Flush &flush, uint8_t address)
+{
+  uint64_t start = sim::clock().now();
+  bus.submit(address, flush.words, sizeof(flush.words) / sizeof(flush.words[0]), flush.busy);
+  bus.wait();
+  return sim::clock().now() - start;
+}
+
+int i2cTest(uint32_t rounds)
+{
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::i2c().setHz(I2cDma::FAST_MODE);
+
+  uint64_t received[256] = {};
+  for (uint8_t address : {LEFT, RIGHT})
+  {
+    sim::i2c().attach(address, [&received, address](const uint8_t *data, size_t length) { received[address] += length; });
+  }
+
+  I2cDma bus(i2c1);
+  Flush left;
+  Flush right;
+  std::mt19937 random(7);
+  int failures = 0;
+  uint64_t maxRtcWait = 0;
+
+  for (uint32_t round = 0; round < rounds; round++)
+  {
+    bus.submit(LEFT, left.words, sizeof(left.words) / sizeof(left.words[0]), left.busy);
+    bus.submit(RIGHT, right.words, sizeof(right.words) / sizeof(right.words[0]), right.busy);
+
+    // Somewhere in the first flush: the RTC goes ahead of both.
+    sim::clock().advance(random() % (2 * PAGES * windowUs()));
+    uint64_t asked = sim::clock().now();
+    {
+      I2cDma::Claim claim(bus, RTC, I2cDma::Priority::Clock);
+      uint64_t wait = sim::clock().now() - asked;
+      maxRtcWait    = wait > maxRtcWait ? wait : maxRtcWait;
+      if (wait > windowUs())
+      {
+        printf("FAIL: round %u: the RTC waited %llu us for the bus\n", round, (unsigned long long)wait);
+        failures++;
+      }
+      sim::i2c().transfer(RTC, 9);
+    }
+
+    // The light sensor comes after the displays.
+    {
+      I2cDma::Claim claim(bus, LUX, I2cDma::Priority::Light);
+      if (left.busy or right.busy)
+      {
+        printf("FAIL: round %u: the light sensor got the bus before the flushes\n", round);
+        failures++;
+      }
+      sim::i2c().transfer(LUX, 3);
+    }
+    bus.wait();
+  }
+
+  uint64_t frame = sizeof(left.words) / sizeof(left.words[0]);
+  for (uint8_t address : {LEFT, RIGHT})
+  {
+    if (received[address] != rounds * frame)
+    {
+      printf("FAIL: 0x%02X received %llu bytes, expected %llu\n", address, (unsigned long long)received[address],
+             (unsigned long long)(rounds * frame));
+      failures++;
+    }
+  }
+
+  if (sim::i2c().collisions() > 0)
+  {
+    printf("FAIL: %u blocking transfers while the DMA owned the bus\n", sim::i2c().collisions());
+    failures++;
+  }
+
+  uint64_t slow = flushUs(bus, left, LEFT);
+  bus.setSpeed(LEFT, I2cDma::FAST_MODE_PLUS);
+  uint64_t fast = flushUs(bus, left, LEFT);
+  if (fast * I2cDma::FAST_MODE_PLUS > slow * I2cDma::FAST_MODE * 11 / 10)
+  {
+    printf("FAIL: a flush took %llu us at Fast-mode Plus, %llu us at Fast-mode\n", (unsigned long long)fast,
+           (unsigned long long)slow);
+    failures++;
+  }
+  {
+    I2cDma::Claim claim(bus, RTC, I2cDma::Priority::Clock);
+    if (sim::i2c().hz() != I2cDma::FAST_MODE)
+    {
+      printf("FAIL: the RTC is read at %u Hz\n", sim::i2c().hz());
+      failures++;
+    }
+  }
+
+  printf("I2C scheduler: %u rounds, RTC waited up to %llu us (a window takes %llu us), flush %llu us at 400 kHz, "
+         "%llu us at 1 MHz, bus %.1f%% busy\n",
+         rounds, (unsigned long long)maxRtcWait, (unsigned long long)windowUs(), (unsigned long long)slow,
+         (unsigned long long)fast, 100.0 * bus.busyUs() / sim::clock().now());
+  for (uint32_t i = 0; i < bus.devices(); i++)
+  {
+    const I2cDma::Device &device = bus.device(i);
+    printf("  0x%02X : %4u kHz %6u requests, waited up to %llu us\n", device.address, device.hz / 1000, device.requests,
+           (unsigned long long)device.maxWaitUs);
+  }
+  printf(failures ? "FAIL: %d\n" : "OK\n", failures);
+  return failures;
+}
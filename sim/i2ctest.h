@@ -0,0 +1,16 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Drives the I2C scheduler with full frame flushes to both panels while RTC
+// and light sensor reads claim the bus at random moments. An RTC read has
+// to get the bus within one flush window, a light read only once the
+// flushes are through, every flush has to arrive complete and no blocking
+// transfer may overlap the DMA. A panel at Fast-mode Plus has to flush in
+// proportionally less time. Returns the number of failures.
+int i2cTest(uint32_t rounds);
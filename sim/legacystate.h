@@ -0,0 +1,111 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <functional>
+#include "pico/time.h"
+
+// The std::function based State and StateMachine the clock used before the
+// state table, kept as the reference for the states benchmark.
+namespace legacy
+{
+  class State;
+
+  class StateMachineCommand
+  {
+  public:
+    enum class Type
+    {
+      Nothing,
+      Back,
+      Change
+    };
+
+    StateMachineCommand(Type type = Type::Nothing) : type_(type) {}
+    Type type() const { return type_; }
+
+  protected:
+    Type type_;
+  };
+
+  class StateMachineCommandChange : public StateMachineCommand
+  {
+  public:
+    StateMachineCommandChange() : StateMachineCommand(Type::Change), to_(nullptr) {}
+    void to(State *to) { to_ = to; }
+    State *state() const { return to_; }
+
+  private:
+    State *to_;
+  };
+
+  class State
+  {
+  public:
+    State(const char *name = "")
+        : name_(name)
+        , onEnter_([]() {})
+        , onRun_([&](State &state) -> const StateMachineCommand * { return nothing(); })
+        , onExit_([]() {})
+        , onDeadline_([]() { return get_absolute_time(); })
+    {
+    }
+
+    const char *name() const { return name_; }
+    const StateMachineCommand *run() { return onRun_(*this); }
+    void setOnRun(std::function<const StateMachineCommand *(State &state)> f) { onRun_ = f; }
+    void setOnEnter(std::function<void()> f) { onEnter_ = f; }
+    void onEnter() { onEnter_(); }
+    void setOnExit(std::function<void()> f) { onExit_ = f; }
+    void onExit() { onExit_(); }
+    void setOnDeadline(std::function<absolute_time_t()> f) { onDeadline_ = f; }
+    absolute_time_t deadline() { return onDeadline_(); }
+
+    const StateMachineCommand *nothing() const { return &nothing_; }
+
+    const StateMachineCommand *changeTo(State *next)
+    {
+      change_.to(next);
+      return &change_;
+    }
+
+  private:
+    const char *name_;
+    StateMachineCommand nothing_;
+    StateMachineCommandChange change_;
+    std::function<void()> onEnter_;
+    std::function<const StateMachineCommand *(State &state)> onRun_;
+    std::function<void()> onExit_;
+    std::function<absolute_time_t()> onDeadline_;
+  };
+
+  class StateMachine
+  {
+  public:
+    StateMachine(State *state) : state_(state) {}
+
+    void run()
+    {
+      const StateMachineCommand *cmd = state_->run();
+      if (cmd->type() == StateMachineCommand::Type::Change)
+      {
+        State *next = static_cast<const StateMachineCommandChange *>(cmd)->state();
+        if (next and next != state_)
+        {
+          state_->onExit();
+          next->onEnter();
+          state_ = next;
+        }
+      }
+    }
+
+    const State *state() const { return state_; }
+    absolute_time_t deadline() { return state_->deadline(); }
+
+  private:
+    State *state_;
+  };
+}
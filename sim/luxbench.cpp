@@ -0,0 +1,180 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "luxbench.h"
+#include "ambient.h"
+#include "cilo72/core/onchange.h"
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <vector>
+
+// Keeps the results alive.
+static volatile uint32_t keep;
+
+// Counts the double operations the old path does. On the RP2040 each one is
+// a call into the soft-float routines; the host has an FPU, so this is the
+// part of the difference the host timing does not show.
+static uint64_t floatOps = 0;
+
+struct CountedDouble
+{
+  double value;
+
+  CountedDouble(double v = 0.0) : value(v) {}
+  bool operator!=(const CountedDouble &rhs) const { floatOps++; return value != rhs.value; }
+  bool operator>(double rhs) const { floatOps++; return value > rhs; }
+  explicit operator uint32_t() const { floatOps++; return uint32_t(value); }
+};
+
+static constexpr uint32_t LEGACY_LENGTH            = 16;
+static constexpr uint32_t legacyMap[LEGACY_LENGTH] = {0, 2, 3, 4, 6, 8, 11, 16, 23, 32, 45, 64, 90, 128, 181, 255};
+
+// What AlarmClock did before Ambient: an OnChange on the driver value, a
+// clamp to 255 and a linear scan of the brightness map.
+template <typename D>
+class Legacy
+{
+public:
+  Legacy(const double *readings)
+      : readings_(readings)
+      , next_(0)
+      , lux_(0.0)
+      , index_(0)
+      , onChange_(lux_, [this](const D &last, const D &now)
+        {
+          uint32_t v;
+          if (now > 255.0)
+          {
+            v = 255;
+          }
+          else
+          {
+            v = uint32_t(now);
+          }
+
+          for (index_ = 0; index_ < LEGACY_LENGTH; index_++)
+          {
+            if (v <= legacyMap[index_])
+            {
+              break;
+            }
+          }
+        },
+        [this]() { lux_ = readings_[next_++]; })
+  {
+  }
+
+  uint8_t sample()
+  {
+    onChange_.evaluate();
+    return index_;
+  }
+
+private:
+  const double *readings_;
+  uint32_t next_;
+  D lux_;
+  uint8_t index_;
+  cilo72::core::OnChange<D> onChange_;
+};
+
+// Light ramping up and down once over the run, with 5 % lamp flicker and a
+// sensor count of noise on top; readings come as the driver hands them out.
+static std::vector<double> readings(uint32_t samples)
+{
+  std::vector<double> result(samples);
+  uint32_t noise = 12345;
+  for (uint32_t i = 0; i < samples; i++)
+  {
+    noise     = noise * 1103515245 + 12345;
+    double light = 60.0 + 55.0 * sin(2.0 * M_PI * i / samples);
+    result[i]    = light * (1.0 + 0.05 * sin(i * 0.7)) + ((noise >> 16) % 3) / 1.2;
+  }
+  return result;
+}
+
+// Level changes that undo the previous one within `window` samples.
+struct Flaps
+{
+  uint32_t window;
+  uint32_t changes  = 0;
+  uint32_t flaps    = 0;
+  int32_t direction = 0;
+  uint32_t at       = 0;
+  uint8_t level     = 0;
+
+  void add(uint32_t i, uint8_t now)
+  {
+    if (now == level)
+    {
+      return;
+    }
+    int32_t d = now > level ? 1 : -1;
+    if (changes > 0 and d != direction and i - at < window)
+    {
+      flaps++;
+    }
+    changes++;
+    direction = d;
+    at        = i;
+    level     = now;
+  }
+};
+
+int luxBench(uint32_t samples)
+{
+  static constexpr uint32_t FLAP_WINDOW = 20;
+  std::vector<double> lux = readings(samples);
+
+  Legacy<double> legacy(lux.data());
+  Ambient ambient;
+  Flaps legacyFlaps{FLAP_WINDOW};
+  Flaps ambientFlaps{FLAP_WINDOW};
+  uint32_t sink = 0;
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < samples; i++)
+  {
+    uint8_t level = legacy.sample();
+    legacyFlaps.add(i, level);
+    sink += level;
+  }
+  double legacyNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / samples;
+
+  start = std::chrono::steady_clock::now();
+  uint8_t level = 0;
+  for (uint32_t i = 0; i < samples; i++)
+  {
+    ambient.sample(uint32_t(lux[i]));
+    level = i == 0 ? Ambient::level(ambient.lux()) : Ambient::level(ambient.lux(), level);
+    ambientFlaps.add(i, level);
+    sink += level;
+  }
+  double ambientNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / samples;
+  keep = sink;
+
+  Legacy<CountedDouble> counted(lux.data());
+  floatOps = 0;
+  for (uint32_t i = 0; i < samples; i++)
+  {
+    counted.sample();
+  }
+  double legacyOps = double(floatOps) / samples;
+
+  printf("samples             : %u\n", samples);
+  printf("                      %12s %12s\n", "double", "Ambient");
+  printf("ns per sample       : %12.2f %12.2f\n", legacyNs, ambientNs);
+  printf("soft-float calls    : %12.2f %12.2f\n", legacyOps, 1.0);
+  printf("level changes       : %12u %12u\n", legacyFlaps.changes, ambientFlaps.changes);
+  printf("  undone within %2u  : %12u %12u\n", FLAP_WINDOW, legacyFlaps.flaps, ambientFlaps.flaps);
+
+  if (ambientFlaps.flaps > 0)
+  {
+    printf("FAIL: the brightness level flaps\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,13 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Cost per light sample of Ambient against the double based path it
+// replaced, and how often either changes the brightness level on a noisy
+// light ramp.
+int luxBench(uint32_t samples);
@@ -0,0 +1,91 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "mailboxtest.h"
+#include "frame.h"
+#include "mailbox.h"
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+
+// Sized like a Frame, every word derived from the count so a copy that
+// mixes two writes shows up.
+struct Value
+{
+  static constexpr uint32_t WORDS = (sizeof(Frame) + 3) / 4;
+
+  uint32_t count;
+  uint32_t words[WORDS];
+
+  void fill(uint32_t n)
+  {
+    count = n;
+    for (uint32_t i = 0; i < WORDS; i++)
+    {
+      words[i] = n * 2654435761u + i;
+    }
+  }
+
+  bool whole() const
+  {
+    for (uint32_t i = 0; i < WORDS; i++)
+    {
+      if (words[i] != count * 2654435761u + i)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+int mailboxTest(uint32_t values)
+{
+  Mailbox<Value> mailbox;
+  std::atomic<bool> done(false);
+
+  std::thread core0([&]()
+  {
+    Value value;
+    for (uint32_t n = 1; n <= values; n++)
+    {
+      value.fill(n);
+      mailbox.publish(value);
+    }
+    done = true;
+  });
+
+  uint32_t taken  = 0;
+  uint32_t torn   = 0;
+  uint32_t older  = 0;
+  uint32_t last   = 0;
+  Value value;
+
+  while (true)
+  {
+    bool finished = done;
+    if (mailbox.take(value))
+    {
+      taken++;
+      torn += value.whole() ? 0 : 1;
+      older += value.count > last ? 0 : 1;
+      last = value.count;
+    }
+    else if (finished)
+    {
+      break;
+    }
+  }
+  core0.join();
+
+  int failures = torn + older + (last == values ? 0 : 1);
+  printf("mailbox: %u values published, %u taken, %u retried copies\n", values, taken, mailbox.retries());
+  printf("  %u torn, %u out of order, last %u\n", torn, older, last);
+  if (failures)
+  {
+    printf("FAIL: mailbox handed over inconsistent values\n");
+  }
+  return failures;
+}
@@ -0,0 +1,13 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Runs the two sides of a Mailbox as host threads, one publishing as fast
+// as it can, and checks that every value taken is whole and never older
+// than the one before. Returns the number of failures.
+int mailboxTest(uint32_t values);
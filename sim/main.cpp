@@ -0,0 +1,378 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "simulation.h"
+#include "statebench.h"
+#include "alarmtest.h"
+#include "mailboxtest.h"
+#include "luxbench.h"
+#include "dfplayertest.h"
+#include "timertest.h"
+#include "i2ctest.h"
+#include "glyphbench.h"
+#include "profiletest.h"
+#include "shelltest.h"
+#include "flashtest.h"
+#include "menutest.h"
+#include <chrono>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage()
+{
+  printf("usage: alarm_clock_sim [bench|states|alarms|mailbox|lux|dfplayer|timers|i2c|glyphs|menu|profile|shell|pty|flash] [--minutes N] [--loop-cost-us N] [--busy] [--single-core]\n"
+         "                      [--rtc-drift-ppm N] [--transition none|roll|dither] [--flash IMAGE]\n"
+         "The pty scenario keeps its settings in the flash IMAGE file over runs, the others erase it first.\n");
+}
+
+// The alarm blink steps every 50 ms; display flushes must not hold a step
+// up by more than the pixel update itself plus a loop pass.
+static constexpr uint64_t MAX_BLINK_LATENESS_US = 1000;
+
+// An RTC read waits for one display window at most: a page and its
+// overhead at 400 kHz.
+static constexpr uint32_t MAX_RTC_WAIT_US = 3500;
+
+// One simulated hour of typical use: switch the alarm on, let it ring,
+// stop it, browse the menu, change the volume and edit the alarm.
+static int bench(uint32_t minutes, uint32_t loopCostUs, bool tickless, bool dualCore, int32_t rtcDriftPpm,
+                 Renderer::Transition transition)
+{
+  using S = Simulation;
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+  sim::flash().reset();
+
+  Simulation s(loopCostUs, tickless, cilo72::ic::SD2405::Time(7, 0, 0), dualCore);
+  s.alarmClock().setTransition(transition);
+  s.rtc.simSetTime(cilo72::ic::SD2405::Time(6, 58, 30));
+  s.rtc.simSetDrift(rtcDriftPpm);
+  // Daylight swinging every 10 minutes under a lamp that ripples by a few lux.
+  s.lux.simSetProfile([](uint64_t us)
+  {
+    return 60.0 + 50.0 * sin(2.0 * M_PI * us / (10.0 * S::MINUTE)) + 4.0 * sin(2.0 * M_PI * us / (1.3 * S::SECOND));
+  });
+
+  s.press(S::KEY_ALARM, 5 * S::SECOND);
+  s.press(S::KEY_ALARM, 150 * S::SECOND);
+
+  // - does nothing in Idle; pressed at odd times while the alarm blinks it
+  // probes how long input waits for the loop. Snoozing would silence the
+  // alarm at the first press, the alarms scenario covers it.
+  s.alarmClock().setMaxSnoozes(0);
+  uint64_t probe = 95 * S::SECOND;
+  for (uint32_t i = 0; i < 200; i++)
+  {
+    probe += 200000 + (i * 7919) % 97 * 1000 + (i * 104729) % 997;
+    s.press(S::KEY_MINUS, probe);
+  }
+
+  s.press(S::KEY_ENTER, 300 * S::SECOND);
+  s.press(S::KEY_PLUS, 301 * S::SECOND);
+  s.press(S::KEY_PLUS, 302 * S::SECOND);
+  s.press(S::KEY_ENTER, 303 * S::SECOND);
+  s.press(S::KEY_PLUS, 304 * S::SECOND);
+  s.press(S::KEY_PLUS, 305 * S::SECOND, 2000);
+  s.press(S::KEY_ENTER, 308 * S::SECOND);
+
+  s.press(S::KEY_ENTER, 600 * S::SECOND);
+  s.press(S::KEY_ENTER, 601 * S::SECOND);
+  s.press(S::KEY_PLUS, 602 * S::SECOND);
+  for (uint32_t i = 0; i < 4; i++)
+  {
+    s.press(S::KEY_ENTER, (603 + i) * S::SECOND);
+  }
+
+  // Hold + for 3 s on the minute units of the alarm, it is at :00.
+  s.press(S::KEY_ENTER, 900 * S::SECOND);
+  s.press(S::KEY_ENTER, 901 * S::SECOND);
+  for (uint32_t i = 0; i < 3; i++)
+  {
+    s.press(S::KEY_ENTER, (902 + i) * S::SECOND);
+  }
+  s.press(S::KEY_PLUS, 905 * S::SECOND, 3000);
+  s.press(S::KEY_ENTER, 909 * S::SECOND);
+
+  uint64_t end = uint64_t(minutes) * S::MINUTE;
+  auto wallStart = std::chrono::steady_clock::now();
+  s.runUntil(end);
+  double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  double simSeconds = double(sim::clock().now()) / S::SECOND;
+  double simMinutes = simSeconds / 60.0;
+
+  printf("simulated time      : %.1f min\n", simMinutes);
+  printf("loop iterations     : %llu\n", (unsigned long long)s.iterations());
+  printf("  per simulated s   : %.1f\n", s.iterations() / simSeconds);
+  printf("  per host s        : %.0f\n", s.iterations() / wall);
+  printf("wakeups per hour    : %.0f\n", s.scheduler().wakeups() / simMinutes * 60.0);
+  printf("key latency         : %.3f ms median, %.3f ms p99, %.3f ms max\n", s.keyLatency(0.5) / 1000.0,
+         s.keyLatency(0.99) / 1000.0, s.maxKeyLatency() / 1000.0);
+  printf("key to display      : %.3f ms mean, %.3f ms max over %u presses\n", s.keyToDisplayMean() / 1000.0,
+         s.keyToDisplayMax() / 1000.0, s.keyToDisplayCount());
+  uint32_t repeatSteps = s.alarmClock().alarms().alarm(0).minute;
+  printf("auto-repeat         : %u steps in a 3 s hold, %u key events dropped\n", repeatSteps, s.keys.dropped());
+  printf("alarm latency       : %.3f ms to the sound\n", s.alarmClock().alarmAudio().latencyUs() / 1000.0);
+
+  const HourMinute &hm = s.alarmClock().hourMinute();
+  int32_t error = int32_t(hm.secondOfDay()) - int32_t(s.rtc.simTime().hour() * 3600 + s.rtc.simTime().minute() * 60 + s.rtc.simTime().second());
+  printf("RTC reads per hour  : %.1f\n", hm.rtcReads() / simMinutes * 60.0);
+  printf("timer drift         : %d ppm estimated, %d ppm simulated\n", hm.driftPpm(), -rtcDriftPpm);
+  printf("clock error at end  : %d s\n", error);
+
+  const Ambient &ambient = s.alarmClock().ambient();
+  printf("light samples       : %.1f per hour, %u level changes, %u undone within %.0f s\n",
+         ambient.samples() / simMinutes * 60.0, s.levelChanges(), s.levelFlaps(), double(Simulation::FLAP_US) / S::SECOND);
+
+  const SignalGraph &graph = s.alarmClock().graph();
+  printf("signal graph        : %u commits\n", graph.commits());
+  for (uint32_t i = 0; i < graph.count(); i++)
+  {
+    printf("  %-12s : %8u evaluations\n", graph.node(i).name(), graph.node(i).evaluations());
+  }
+
+  printf("core1 busy          : %.3f s%s\n", double(s.core1Time()) / S::SECOND, dualCore ? "" : " (rendering on core0)");
+  printf("alarm blink         : %u updates, longest interval %.3f ms, steps up to %.3f ms late\n", s.blinkSteps(),
+         s.maxBlinkInterval() / 1000.0, s.maxBlinkLateness() / 1000.0);
+  printf("I2C DMA             : %u transfers, %u bus collisions, %.2f%% busy\n", s.i2cDma.transfers(),
+         sim::i2c().collisions(), 100.0 * s.i2cDma.busyUs() / sim::clock().now());
+  uint32_t rtcWaitUs = 0;
+  for (uint32_t i = 0; i < s.i2cDma.devices(); i++)
+  {
+    const I2cDma::Device &device = s.i2cDma.device(i);
+    printf("  0x%02X : %4u kHz %6u requests, waited up to %.3f ms\n", device.address, device.hz / 1000,
+           device.requests, device.maxWaitUs / 1000.0);
+    if (device.address == HourMinute::RTC_ADDRESS)
+    {
+      rtcWaitUs = device.maxWaitUs;
+    }
+  }
+
+  printf("I2C bytes per simulated minute:\n");
+  for (auto &device : sim::i2c().devices())
+  {
+    printf("  0x%02X %-14s : %10.1f bytes %8.1f transactions  %5.1f%% busy\n", device.first, device.second.name.c_str(),
+           device.second.bytes / simMinutes, device.second.transactions / simMinutes,
+           100.0 * device.second.busyUs / sim::clock().now());
+  }
+  printf("  total               : %10.1f bytes\n", sim::i2c().bytes() / simMinutes);
+  printf("UART bytes per simulated minute: %.1f\n", sim::uart().bytes() / simMinutes);
+  printf("DFPlayer            : %u commands, %u coalesced, %u timeouts, volume %d, module at %d\n", s.dfPlayer.sent(),
+         s.dfPlayer.coalesced(), s.dfPlayer.timeouts(), s.dfPlayer.volume(), s.dfPlayerModel.volume());
+
+  printf("display flushes (at most %u per s):\n", Compositor::FRAME_RATE);
+  for (const Oled *oled : {&s.oledLeft, &s.oledRight})
+  {
+    printf("  %-5s : %5u flushes, %7.1f bytes per flush (full frame %u)\n", oled == &s.oledLeft ? "left" : "right",
+           oled->flushes(), double(oled->flushBytes()) / oled->flushes(), Oled::PAGES * Oled::WIDTH + 14);
+  }
+
+  if (transition != Renderer::Transition::None)
+  {
+    printf("digit transitions   : %u steps at %u fps, %u dropped\n", s.renderer().transitionSteps(),
+           Renderer::TRANSITION_FPS, s.renderer().droppedSteps());
+  }
+
+  printf("time per state:\n");
+  for (auto &state : s.stateTime())
+  {
+    printf("  %-12s : %8.2f s %6.2f%%\n", state.first.c_str(), double(state.second) / S::SECOND,
+           100.0 * state.second / sim::clock().now());
+  }
+  printf("  %-12s : %8.2f s %6.2f%%\n", "(sleeping)", double(s.sleepTime()) / S::SECOND,
+         100.0 * s.sleepTime() / sim::clock().now());
+
+  int result = 0;
+  if (not s.panelsMatch())
+  {
+    printf("FAIL: panel RAM differs from the framebuffer\n");
+    result = 1;
+  }
+  if (s.maxBlinkLateness() > MAX_BLINK_LATENESS_US)
+  {
+    printf("FAIL: alarm blink step held up for %.3f ms\n", s.maxBlinkLateness() / 1000.0);
+    result = 1;
+  }
+  if (s.levelFlaps() > 0)
+  {
+    printf("FAIL: the brightness level flaps\n");
+    result = 1;
+  }
+  if (repeatSteps < 2 or s.keys.dropped() > 0)
+  {
+    printf("FAIL: auto-repeat gave %u steps, %u key events dropped\n", repeatSteps, s.keys.dropped());
+    result = 1;
+  }
+  if (s.dfPlayer.failed() > 0 or s.dfPlayer.volume() != s.dfPlayerModel.volume() or s.dfPlayerModel.playing())
+  {
+    printf("FAIL: the DFPlayer did not end up where the clock left it\n");
+    result = 1;
+  }
+  if (rtcWaitUs > MAX_RTC_WAIT_US)
+  {
+    printf("FAIL: an RTC read waited %.3f ms for the bus\n", rtcWaitUs / 1000.0);
+    result = 1;
+  }
+  if (sim::i2c().collisions() > 0)
+  {
+    printf("FAIL: blocking I2C transfers while the DMA owned the bus\n");
+    result = 1;
+  }
+  if (s.renderer().droppedSteps() > 0)
+  {
+    printf("FAIL: %u digit transition steps dropped\n", s.renderer().droppedSteps());
+    result = 1;
+  }
+
+  return result;
+}
+
+int main(int argc, char **argv)
+{
+  const char *scenario = "bench";
+  uint32_t minutes     = 60;
+  uint32_t loopCostUs  = 5;
+  bool tickless        = true;
+  int32_t rtcDriftPpm  = 40;
+  bool dualCore        = true;
+  auto transition      = Renderer::Transition::None;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--minutes") == 0 and i + 1 < argc)
+    {
+      minutes = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--loop-cost-us") == 0 and i + 1 < argc)
+    {
+      loopCostUs = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--rtc-drift-ppm") == 0 and i + 1 < argc)
+    {
+      rtcDriftPpm = atoi(argv[++i]);
+    }
+    else if (strcmp(argv[i], "--busy") == 0)
+    {
+      tickless = false;
+    }
+    else if (strcmp(argv[i], "--transition") == 0 and i + 1 < argc)
+    {
+      i++;
+      if (strcmp(argv[i], "roll") == 0)
+      {
+        transition = Renderer::Transition::Roll;
+      }
+      else if (strcmp(argv[i], "dither") == 0)
+      {
+        transition = Renderer::Transition::Dither;
+      }
+      else if (strcmp(argv[i], "none") != 0)
+      {
+        usage();
+        return 2;
+      }
+    }
+    else if (strcmp(argv[i], "--flash") == 0 and i + 1 < argc)
+    {
+      if (not sim::flash().open(argv[++i]))
+      {
+        printf("cannot map %s as a flash image\n", argv[i]);
+        return 2;
+      }
+    }
+    else if (strcmp(argv[i], "--single-core") == 0)
+    {
+      dualCore = false;
+    }
+    else if (argv[i][0] != '-')
+    {
+      scenario = argv[i];
+    }
+    else
+    {
+      usage();
+      return 2;
+    }
+  }
+
+  if (strcmp(scenario, "bench") == 0)
+  {
+    return bench(minutes, loopCostUs, tickless, dualCore, rtcDriftPpm, transition);
+  }
+
+  if (strcmp(scenario, "states") == 0)
+  {
+    return statesBench(20000000);
+  }
+
+  if (strcmp(scenario, "alarms") == 0)
+  {
+    return alarmsTest() ? 1 : 0;
+  }
+
+  if (strcmp(scenario, "lux") == 0)
+  {
+    return luxBench(1000000);
+  }
+
+  if (strcmp(scenario, "dfplayer") == 0)
+  {
+    return dfPlayerTest() ? 1 : 0;
+  }
+
+  if (strcmp(scenario, "timers") == 0)
+  {
+    return timerTest(100000) ? 1 : 0;
+  }
+
+  if (strcmp(scenario, "i2c") == 0)
+  {
+    return i2cTest(500) ? 1 : 0;
+  }
+
+  if (strcmp(scenario, "glyphs") == 0)
+  {
+    return glyphBench(50000);
+  }
+
+  if (strcmp(scenario, "menu") == 0)
+  {
+    return menuTest(20000) ? 1 : 0;
+  }
+
+  if (strcmp(scenario, "shell") == 0)
+  {
+    return shellTest() ? 1 : 0;
+  }
+
+  if (strcmp(scenario, "flash") == 0)
+  {
+    return flashTest(20000) ? 1 : 0;
+  }
+
+  if (strcmp(scenario, "pty") == 0)
+  {
+    return shellServe(minutes);
+  }
+
+#if ALARM_CLOCK_PROFILE
+  if (strcmp(scenario, "profile") == 0)
+  {
+    return profileTest(5) ? 1 : 0;
+  }
+#endif
+
+  if (strcmp(scenario, "mailbox") == 0)
+  {
+    return mailboxTest(2000000) ? 1 : 0;
+  }
+
+  usage();
+  return 2;
+}
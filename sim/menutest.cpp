@@ -0,0 +1,195 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "menutest.h"
+#include "menu.h"
+#include <random>
+#include <stdio.h>
+
+static const MenuItem ramp[] = {
+  {"Linear",    StateMachineCommand()},
+  {"Quadrat",   StateMachineCommand()},
+  {"Kubisch",   StateMachineCommand()},
+  MenuItem::up("Zurueck"),
+};
+
+static const MenuItem settings[] = {
+  {"Snooze",    StateMachineCommand()},
+  {"Anzahl",    StateMachineCommand()},
+  {"Sunrise",   StateMachineCommand()},
+  {"Prewarm",   StateMachineCommand()},
+  {"Rampe",     ramp},
+  {"Helligk.",  StateMachineCommand()},
+  MenuItem::up("Zurueck"),
+};
+
+static const MenuItem top[] = {
+  {"Alarm",     StateMachineCommand()},
+  {"Zeit",      StateMachineCommand()},
+  {"Volumen",   StateMachineCommand()},
+  {"Setup",     settings},
+  {"Licht",     StateMachineCommand()},
+  {"Exit",      StateMachineCommand()},
+};
+
+static constexpr uint32_t ROWS = 4;
+
+static uint32_t differences(const Layer &a, const Layer &b)
+{
+  uint32_t count = 0;
+  for (int32_t x = 0; x < int32_t(Oled::WIDTH); x++)
+  {
+    for (int32_t y = 0; y < int32_t(Layer::HEIGHT); y++)
+    {
+      if (a.pixel(x, y) != b.pixel(x, y))
+      {
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+// Like AlarmClock::menuRun: enter opens a submenu and Up goes back.
+static void press(Menu &menu, uint32_t key)
+{
+  switch (key)
+  {
+  case 0:
+    menu.up();
+    break;
+  case 1:
+    menu.down();
+    break;
+  default:
+    if (menu.selected().type() == MenuItem::Type::Submenu)
+    {
+      menu.enter();
+    }
+    else if (menu.selected().type() == MenuItem::Type::Up)
+    {
+      menu.leave();
+    }
+    break;
+  }
+}
+
+// Draws the view over what was drawn before and from scratch, and checks
+// both and where the view scrolled to.
+static int check(Layer &shown, Menu::View &last, const Menu &menu, const char *step)
+{
+  static Layer full;
+  const Menu::View &view = menu.view();
+  Menu::draw(shown, view, last);
+  last = view;
+  full.clear();
+  Menu::draw(full, view, Menu::View());
+
+  int failures = 0;
+  if (view.index < view.top or view.index >= view.top + ROWS or (view.top > 0 and view.top + ROWS > view.count))
+  {
+    printf("FAIL: %s: entry %u of %u with row 0 at %u\n", step, view.index, view.count, view.top);
+    failures++;
+  }
+  uint32_t off = differences(shown, full);
+  if (off > 0)
+  {
+    printf("FAIL: %s: %u pixels differ from a full redraw\n", step, off);
+    failures++;
+  }
+  return failures;
+}
+
+// Into the settings, down past the viewport to the ramp, into that and back
+// up out of it, then up past the top of the viewport and out again.
+static int path()
+{
+  static Layer shown;
+  Menu menu(top);
+  Menu::View last;
+  shown.clear();
+  int failures = check(shown, last, menu, "start");
+
+  static const struct
+  {
+    uint32_t key;
+    uint8_t count;   ///< Of the level afterwards.
+    uint8_t index;
+    uint8_t top;
+  } steps[] = {
+    {1, 6, 1, 0}, {1, 6, 2, 0}, {1, 6, 3, 0}, {2, 7, 0, 0},
+    {1, 7, 1, 0}, {1, 7, 2, 0}, {1, 7, 3, 0}, {1, 7, 4, 1}, {2, 4, 0, 0},
+    {1, 4, 1, 0}, {1, 4, 2, 0}, {1, 4, 3, 0}, {1, 4, 3, 0}, {2, 7, 4, 1},
+    {1, 7, 5, 2}, {1, 7, 6, 3}, {1, 7, 6, 3},
+    {0, 7, 5, 3}, {0, 7, 4, 3}, {0, 7, 3, 3}, {0, 7, 2, 2}, {0, 7, 1, 1}, {0, 7, 0, 0}, {0, 7, 0, 0},
+    {1, 7, 1, 0}, {1, 7, 2, 0}, {1, 7, 3, 0}, {1, 7, 4, 1}, {1, 7, 5, 2}, {1, 7, 6, 3}, {2, 6, 3, 0},
+  };
+
+  char name[16];
+  for (uint32_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++)
+  {
+    press(menu, steps[i].key);
+    snprintf(name, sizeof(name), "step %u", i);
+    failures += check(shown, last, menu, name);
+
+    const Menu::View &view = menu.view();
+    if (view.count != steps[i].count or view.index != steps[i].index or view.top != steps[i].top)
+    {
+      printf("FAIL: step %u: entry %u of %u with row 0 at %u, expected %u of %u at %u\n", i, view.index, view.count,
+             view.top, steps[i].index, steps[i].count, steps[i].top);
+      failures++;
+    }
+  }
+  printf("  path      : %u steps through two submenus, %d failed\n", uint32_t(sizeof(steps) / sizeof(steps[0])),
+         failures);
+  return failures;
+}
+
+// Random keys, leaning towards scrolling, with a reset now and then as when
+// the menu is opened again.
+static int walk(uint32_t steps)
+{
+  static Layer shown;
+  std::mt19937 random(7);
+  Menu menu(top);
+  Menu::View last;
+  shown.clear();
+  int failures = check(shown, last, menu, "start");
+
+  uint32_t scrolls = 0;
+  uint32_t depth   = 0;
+  char name[24];
+  for (uint32_t i = 0; i < steps and failures < 10; i++)
+  {
+    uint8_t top = menu.view().top;
+    if (random() % 100 == 0)
+    {
+      menu.reset();
+    }
+    else
+    {
+      press(menu, random() % 5 % 3);
+    }
+    scrolls += menu.view().top != top;
+    depth = menu.view().items == ramp ? 2 : depth;
+
+    snprintf(name, sizeof(name), "walk %u", i);
+    failures += check(shown, last, menu, name);
+  }
+  if (scrolls == 0 or depth < 2)
+  {
+    printf("FAIL: the walk scrolled %u times and went %u levels deep\n", scrolls, depth);
+    failures++;
+  }
+  printf("  walk      : %u steps, %u scrolls, %d failed\n", steps, scrolls, failures);
+  return failures;
+}
+
+int menuTest(uint32_t steps)
+{
+  int failures = path() + walk(steps);
+  printf(failures ? "FAIL: %d\n" : "OK\n", failures);
+  return failures;
+}
@@ -0,0 +1,16 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Takes a Menu through a nested tree with more entries per level than the
+// panel has rows, at random and along a fixed path: into a submenu and
+// back, scrolled past the viewport both ways. The selection has to stay in
+// view, a level has to keep its position while a submenu is open, and the
+// rows Menu::draw repaints have to add up to a full redraw after every
+// step. Returns the number of failures.
+int menuTest(uint32_t steps);
@@ -0,0 +1,289 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "profiletest.h"
+#include "profiler.h"
+#include "simbus.h"
+#include "simclock.h"
+#include "simulation.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using Record = std::vector<std::string>;
+
+static std::vector<Record> parseCsv(const std::string &text)
+{
+  std::vector<Record> records;
+  Record record(1);
+  for (char c : text)
+  {
+    if (c == '\n')
+    {
+      records.push_back(record);
+      record = Record(1);
+    }
+    else if (c == ',')
+    {
+      record.emplace_back();
+    }
+    else
+    {
+      record.back() += c;
+    }
+  }
+  return records;
+}
+
+// Like tools/profile.py: the fields of each record, text first.
+static bool decodeBinary(const std::string &data, std::vector<Record> &records)
+{
+  struct Layout
+  {
+    char tag;
+    const char *kind;
+    uint32_t texts;
+    uint32_t numbers;
+  };
+  static const Layout layouts[] = {
+    {'h', "hist", 1, 3 + Histogram::BUCKETS},
+    {'i', "i2c", 0, 6},
+    {'u', "uart", 1, 5},
+    {'d', "display", 1, 3},
+    {'t', "transition", 0, 2},
+    {'a', "alarm", 0, 1},
+    {'e', "end", 0, 0},
+  };
+
+  if (data.compare(0, 3, "ACP") != 0 or data.size() < 4 or data[3] != Profiler::VERSION)
+  {
+    return false;
+  }
+
+  size_t at = 4;
+  auto number = [&](uint64_t &value) {
+    value = 0;
+    for (uint32_t shift = 0; at < data.size(); shift += 7)
+    {
+      uint8_t byte = uint8_t(data[at++]);
+      value |= uint64_t(byte & 0x7F) << shift;
+      if (not(byte & 0x80))
+      {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  while (at < data.size())
+  {
+    char tag             = data[at++];
+    const Layout *layout = nullptr;
+    for (const Layout &l : layouts)
+    {
+      layout = l.tag == tag ? &l : layout;
+    }
+    if (layout == nullptr)
+    {
+      return false;
+    }
+
+    Record record{layout->kind};
+    uint64_t value;
+    for (uint32_t i = 0; i < layout->texts; i++)
+    {
+      if (not number(value) or at + value > data.size())
+      {
+        return false;
+      }
+      record.push_back(data.substr(at, value));
+      at += value;
+    }
+    for (uint32_t i = 0; i < layout->numbers; i++)
+    {
+      if (not number(value))
+      {
+        return false;
+      }
+      record.push_back(std::to_string(value));
+    }
+    records.push_back(record);
+  }
+  return true;
+}
+
+static std::string capture(const Profiler &profiler, bool binary)
+{
+  char *buffer = nullptr;
+  size_t size  = 0;
+  FILE *out    = open_memstream(&buffer, &size);
+  if (binary)
+  {
+    profiler.dumpBinary(out);
+  }
+  else
+  {
+    profiler.dumpCsv(out);
+  }
+  fclose(out);
+  std::string text(buffer, size);
+  free(buffer);
+  return text;
+}
+
+static bool endsWith(const std::string &s, const char *end)
+{
+  size_t length = strlen(end);
+  return s.size() >= length and s.compare(s.size() - length, length, end) == 0;
+}
+
+static uint64_t field(const Record &record, size_t index)
+{
+  return strtoull(record[index].c_str(), nullptr, 10);
+}
+
+// Counts, sum, maximum and the buckets have to agree with each other.
+static int checkHistogram(const Record &record)
+{
+  uint64_t count  = field(record, 2);
+  uint64_t sum    = field(record, 3);
+  uint64_t max    = field(record, 4);
+  uint64_t total  = 0;
+  int32_t highest = -1;
+  for (uint32_t i = 0; i < Histogram::BUCKETS; i++)
+  {
+    uint64_t n = field(record, 5 + i);
+    total += n;
+    highest = n ? int32_t(i) : highest;
+  }
+
+  bool maxFits = highest < 0 ? max == 0
+                             : max >= Histogram::lowerUs(highest) and
+                                   (highest == Histogram::BUCKETS - 1 or max < Histogram::lowerUs(highest + 1));
+  if (total != count or sum > count * max or not maxFits)
+  {
+    printf("FAIL: %s counts %llu in the buckets of %llu, sum %llu, max %llu\n", record[1].c_str(),
+           (unsigned long long)total, (unsigned long long)count, (unsigned long long)sum, (unsigned long long)max);
+    return 1;
+  }
+  return 0;
+}
+
+int profileTest(uint32_t minutes)
+{
+  using S = Simulation;
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+  sim::flash().reset();
+
+  Simulation s;
+  const Profiler &profiler = s.profiler();
+  s.press(S::KEY_ENTER, 10 * S::SECOND);
+  s.press(S::KEY_PLUS, 12 * S::SECOND);
+  s.press(S::KEY_ALARM, 2 * S::MINUTE);
+  s.runUntil(minutes * S::MINUTE);
+  s.panelsMatch();
+
+  int failures = 0;
+  std::vector<Record> csv = parseCsv(capture(profiler, false));
+  std::vector<Record> binary;
+  if (not decodeBinary(capture(profiler, true), binary))
+  {
+    printf("FAIL: the binary dump does not decode\n");
+    failures++;
+  }
+  if (binary != csv)
+  {
+    printf("FAIL: %zu binary records against %zu in CSV\n", binary.size(), csv.size());
+    failures++;
+  }
+  if (csv.empty() or csv.back() != Record{"end"})
+  {
+    printf("FAIL: the CSV dump does not end with its end record\n");
+    failures++;
+  }
+
+  uint64_t runs    = 0;
+  uint64_t enters  = 0;
+  uint32_t devices = 0;
+  for (const Record &record : csv)
+  {
+    const std::string &kind = record[0];
+    if (kind == "hist" and record.size() == 5 + Histogram::BUCKETS)
+    {
+      failures += checkHistogram(record);
+      const std::string &name = record[1];
+      if (name == "loop" and field(record, 2) != s.iterations())
+      {
+        printf("FAIL: %llu loop passes profiled of %llu\n", (unsigned long long)field(record, 2),
+               (unsigned long long)s.iterations());
+        failures++;
+      }
+      runs += endsWith(name, ".run") ? field(record, 2) : 0;
+      enters += endsWith(name, ".enter") ? field(record, 2) : 0;
+    }
+    else if (kind == "i2c" and record.size() == 7)
+    {
+      devices++;
+      uint8_t address           = uint8_t(field(record, 1));
+      const sim::Bus::Device &d = sim::i2c().devices().at(address);
+      // A claim of a display sends one command, so the transactions match;
+      // the bus model counts the address byte of each on top and the bytes
+      // of the claims the scheduler does not see.
+      if ((address == s.oledLeft.address() or address == s.oledRight.address()) and
+          (field(record, 3) != d.transactions or field(record, 4) + field(record, 3) > d.bytes))
+      {
+        printf("FAIL: 0x%02x sent %llu bytes in %llu transactions, the panel got %llu in %llu\n", address,
+               (unsigned long long)field(record, 4), (unsigned long long)field(record, 3),
+               (unsigned long long)d.bytes, (unsigned long long)d.transactions);
+        failures++;
+      }
+    }
+    else if (kind == "uart" and record.size() == 7 and field(record, 2) != s.dfPlayer.sent())
+    {
+      printf("FAIL: %llu commands to the player in the dump, %u sent\n", (unsigned long long)field(record, 2),
+             s.dfPlayer.sent());
+      failures++;
+    }
+    else if (kind == "transition" and record.size() == 3 and field(record, 1) != s.renderer().transitionSteps())
+    {
+      printf("FAIL: %llu transition steps in the dump, %u drawn\n", (unsigned long long)field(record, 1),
+             s.renderer().transitionSteps());
+      failures++;
+    }
+    else if (kind == "alarm" and record.size() == 2 and
+             field(record, 1) != s.alarmClock().alarmAudio().latencyUs())
+    {
+      printf("FAIL: alarm latency %llu us in the dump, %u us measured\n", (unsigned long long)field(record, 1),
+             s.alarmClock().alarmAudio().latencyUs());
+      failures++;
+    }
+  }
+
+  if (runs != s.iterations())
+  {
+    printf("FAIL: %llu state runs in %llu passes\n", (unsigned long long)runs, (unsigned long long)s.iterations());
+    failures++;
+  }
+  if (enters < 3)
+  {
+    printf("FAIL: %llu state changes, the presses make at least 3\n", (unsigned long long)enters);
+    failures++;
+  }
+  if (devices != s.i2cDma.devices())
+  {
+    printf("FAIL: %u of %u bus devices in the dump\n", devices, s.i2cDma.devices());
+    failures++;
+  }
+
+  printf("  %llu passes, %llu state changes, %zu records, %zu bytes of CSV\n", (unsigned long long)s.iterations(),
+         (unsigned long long)enters, csv.size(), capture(profiler, false).size());
+  printf(failures ? "FAIL: %d\n" : "OK\n", failures);
+  return failures;
+}
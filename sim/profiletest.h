@@ -0,0 +1,14 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Profiles a few minutes of the clock with a visit to the menu, takes both
+// dumps and checks that they decode to the same records, that the
+// histograms add up and that the bus counters match what reached the
+// simulated devices. Returns the number of failures.
+int profileTest(uint32_t minutes);
@@ -0,0 +1,248 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "shelltest.h"
+#include "simhw.h"
+#include "simulation.h"
+#include <chrono>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+
+using S = Simulation;
+
+// The USB serial port: the clock has the master end, the host the slave.
+struct Terminal
+{
+  int master = -1;
+  int slave  = -1;
+  FILE *out  = nullptr;   ///< What the shell answers to.
+
+  bool open()
+  {
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 or grantpt(master) != 0 or unlockpt(master) != 0)
+    {
+      return false;
+    }
+    slave = ::open(ptsname(master), O_RDWR | O_NOCTTY);
+
+    termios raw;
+    tcgetattr(slave, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(slave, TCSANOW, &raw);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    fcntl(slave, F_SETFL, fcntl(slave, F_GETFL) | O_NONBLOCK);
+    out = fdopen(dup(master), "w");
+    return slave >= 0 and out != nullptr;
+  }
+
+  ~Terminal()
+  {
+    if (out)
+    {
+      fclose(out);
+    }
+    if (slave >= 0)
+    {
+      close(slave);
+    }
+    if (master >= 0)
+    {
+      close(master);
+    }
+  }
+
+  // What the host sent reaches the clock's console.
+  void receive()
+  {
+    char buffer[256];
+    ssize_t n;
+    while ((n = read(master, buffer, sizeof(buffer))) > 0)
+    {
+      sim::console().type(buffer, n);
+    }
+  }
+};
+
+// Sends a command from the host side and runs the clock until the answer
+// ended in ok or an error, for a simulated second at most.
+static std::string exchange(Simulation &s, Terminal &terminal, const std::string &command)
+{
+  std::string line = command + "\n";
+  if (write(terminal.slave, line.data(), line.size()) < 0)
+  {
+    return "write failed";
+  }
+
+  std::string answer;
+  uint64_t end = sim::clock().now() + S::SECOND;
+  while (sim::clock().now() < end)
+  {
+    terminal.receive();
+    s.step(end);
+
+    char buffer[256];
+    ssize_t n;
+    while ((n = read(terminal.slave, buffer, sizeof(buffer))) > 0)
+    {
+      answer.append(buffer, n);
+    }
+    size_t last = answer.rfind('\n', answer.size() >= 2 ? answer.size() - 2 : 0);
+    std::string tail = answer.substr(last == std::string::npos ? 0 : last + 1);
+    if (not answer.empty() and answer.back() == '\n' and (tail == "ok\n" or tail.compare(0, 7, "error: ") == 0))
+    {
+      break;
+    }
+  }
+  return answer;
+}
+
+struct Step
+{
+  const char *command;
+  const char *expected;   ///< Part of the answer.
+};
+
+static const Step script[] = {
+  {"help",                                 "alarm <n> HH:MM"},
+  {"time 06:58:30 2",                      "time 06:58:30 weekday 2\nok\n"},
+  {"alarm 0 07:00 MTWTF-- enabled",        "alarm 0 07:00 MTWTF-- enabled\nok\n"},
+  {"alarm 1 08:15 ----FSS enabled,oneshot", "alarm 1 08:15 ----FSS enabled,oneshot\nok\n"},
+  {"alarm 2 09:00",                        "alarm 2 09:00 MTWTFSS enabled\nok\n"},
+  {"alarm 2 delete",                       "ok\n"},
+  {"alarm on",                             "alarm on\nok\n"},
+  {"alarm",                                "alarm 1 08:15 ----FSS enabled,oneshot\nalarm on\nok\n"},
+  {"volume 25",                            "volume 25\nok\n"},
+  {"brightness 3 40 7",                    "brightness 3 40 7\nok\n"},
+  {"set snooze 5",                         "snooze 5\n"},
+  {"set curve cubic",                      "curve cubic\n"},
+  {"set transition roll",                  "transition roll\nok\n"},
+  {"stats",                                "state Idle\n"},
+  {"stats",                                "transition_steps 0\ntransition_dropped 0\n"},
+  {"key enter",                            "ok\n"},
+  {"stats",                                "state Menu\n"},
+  {"key alarm",                            "ok\n"},
+#if ALARM_CLOCK_PROFILE
+  {"profile csv",                          "hist,loop,"},
+#endif
+  {"bogus",                                "error: unknown command"},
+  {"time 24:00",                           "error: not a time of day"},
+  {"alarm 3 07:00",                        "error: usage"},
+  {"alarm 0 07:00 MTWTF-- loud",           "error: flags"},
+  {"volume 31",                            "error: usage"},
+  {"set transition fade",                  "error: transition is"},
+  {"key menu",                             "error: usage"},
+  {"a b c d e f g h i",                    "error: too many arguments"},
+};
+
+static constexpr uint32_t STEPS = sizeof(script) / sizeof(script[0]);
+
+int shellTest()
+{
+  Terminal terminal;
+  if (not terminal.open())
+  {
+    printf("FAIL: no pseudo terminal\n");
+    return 1;
+  }
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+  sim::flash().reset();
+
+  Simulation s(5, true, cilo72::ic::SD2405::Time(0, 0, 0), true, terminal.out);
+  s.runUntil(S::SECOND);
+
+  int failures = 0;
+  for (const Step &step : script)
+  {
+    std::string answer = exchange(s, terminal, step.command);
+    if (answer.find(step.expected) == std::string::npos)
+    {
+      printf("FAIL: %s answered\n%s", step.command, answer.c_str());
+      failures++;
+    }
+  }
+
+  std::string longLine(Shell::LINE + 10, 'x');
+  if (exchange(s, terminal, longLine) != "error: line too long\n")
+  {
+    printf("FAIL: a line over %u characters is not refused\n", Shell::LINE);
+    failures++;
+  }
+
+  AlarmClock &clock = s.alarmClock();
+  if (s.dfPlayer.volume() != 25 or clock.snoozeMinutes() != 5 or clock.ambient().brightness(3).oled != 40 or
+      clock.alarmAudio().curve() != AlarmAudio::Curve::Cubic or clock.alarms().count() != 2 or
+      clock.transition() != Frame::Transition::Roll)
+  {
+    printf("FAIL: volume %d, snooze %u, contrast %u, %u alarms, transition %u\n", int(s.dfPlayer.volume()),
+           clock.snoozeMinutes(), clock.ambient().brightness(3).oled, clock.alarms().count(),
+           unsigned(clock.transition()));
+    failures++;
+  }
+
+  // Wednesday 06:58:30 plus the time the script took, the weekday alarm at
+  // 07:00 has to ring.
+  uint64_t ring = sim::clock().now() + 2 * S::MINUTE;
+  s.runUntil(ring);
+  if (not clock.alarmIsPlaying())
+  {
+    printf("FAIL: the alarm set over the shell did not ring, state %s\n", clock.stateName());
+    failures++;
+  }
+  if (s.renderer().transitionSteps() == 0)
+  {
+    printf("FAIL: the digits did not roll when the minute changed\n");
+    failures++;
+  }
+
+  char latency[32];
+  snprintf(latency, sizeof(latency), "alarm_latency_us %u\n", clock.alarmAudio().latencyUs());
+  std::string stats = exchange(s, terminal, "stats");
+  if (clock.alarmAudio().latencyUs() == 0 or stats.find(latency) == std::string::npos)
+  {
+    printf("FAIL: stats after the alarm rang %u us late\n%s", clock.alarmAudio().latencyUs(), stats.c_str());
+    failures++;
+  }
+
+  printf("  %u commands, %u errors\n", s.shell().commands(), s.shell().errors());
+  printf(failures ? "FAIL: %d\n" : "OK\n", failures);
+  return failures;
+}
+
+int shellServe(uint32_t minutes)
+{
+  Terminal terminal;
+  if (not terminal.open())
+  {
+    printf("FAIL: no pseudo terminal\n");
+    return 1;
+  }
+
+  sim::clock().reset();
+  sim::i2c().reset();
+  sim::uart().reset();
+
+  Simulation s(5, true, cilo72::ic::SD2405::Time(0, 0, 0), true, terminal.out);
+  printf("pty %s\n", ptsname(terminal.master));
+  fflush(stdout);
+
+  auto start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start < std::chrono::minutes(minutes))
+  {
+    terminal.receive();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    s.runUntil(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    usleep(1000);
+  }
+  return 0;
+}
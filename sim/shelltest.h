@@ -0,0 +1,19 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Drives the shell through a pseudo terminal the way a host script would:
+// each command goes in at the far end, the simulated clock runs until the
+// answer is complete, and the answer and the clock are checked; the alarm
+// set over the shell has to ring. Returns the number of failures.
+int shellTest();
+
+// Serves the shell of a simulated clock on a pseudo terminal, whose path it
+// prints, for scripts on the host. The simulated clock follows the wall
+// clock for the given minutes.
+int shellServe(uint32_t minutes);
@@ -0,0 +1,125 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "simbus.h"
+#include "simclock.h"
+
+namespace sim
+{
+  Bus::Bus(uint32_t bitsPerByte, uint32_t hz)
+      : bitsPerByte_(bitsPerByte), hz_(hz), busyUntil_(0), collisions_(0)
+  {
+  }
+
+  void Bus::name(uint32_t address, const char *name)
+  {
+    devices_[address].name = name;
+  }
+
+  void Bus::attach(uint32_t address, std::function<void(const uint8_t *data, size_t length)> onWrite,
+                   std::function<void(uint8_t *data, size_t length)> onRead)
+  {
+    devices_[address].onWrite = onWrite;
+    devices_[address].onRead  = onRead;
+  }
+
+  // Raw transfers for drivers that talk to the SDK directly, one address
+  // byte plus the payload.
+  void Bus::write(uint32_t address, const uint8_t *data, size_t length)
+  {
+    transfer(address, length + 1);
+    if (devices_[address].onWrite)
+    {
+      devices_[address].onWrite(data, length);
+    }
+  }
+
+  void Bus::read(uint32_t address, uint8_t *data, size_t length)
+  {
+    transfer(address, length + 1);
+    if (devices_[address].onRead)
+    {
+      devices_[address].onRead(data, length);
+    }
+  }
+
+  // A transaction that was started in the background and has now left the
+  // controller; the caller already accounted for its time on the wire.
+  void Bus::deliver(uint32_t address, const uint8_t *data, size_t length)
+  {
+    account(address, length + 1);
+    if (devices_[address].onWrite)
+    {
+      devices_[address].onWrite(data, length);
+    }
+  }
+
+  void Bus::transfer(uint32_t address, uint32_t bytes)
+  {
+    if (clock().now() < busyUntil_)
+    {
+      collisions_++;
+    }
+    clock().advance(account(address, bytes));
+  }
+
+  uint64_t Bus::duration(uint32_t bytes) const
+  {
+    return (uint64_t(bytes) * bitsPerByte_ * 1000000 + hz_ - 1) / hz_;
+  }
+
+  void Bus::occupy(uint64_t untilUs)
+  {
+    if (untilUs > busyUntil_)
+    {
+      busyUntil_ = untilUs;
+    }
+  }
+
+  uint64_t Bus::account(uint32_t address, uint32_t bytes)
+  {
+    Device &device = devices_[address];
+    uint64_t us    = duration(bytes);
+
+    device.bytes += bytes;
+    device.transactions++;
+    device.busyUs += us;
+    return us;
+  }
+
+  void Bus::reset()
+  {
+    busyUntil_  = 0;
+    collisions_ = 0;
+    for (auto &device : devices_)
+    {
+      device.second.bytes        = 0;
+      device.second.transactions = 0;
+      device.second.busyUs       = 0;
+    }
+  }
+
+  uint64_t Bus::bytes() const
+  {
+    uint64_t sum = 0;
+    for (auto &device : devices_)
+    {
+      sum += device.second.bytes;
+    }
+    return sum;
+  }
+
+  Bus &i2c()
+  {
+    static Bus bus(9, 400000);
+    return bus;
+  }
+
+  Bus &uart()
+  {
+    static Bus bus(10, 115200);
+    return bus;
+  }
+}
@@ -0,0 +1,69 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace sim
+{
+  // Byte and transaction accounting for a serial bus. Every blocking transfer
+  // also advances the simulated clock by its time on the wire; transfers a
+  // DMA engine runs in the background occupy the bus instead, and a blocking
+  // transfer that starts while the bus is occupied counts as a collision.
+  class Bus
+  {
+  public:
+    struct Device
+    {
+      std::string name;
+      uint64_t bytes        = 0;
+      uint64_t transactions = 0;
+      uint64_t busyUs       = 0;
+      std::function<void(const uint8_t *data, size_t length)> onWrite;
+      std::function<void(uint8_t *data, size_t length)> onRead;
+    };
+
+    Bus(uint32_t bitsPerByte, uint32_t hz);
+
+    void name(uint32_t address, const char *name);
+    void attach(uint32_t address, std::function<void(const uint8_t *data, size_t length)> onWrite,
+                std::function<void(uint8_t *data, size_t length)> onRead = nullptr);
+    void transfer(uint32_t address, uint32_t bytes);
+    void write(uint32_t address, const uint8_t *data, size_t length);
+    void read(uint32_t address, uint8_t *data, size_t length);
+    void deliver(uint32_t address, const uint8_t *data, size_t length);
+    // Books bytes that went over the wire in the background, without any
+    // addressing overhead.
+    void count(uint32_t address, uint32_t bytes) { account(address, bytes); }
+    uint64_t duration(uint32_t bytes) const;
+    // The clock for transfers from now on.
+    void setHz(uint32_t hz) { hz_ = hz; }
+    uint32_t hz() const { return hz_; }
+    void occupy(uint64_t untilUs);
+    uint64_t freeAt() const { return busyUntil_; }
+    uint32_t collisions() const { return collisions_; }
+    void reset();
+
+    const std::map<uint32_t, Device> &devices() const { return devices_; }
+    uint64_t bytes() const;
+
+  private:
+    uint32_t bitsPerByte_;
+    uint32_t hz_;
+    uint64_t busyUntil_;
+    uint32_t collisions_;
+    std::map<uint32_t, Device> devices_;
+
+    uint64_t account(uint32_t address, uint32_t bytes);
+  };
+
+  Bus &i2c();
+  Bus &uart();
+}
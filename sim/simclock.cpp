@@ -0,0 +1,95 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "simclock.h"
+
+namespace sim
+{
+  Clock &Clock::instance()
+  {
+    static Clock clock;
+    return clock;
+  }
+
+  Clock::Clock()
+      : now_(0), woken_(false), offload_(false), offloaded_(0)
+  {
+  }
+
+  void Clock::advance(uint64_t us)
+  {
+    if (offload_)
+    {
+      offloaded_ += us;
+      return;
+    }
+    advanceTo(now_ + us);
+  }
+
+  void Clock::advanceTo(uint64_t us)
+  {
+    while (not events_.empty() and events_.begin()->first <= us)
+    {
+      auto it = events_.begin();
+      if (it->first > now_)
+      {
+        now_ = it->first;
+      }
+      std::function<void()> f = it->second;
+      events_.erase(it);
+      f();
+    }
+
+    if (us > now_)
+    {
+      now_ = us;
+    }
+  }
+
+  // Like a core in WFE: runs events up to the deadline but returns as soon
+  // as one of them raised an interrupt. A wake() that came before the call
+  // is latched like the event register and ends the sleep right away.
+  // Returns true when the deadline passed.
+  bool Clock::sleepUntil(uint64_t us)
+  {
+    if (us == never and events_.empty() and not woken_)
+    {
+      return false;
+    }
+
+    while (not woken_ and nextEvent() <= us)
+    {
+      advanceTo(nextEvent());
+    }
+
+    if (woken_)
+    {
+      woken_ = false;
+      return false;
+    }
+
+    advanceTo(us);
+    return true;
+  }
+
+  void Clock::at(uint64_t us, std::function<void()> f)
+  {
+    events_.emplace(us, f);
+  }
+
+  uint64_t Clock::nextEvent() const
+  {
+    return events_.empty() ? never : events_.begin()->first;
+  }
+
+  void Clock::reset()
+  {
+    now_       = 0;
+    woken_     = false;
+    offload_   = false;
+    offloaded_ = 0;
+    events_.clear();
+  }
+}
@@ -0,0 +1,48 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+
+namespace sim
+{
+  // Simulated microsecond clock with a queue of timed events. Fakes advance
+  // it by the time their bus transfers take; scripts schedule key presses etc.
+  class Clock
+  {
+  public:
+    static constexpr uint64_t never = UINT64_MAX;
+
+    static Clock &instance();
+
+    uint64_t now() const { return now_; }
+    void advance(uint64_t us);
+    void advanceTo(uint64_t us);
+    bool sleepUntil(uint64_t us);
+    void wake() { woken_ = true; }
+    void at(uint64_t us, std::function<void()> f);
+    uint64_t nextEvent() const;
+    void reset();
+
+    // While offloading, advance() books the time to a second core instead
+    // of moving the clock: that core's work does not hold up the first.
+    // Waiting for events still runs on the shared clock.
+    void offload(bool on) { offload_ = on; }
+    uint64_t offloaded() const { return offloaded_; }
+
+  private:
+    Clock();
+    uint64_t now_;
+    bool woken_;
+    bool offload_;
+    uint64_t offloaded_;
+    std::multimap<uint64_t, std::function<void()>> events_;
+  };
+
+  inline Clock &clock() { return Clock::instance(); }
+}
@@ -0,0 +1,102 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "simdfplayer.h"
+#include "simbus.h"
+#include "simclock.h"
+#include "simhw.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace sim
+{
+  DfPlayerModel::DfPlayerModel(uint32_t uart, int32_t volume)
+      : uart_(uart), volume_(volume), playing_(false), loaded_(false), commands_(0), startedAt_(0), loudest_(0),
+        loudestBefore_(0)
+  {
+    sim::uart().name(uart, "DFPlayer Pro");
+    uartPort(uart).attach([this](const uint8_t *data, size_t length) { receive(data, length); });
+  }
+
+  void DfPlayerModel::receive(const uint8_t *data, size_t length)
+  {
+    for (size_t i = 0; i < length; i++)
+    {
+      if (data[i] == '\n')
+      {
+        if (not line_.empty() and line_.back() == '\r')
+        {
+          line_.pop_back();
+        }
+        command(line_);
+        line_.clear();
+      }
+      else
+      {
+        line_ += char(data[i]);
+      }
+    }
+  }
+
+  void DfPlayerModel::command(const std::string &command)
+  {
+    std::string answer = "OK\r\n";
+    commands_++;
+
+    if (command == "AT+VOL=?")
+    {
+      char s[32];
+      snprintf(s, sizeof(s), "VOL = [%d]\r\n", volume_);
+      answer = s;
+    }
+    else if (command.compare(0, 7, "AT+VOL=") != 0 and command != "AT+PLAY=NEXT" and command != "AT+PLAY=PP" and
+             command.compare(0, 12, "AT+PLAYMODE=") != 0)
+    {
+      answer = "error\r\n";
+    }
+
+    uint32_t uart = uart_;
+    clock().at(clock().now() + ANSWER_US, [this, uart, answer, command]()
+    {
+      act(command);
+      uartPort(uart).send(answer.c_str());
+    });
+  }
+
+  void DfPlayerModel::act(const std::string &command)
+  {
+    if (command.compare(0, 7, "AT+VOL=") == 0 and command != "AT+VOL=?")
+    {
+      volume_ = atoi(command.c_str() + 7);
+      if (playing_)
+      {
+        volumes_.push_back({clock().now(), volume_});
+        loudest_ = volume_ > loudest_ ? volume_ : loudest_;
+      }
+    }
+    else if (command == "AT+PLAY=NEXT")
+    {
+      loaded_ = true;
+      play(true);
+    }
+    else if (command == "AT+PLAY=PP" and loaded_)
+    {
+      play(not playing_);
+    }
+  }
+
+  void DfPlayerModel::play(bool playing)
+  {
+    if (playing and not playing_)
+    {
+      loudestBefore_ = loudest_;
+      startedAt_     = clock().now();
+      loudest_       = volume_;
+      volumes_.clear();
+      volumes_.push_back({startedAt_, volume_});
+    }
+    playing_ = playing;
+  }
+}
@@ -0,0 +1,54 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sim
+{
+  // DFPlayer Pro on a UART: takes AT commands and answers each after the
+  // time the module needs to act on it, which is also when it acts. PP
+  // toggles between playing and paused once a track is loaded.
+  class DfPlayerModel
+  {
+  public:
+    static constexpr uint64_t ANSWER_US = 20000;
+
+    DfPlayerModel(uint32_t uart, int32_t volume = 15);
+
+    int32_t volume() const { return volume_; }
+    bool playing() const { return playing_; }
+    uint32_t commands() const { return commands_; }
+
+    // When playback last started and the highest volume of the playback
+    // before, e.g. a track that was loaded silently.
+    uint64_t startedAt() const { return startedAt_; }
+    int32_t loudestBefore() const { return loudestBefore_; }
+
+    // The volume whenever it changed during playback, with the time.
+    const std::vector<std::pair<uint64_t, int32_t>> &volumes() const { return volumes_; }
+
+  private:
+    uint32_t uart_;
+    int32_t volume_;
+    bool playing_;
+    bool loaded_;
+    uint32_t commands_;
+    uint64_t startedAt_;
+    int32_t loudest_;
+    int32_t loudestBefore_;
+    std::vector<std::pair<uint64_t, int32_t>> volumes_;
+    std::string line_;
+
+    void receive(const uint8_t *data, size_t length);
+    void command(const std::string &command);
+    void act(const std::string &command);
+    void play(bool playing);
+  };
+}
@@ -0,0 +1,467 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "simhw.h"
+#include "simclock.h"
+#include "simbus.h"
+#include "hardware/irq.h"
+#include "hardware/i2c.h"
+#include <algorithm>
+#include <string.h>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sim
+{
+  Irq &Irq::instance()
+  {
+    static Irq irq;
+    return irq;
+  }
+
+  void Irq::setHandler(uint32_t irq, void (*handler)())
+  {
+    handlers_[irq] = handler;
+  }
+
+  void Irq::enable(uint32_t irq, bool enabled)
+  {
+    enabled_[irq] = enabled;
+  }
+
+  void Irq::raise(uint32_t irq)
+  {
+    auto handler = handlers_.find(irq);
+    if (enabled_[irq] and handler != handlers_.end() and handler->second)
+    {
+      handler->second();
+    }
+    clock().wake();
+  }
+
+  // The I2C controller draining IC_DATA_CMD words: every STOP closes a
+  // transaction that reaches the device when its last bit went out, which
+  // raises STOP_DET. The DMA channel is done just before the final one.
+  static void i2cSink(i2c_inst_t *i2c, uint32_t line, uint32_t channel, const void *source, uint32_t count)
+  {
+    i2c_hw_t *hw           = i2c_get_hw(i2c);
+    const uint16_t *words  = static_cast<const uint16_t *>(source);
+    uint32_t address       = hw->tar;
+    uint64_t at            = std::max(clock().now(), sim::i2c().freeAt());
+
+    std::vector<uint8_t> bytes;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      bytes.push_back(uint8_t(words[i]));
+      if (words[i] & I2C_IC_DATA_CMD_STOP_BITS or i + 1 == count)
+      {
+        at += sim::i2c().duration(bytes.size() + 1);
+        bool last = i + 1 == count;
+        clock().at(at, [hw, line, channel, address, bytes, last]()
+        {
+          if (last)
+          {
+            hw->txflr  = 0;
+            hw->status = 0;
+            dma().finish(channel);
+          }
+          sim::i2c().deliver(address, bytes.data(), bytes.size());
+          if (hw->intr_mask & I2C_IC_INTR_MASK_M_STOP_DET_BITS)
+          {
+            irq().raise(line);
+          }
+        });
+        bytes.clear();
+      }
+    }
+
+    hw->txflr  = count < 16 ? count : 16;
+    hw->status = I2C_IC_STATUS_ACTIVITY_BITS;
+    sim::i2c().occupy(at);
+  }
+
+  Dma &Dma::instance()
+  {
+    static Dma dma;
+    return dma;
+  }
+
+  Dma::Dma()
+  {
+    sink(&i2c_get_hw(i2c0)->data_cmd, [](uint32_t channel, const void *source, uint32_t count, uint32_t size)
+         { i2cSink(i2c0, I2C0_IRQ, channel, source, count); });
+    sink(&i2c_get_hw(i2c1)->data_cmd, [](uint32_t channel, const void *source, uint32_t count, uint32_t size)
+         { i2cSink(i2c1, I2C1_IRQ, channel, source, count); });
+  }
+
+  int32_t Dma::claim()
+  {
+    for (uint32_t i = 0; i < CHANNELS; i++)
+    {
+      if (not channels_[i].claimed)
+      {
+        channels_[i].claimed = true;
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  void Dma::sink(volatile void *address, Sink sink)
+  {
+    sinks_[address] = sink;
+  }
+
+  void Dma::start(uint32_t channel, const void *source, uint32_t count)
+  {
+    Channel &c = channels_[channel];
+    c.busy     = true;
+
+    auto sink = sinks_.find(c.write);
+    if (sink != sinks_.end())
+    {
+      sink->second(channel, source, count, c.size);
+    }
+    else
+    {
+      finish(channel);
+    }
+  }
+
+  void Dma::finish(uint32_t channel)
+  {
+    Channel &c = channels_[channel];
+    c.busy     = false;
+    if (c.irq0)
+    {
+      c.irq0Status = true;
+      irq().raise(DMA_IRQ_0);
+    }
+  }
+
+  Timer &Timer::instance()
+  {
+    static Timer timer;
+    return timer;
+  }
+
+  Timer::Timer()
+      : nextId_(1)
+  {
+  }
+
+  int32_t Timer::add(uint64_t at, Callback callback, void *data)
+  {
+    int32_t id = nextId_++;
+    schedule(id, std::max(at, clock().now()), callback, data);
+    return id;
+  }
+
+  bool Timer::cancel(int32_t id)
+  {
+    return pending_.erase(id) > 0;
+  }
+
+  // >0 reschedules from when the callback returns, <0 from when the alarm
+  // was due.
+  void Timer::schedule(int32_t id, uint64_t at, Callback callback, void *data)
+  {
+    pending_[id] = at;
+    clock().at(at, [this, id, at, callback, data]()
+    {
+      auto it = pending_.find(id);
+      if (it == pending_.end() or it->second != at)
+      {
+        return;
+      }
+
+      pending_.erase(it);
+      int64_t again = callback(id, data);
+      if (again > 0)
+      {
+        schedule(id, clock().now() + again, callback, data);
+      }
+      else if (again < 0)
+      {
+        schedule(id, at - again, callback, data);
+      }
+      clock().wake();
+    });
+  }
+
+  UartPort &UartPort::instance(uint32_t index)
+  {
+    static UartPort ports[2] = {UartPort(0), UartPort(1)};
+    return ports[index];
+  }
+
+  UartPort::UartPort(uint32_t index)
+      : index_(index), rxIrq_(false), txFree_(0), rxFree_(0), overruns_(0)
+  {
+  }
+
+  void UartPort::reset()
+  {
+    rx_.clear();
+    rxIrq_    = false;
+    txFree_   = 0;
+    rxFree_   = 0;
+    overruns_ = 0;
+  }
+
+  void UartPort::write(const uint8_t *data, size_t length)
+  {
+    txFree_ = std::max(clock().now(), txFree_) + sim::uart().duration(length);
+    std::vector<uint8_t> bytes(data, data + length);
+    clock().at(txFree_, [this, bytes]()
+    {
+      sim::uart().count(index_, bytes.size());
+      if (device_)
+      {
+        device_(bytes.data(), bytes.size());
+      }
+    });
+  }
+
+  uint8_t UartPort::getc()
+  {
+    uint8_t c = rx_.front();
+    rx_.pop_front();
+    return c;
+  }
+
+  void UartPort::send(const uint8_t *data, size_t length)
+  {
+    rxFree_ = std::max(clock().now(), rxFree_) + sim::uart().duration(length);
+    std::vector<uint8_t> bytes(data, data + length);
+    clock().at(rxFree_, [this, bytes]()
+    {
+      sim::uart().count(index_, bytes.size());
+      for (uint8_t c : bytes)
+      {
+        if (rx_.size() == FIFO)
+        {
+          overruns_++;
+          continue;
+        }
+        rx_.push_back(c);
+      }
+      if (rxIrq_)
+      {
+        irq().raise(index_ ? UART1_IRQ : UART0_IRQ);
+      }
+    });
+  }
+
+  void UartPort::send(const char *s)
+  {
+    send(reinterpret_cast<const uint8_t *>(s), strlen(s));
+  }
+
+  Console &Console::instance()
+  {
+    static Console console;
+    return console;
+  }
+
+  void Console::setCallback(void (*callback)(void *), void *param)
+  {
+    callback_ = callback;
+    param_    = param;
+  }
+
+  void Console::type(const char *s, size_t length)
+  {
+    input_.insert(input_.end(), s, s + length);
+    if (callback_)
+    {
+      callback_(param_);
+    }
+    clock().wake();
+  }
+
+  void Console::type(const char *s)
+  {
+    type(s, strlen(s));
+  }
+
+  int Console::getc()
+  {
+    if (input_.empty())
+    {
+      return -1;
+    }
+    char c = input_.front();
+    input_.pop_front();
+    return c;
+  }
+
+  Flash &Flash::instance()
+  {
+    static Flash flash;
+    return flash;
+  }
+
+  Flash::Flash()
+      : image_(nullptr)
+      , memory_(SIZE, 0xFF)
+      , budget_(never)
+      , random_(1)
+      , cuts_(0)
+      , erases_(SIZE / SECTOR, 0)
+      , programs_(0)
+      , misuses_(0)
+  {
+    image_ = memory_.data();
+  }
+
+  Flash::~Flash()
+  {
+    unmap();
+  }
+
+  void Flash::unmap()
+  {
+    if (not path_.empty())
+    {
+      munmap(image_, SIZE);
+      path_.clear();
+    }
+    image_ = memory_.data();
+  }
+
+  bool Flash::open(const char *path)
+  {
+    unmap();
+    int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+      return false;
+    }
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+    if (ok and st.st_size == 0)
+    {
+      std::vector<uint8_t> erased(SIZE, 0xFF);
+      ok = write(fd, erased.data(), SIZE) == ssize_t(SIZE);
+    }
+    else if (ok)
+    {
+      ok = st.st_size == SIZE;
+    }
+
+    void *image = ok ? mmap(nullptr, SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (image == MAP_FAILED)
+    {
+      return false;
+    }
+    image_ = static_cast<uint8_t *>(image);
+    path_  = path;
+    return true;
+  }
+
+  void Flash::close()
+  {
+    unmap();
+    std::fill(memory_.begin(), memory_.end(), 0xFF);
+  }
+
+  void Flash::reset()
+  {
+    memset(image_, 0xFF, SIZE);
+    budget_   = never;
+    cuts_     = 0;
+    programs_ = 0;
+    misuses_  = 0;
+    std::fill(erases_.begin(), erases_.end(), 0);
+  }
+
+  void Flash::cutAfter(uint64_t bytes, uint32_t seed)
+  {
+    budget_ = bytes;
+    random_ = seed ? seed : 1;
+  }
+
+  size_t Flash::spend(size_t count)
+  {
+    if (budget_ == never)
+    {
+      return count;
+    }
+    size_t done = std::min<uint64_t>(budget_, count);
+    budget_    -= done;
+    return done;
+  }
+
+  // xorshift32, for the bits a cut leaves behind.
+  uint8_t Flash::noise()
+  {
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return uint8_t(random_);
+  }
+
+  // An erase cut short leaves every byte of the sector part way to 0xFF.
+  void Flash::erase(uint32_t offset, size_t count)
+  {
+    if (offset % SECTOR or count % SECTOR or offset + count > SIZE)
+    {
+      misuses_++;
+      return;
+    }
+
+    for (uint32_t sector = offset; sector < offset + count; sector += SECTOR)
+    {
+      clock().advance(ERASE_US);
+      if (spend(SECTOR) < SECTOR)
+      {
+        for (uint32_t i = 0; i < SECTOR; i++)
+        {
+          image_[sector + i] |= noise();
+        }
+        budget_ = never;
+        cuts_++;
+        throw PowerCut();
+      }
+      memset(image_ + sector, 0xFF, SECTOR);
+      erases_[sector / SECTOR]++;
+    }
+  }
+
+  void Flash::program(uint32_t offset, const uint8_t *data, size_t count)
+  {
+    if (offset % PAGE or count % PAGE or offset + count > SIZE)
+    {
+      misuses_++;
+      return;
+    }
+
+    clock().advance(PROGRAM_US * (count / PAGE));
+    size_t done = spend(count);
+    for (size_t i = 0; i < done; i++)
+    {
+      if (data[i] & ~image_[offset + i])
+      {
+        misuses_++;
+      }
+      image_[offset + i] &= data[i];
+    }
+    programs_ += count / PAGE;
+
+    if (done < count)
+    {
+      image_[offset + done] &= data[done] | noise();
+      budget_ = never;
+      cuts_++;
+      throw PowerCut();
+    }
+  }
+}
@@ -0,0 +1,214 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+namespace sim
+{
+  // Interrupt controller: handlers run when a model raises their line and
+  // wake a core waiting in WFE.
+  class Irq
+  {
+  public:
+    static Irq &instance();
+
+    void setHandler(uint32_t irq, void (*handler)());
+    void enable(uint32_t irq, bool enabled);
+    void raise(uint32_t irq);
+
+  private:
+    std::map<uint32_t, void (*)()> handlers_;
+    std::map<uint32_t, bool> enabled_;
+  };
+
+  // DMA channels. A transfer is handed to the sink registered for its write
+  // address, which calls finish() once the peripheral has taken the data.
+  class Dma
+  {
+  public:
+    using Sink = std::function<void(uint32_t channel, const void *source, uint32_t count, uint32_t size)>;
+
+    static constexpr uint32_t CHANNELS = 12;
+
+    struct Channel
+    {
+      bool claimed       = false;
+      bool busy          = false;
+      bool irq0          = false;
+      bool irq0Status    = false;
+      volatile void *write = nullptr;
+      uint32_t size      = 4;
+    };
+
+    static Dma &instance();
+
+    Channel &channel(uint32_t channel) { return channels_[channel]; }
+    int32_t claim();
+    void sink(volatile void *address, Sink sink);
+    void start(uint32_t channel, const void *source, uint32_t count);
+    void finish(uint32_t channel);
+
+  private:
+    Dma();
+    Channel channels_[CHANNELS];
+    std::map<volatile void *, Sink> sinks_;
+  };
+
+  // Timer alarms of the default alarm pool. A callback runs from the timer
+  // interrupt at its time; what it returns reschedules it as in the SDK.
+  class Timer
+  {
+  public:
+    using Callback = int64_t (*)(int32_t id, void *data);
+
+    static Timer &instance();
+
+    int32_t add(uint64_t at, Callback callback, void *data);
+    bool cancel(int32_t id);
+
+  private:
+    Timer();
+    int32_t nextId_;
+    std::map<int32_t, uint64_t> pending_; ///< Alarm ids and their times.
+
+    void schedule(int32_t id, uint64_t at, Callback callback, void *data);
+  };
+
+  // A UART and the device on its other end. Bytes the CPU writes reach the
+  // device once they went out on the wire; what the device sends lands in
+  // the RX FIFO when its last byte is in and raises the UART interrupt.
+  class UartPort
+  {
+  public:
+    static constexpr uint32_t FIFO = 32;
+
+    static UartPort &instance(uint32_t index);
+
+    void reset();
+    void attach(std::function<void(const uint8_t *data, size_t length)> device) { device_ = device; }
+    void enableRxIrq(bool enabled) { rxIrq_ = enabled; }
+
+    // CPU side.
+    void write(const uint8_t *data, size_t length);
+    bool readable() const { return not rx_.empty(); }
+    uint8_t getc();
+
+    // Device side, sent now.
+    void send(const uint8_t *data, size_t length);
+    void send(const char *s);
+
+    uint32_t overruns() const { return overruns_; }
+
+  private:
+    UartPort(uint32_t index);
+    uint32_t index_;
+    bool rxIrq_;
+    std::deque<uint8_t> rx_;
+    uint64_t txFree_;        ///< The TX line is busy until then.
+    uint64_t rxFree_;
+    uint32_t overruns_;
+    std::function<void(const uint8_t *data, size_t length)> device_;
+  };
+
+  // What the host types into the USB serial port. Input calls the stdio
+  // callback and wakes a core waiting in WFE like the USB interrupt does.
+  class Console
+  {
+  public:
+    static Console &instance();
+
+    void setCallback(void (*callback)(void *), void *param);
+    void type(const char *s, size_t length);
+    void type(const char *s);
+    // The next character, -1 if there is none.
+    int getc();
+
+  private:
+    std::deque<char> input_;
+    void (*callback_)(void *) = nullptr;
+    void *param_              = nullptr;
+  };
+
+  // The QSPI flash behind XIP_BASE. Programming only clears bits and an
+  // erase sets a sector back to 0xFF, each taking as long as on a W25Q16;
+  // the sim does not hold the interrupts or the other core meanwhile. The
+  // image is in memory or, once open()ed, a file, which keeps what was
+  // written for a later run.
+  //
+  // cutAfter() cuts the power once that many more bytes were programmed or
+  // erased: the operation stops part way, the byte it stopped at keeps some
+  // of its old bits, and PowerCut is thrown.
+  class Flash
+  {
+  public:
+    static constexpr uint32_t SIZE       = 2 * 1024 * 1024;
+    static constexpr uint32_t SECTOR     = 4096;
+    static constexpr uint32_t PAGE       = 256;
+    static constexpr uint64_t ERASE_US   = 45000;
+    static constexpr uint64_t PROGRAM_US = 400;
+    static constexpr uint64_t never      = UINT64_MAX;
+
+    struct PowerCut
+    {
+    };
+
+    static Flash &instance();
+
+    uint8_t *image() { return image_; }
+
+    // Maps the image file at path, created erased if there is none. False
+    // when it cannot be opened or has the wrong size.
+    bool open(const char *path);
+    // Back to an image in memory, erased.
+    void close();
+    // Erases the whole image and clears the counters.
+    void reset();
+
+    void erase(uint32_t offset, size_t count);
+    void program(uint32_t offset, const uint8_t *data, size_t count);
+
+    void cutAfter(uint64_t bytes, uint32_t seed = 1);
+    uint64_t cuts() const { return cuts_; }
+
+    uint32_t erases(uint32_t sector) const { return erases_[sector]; }
+    uint32_t programs() const { return programs_; }
+    // Operations the chip would have done differently: misaligned, or a
+    // program that needs a 0 bit back at 1.
+    uint32_t misuses() const { return misuses_; }
+
+  private:
+    Flash();
+    ~Flash();
+    uint8_t *image_;
+    std::vector<uint8_t> memory_;
+    std::string path_;
+    uint64_t budget_;              ///< Bytes until the power cut.
+    uint32_t random_;
+    uint64_t cuts_;
+    std::vector<uint32_t> erases_;
+    uint32_t programs_;
+    uint32_t misuses_;
+
+    // Takes count bytes off the budget, returns how many go through.
+    size_t spend(size_t count);
+    uint8_t noise();
+    void unmap();
+  };
+
+  inline Irq &irq() { return Irq::instance(); }
+  inline Dma &dma() { return Dma::instance(); }
+  inline Timer &timer() { return Timer::instance(); }
+  inline UartPort &uartPort(uint32_t index) { return UartPort::instance(index); }
+  inline Console &console() { return Console::instance(); }
+  inline Flash &flash() { return Flash::instance(); }
+}
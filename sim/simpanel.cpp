@@ -0,0 +1,133 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "simpanel.h"
+#include "simbus.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace sim
+{
+  Panel::Panel(uint8_t address, const char *name)
+      : contrast_(0x7F), on_(false)
+      , column_(0), firstColumn_(0), lastColumn_(WIDTH - 1)
+      , page_(0), firstPage_(0), lastPage_(PAGES - 1)
+      , pendingLength_(0)
+      , written_(false)
+  {
+    memset(ram_, 0xA5, sizeof(ram_));
+    i2c().name(address, name);
+    i2c().attach(address, [this](const uint8_t *data, size_t length) { receive(data, length); });
+  }
+
+  void Panel::print() const
+  {
+    for (uint32_t row = 0; row < PAGES * 8; row += 2)
+    {
+      for (uint32_t column = 0; column < WIDTH; column++)
+      {
+        bool upper = ram_[row / 8][column] & (1 << (row % 8));
+        bool lower = ram_[row / 8][column] & (1 << (row % 8 + 1));
+        putchar(upper and lower ? '8' : upper ? '\'' : lower ? '.' : ' ');
+      }
+      putchar('\n');
+    }
+  }
+
+  void Panel::receive(const uint8_t *data, size_t length)
+  {
+    written_ = false;
+    size_t i = 0;
+    while (i < length)
+    {
+      uint8_t control = data[i++];
+      bool last       = (control & 0x80) == 0;
+      bool isData     = (control & 0x40) != 0;
+
+      if (last)
+      {
+        while (i < length)
+        {
+          isData ? this->data(data[i++]) : command(data[i++]);
+        }
+      }
+      else if (i < length)
+      {
+        isData ? this->data(data[i++]) : command(data[i++]);
+      }
+    }
+
+    if (written_ and onData_)
+    {
+      onData_();
+    }
+  }
+
+  // Commands with arguments are collected until complete.
+  void Panel::command(uint8_t byte)
+  {
+    pending_[pendingLength_++] = byte;
+
+    uint32_t needed = 1;
+    switch (pending_[0])
+    {
+    case 0x21:
+    case 0x22:
+      needed = 3;
+      break;
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+      needed = 2;
+      break;
+    }
+
+    if (pendingLength_ < needed)
+    {
+      return;
+    }
+
+    switch (pending_[0])
+    {
+    case 0x21:
+      firstColumn_ = pending_[1] & 0x7F;
+      lastColumn_  = pending_[2] & 0x7F;
+      column_      = firstColumn_;
+      break;
+    case 0x22:
+      firstPage_ = pending_[1] & 0x07;
+      lastPage_  = pending_[2] & 0x07;
+      page_      = firstPage_;
+      break;
+    case 0x81:
+      contrast_ = pending_[1];
+      break;
+    case 0xAE:
+      on_ = false;
+      break;
+    case 0xAF:
+      on_ = true;
+      break;
+    }
+
+    pendingLength_ = 0;
+  }
+
+  // Horizontal addressing: wrap to the next page at the end of the window.
+  void Panel::data(uint8_t byte)
+  {
+    ram_[page_][column_] = byte;
+    written_             = true;
+
+    if (column_ >= lastColumn_)
+    {
+      column_ = firstColumn_;
+      page_   = page_ >= lastPage_ ? firstPage_ : page_ + 1;
+    }
+    else
+    {
+      column_++;
+    }
+  }
+}
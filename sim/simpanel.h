@@ -0,0 +1,48 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <functional>
+
+namespace sim
+{
+  // SSD1306 controller model on the simulated I2C bus: decodes control
+  // bytes, commands and addressing windows into its own display RAM, so a
+  // run can check that the panel ends up showing the driver's framebuffer.
+  class Panel
+  {
+  public:
+    static constexpr uint32_t WIDTH = 128;
+    static constexpr uint32_t PAGES = 8;
+
+    Panel(uint8_t address, const char *name);
+
+    const uint8_t *page(uint32_t page) const { return ram_[page]; }
+    uint8_t contrast() const { return contrast_; }
+    bool on() const { return on_; }
+    void print() const;
+
+    // Called after each transaction that wrote display RAM.
+    void onData(std::function<void()> f) { onData_ = f; }
+
+  private:
+    uint8_t ram_[PAGES][WIDTH];
+    uint8_t contrast_;
+    bool on_;
+    uint8_t column_, firstColumn_, lastColumn_;
+    uint8_t page_, firstPage_, lastPage_;
+    uint8_t pending_[3];
+    uint32_t pendingLength_;
+    bool written_;
+    std::function<void()> onData_;
+
+    void receive(const uint8_t *data, size_t length);
+    void command(uint8_t byte);
+    void data(uint8_t byte);
+  };
+}
@@ -0,0 +1,260 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "simulation.h"
+#include <algorithm>
+#include <string.h>
+
+Simulation::Simulation(uint32_t loopCostUs, bool tickless, const cilo72::ic::SD2405::Time &alarm, bool dualCore,
+                       FILE *console)
+    : keys({PIN_KEY_1, PIN_KEY_2, PIN_KEY_3, PIN_KEY_4})
+    , i2cBus(2, 3)
+    , rtc(i2cBus, alarm)
+    , lux(i2cBus)
+    , pixels(9, 4)
+    , panelRight(0x3C, "SSD1306 right")
+    , panelLeft(0x3D, "SSD1306 left")
+    , i2cDma(i2c1)
+    , oledRight(i2cDma, 0x3C)
+    , oledLeft(i2cDma, 0x3D)
+    , dfPlayerModel(0)
+    , dfPlayer(uart0, 17, 16)
+    , alarmClock_(keys, rtc, lux, i2cDma, frames, dfPlayer)
+    , settings_(store_, alarmClock_, dfPlayer)
+    , renderer_(frames, oledLeft, oledRight, pixels)
+#if ALARM_CLOCK_PROFILE
+    , profiler_(alarmClock_, i2cDma, dfPlayer, oledLeft, oledRight, renderer_)
+#endif
+    , shell_(alarmClock_, dfPlayer, i2cDma, renderer_, console)
+    , scheduler_(keys, dfPlayer, &shell_)
+    , dualCore_(dualCore)
+    , loopCostUs_(loopCostUs)
+    , tickless_(tickless)
+    , iterations_(0)
+    , sleepTime_(0)
+    , keyEdge_(sim::Clock::never)
+    , maxKeyLatency_(0)
+    , pressEdge_(sim::Clock::never)
+    , displayEdge_(sim::Clock::never)
+    , lastPanelData_(0)
+    , keyToDisplayCount_(0)
+    , keyToDisplayMax_(0)
+    , keyToDisplaySum_(0)
+    , blinkSteps_(0)
+    , lastBlink_(sim::Clock::never)
+    , maxBlinkInterval_(0)
+    , maxBlinkLateness_(0)
+    , core1Wake_(sim::Clock::never)
+    , level_(0)
+    , levelDirection_(0)
+    , levelChanged_(0)
+    , levelChanges_(0)
+    , levelFlaps_(0)
+{
+#if ALARM_CLOCK_PROFILE
+  shell_.setProfiler(&profiler_);
+#endif
+  pixels.simOnUpdate([this]()
+  {
+    uint64_t now = sim::clock().now();
+    if (not alarmClock_.alarmIsPlaying())
+    {
+      lastBlink_ = sim::Clock::never;
+      return;
+    }
+
+    if (lastBlink_ != sim::Clock::never)
+    {
+      static constexpr uint64_t STEP_US = 50000;
+      uint64_t interval = now - lastBlink_;
+      uint64_t steps    = std::max<uint64_t>(1, (interval + STEP_US / 2) / STEP_US);
+      uint64_t late     = interval > steps * STEP_US ? (interval - steps * STEP_US) / steps : 0;
+      maxBlinkInterval_ = std::max(maxBlinkInterval_, interval);
+      maxBlinkLateness_ = std::max(maxBlinkLateness_, late);
+    }
+    lastBlink_ = now;
+    blinkSteps_++;
+  });
+
+  // Runs after the transfer interrupt, when the panel is free again.
+  auto data = [this]()
+  {
+    lastPanelData_ = sim::clock().now();
+    if (renderer_.pending())
+    {
+      sim::clock().at(sim::clock().now(), [this]() { core1(); });
+    }
+  };
+  panelLeft.onData(data);
+  panelRight.onData(data);
+
+  core1();
+}
+
+void Simulation::core1()
+{
+  sim::clock().offload(dualCore_);
+  renderer_.run();
+  sim::clock().offload(false);
+
+  // One timer alarm at a time, an earlier step replaces it.
+  uint64_t wake = to_us_since_boot(renderer_.deadline());
+  if (wake != sim::Clock::never and (wake < core1Wake_ or core1Wake_ <= sim::clock().now()))
+  {
+    core1Wake_ = wake;
+    sim::clock().at(wake, [this, wake]()
+    {
+      if (core1Wake_ == wake)
+      {
+        core1Wake_ = sim::Clock::never;
+        core1();
+      }
+    });
+  }
+}
+
+uint64_t Simulation::keyLatency(double q) const
+{
+  if (keyLatencies_.empty())
+  {
+    return 0;
+  }
+
+  std::vector<uint64_t> sorted = keyLatencies_;
+  std::sort(sorted.begin(), sorted.end());
+  return sorted[std::min(sorted.size() - 1, size_t(q * sorted.size()))];
+}
+
+static bool same(const Oled &oled, const sim::Panel &panel)
+{
+  for (uint32_t page = 0; page < Oled::PAGES; page++)
+  {
+    if (memcmp(oled.page(page), panel.page(page), Oled::WIDTH) != 0)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Simulation::panelsMatch()
+{
+  i2cDma.wait();
+  return same(oledLeft, panelLeft) and same(oledRight, panelRight);
+}
+
+void Simulation::press(uint8_t pin, uint64_t atUs, uint32_t holdMs)
+{
+  static constexpr uint64_t BOUNCE_US = 300;
+  uint64_t releaseUs = atUs + uint64_t(holdMs) * 1000;
+
+  sim::clock().at(atUs, [this, pin]()
+  {
+    sim::gpio().set(pin, false);
+    keyEdge_   = sim::clock().now();
+    pressEdge_ = sim::clock().now();
+  });
+  sim::clock().at(atUs + BOUNCE_US, [pin]() { sim::gpio().set(pin, true); });
+  sim::clock().at(atUs + 2 * BOUNCE_US, [pin]() { sim::gpio().set(pin, false); });
+
+  sim::clock().at(releaseUs, [pin]() { sim::gpio().set(pin, true); });
+  sim::clock().at(releaseUs + BOUNCE_US, [pin]() { sim::gpio().set(pin, false); });
+  sim::clock().at(releaseUs + 2 * BOUNCE_US, [pin]() { sim::gpio().set(pin, true); });
+}
+
+// A press counts when the pass that handled it published a frame that
+// started a flush, not a step of a digit transition. The panels
+// show the result with the last write before no flush is in flight.
+void Simulation::finishKeyToDisplay()
+{
+  if (displayEdge_ == sim::Clock::never or oledLeft.flushing() or oledRight.flushing())
+  {
+    return;
+  }
+
+  if (lastPanelData_ >= displayEdge_)
+  {
+    uint64_t latency  = lastPanelData_ - displayEdge_;
+    keyToDisplayMax_  = std::max(keyToDisplayMax_, latency);
+    keyToDisplaySum_ += latency;
+    keyToDisplayCount_++;
+  }
+  displayEdge_ = sim::Clock::never;
+}
+
+void Simulation::step(uint64_t limit)
+{
+  uint64_t before = sim::clock().now();
+  const char *name = alarmClock_.stateName();
+
+  if (keyEdge_ != sim::Clock::never)
+  {
+    maxKeyLatency_ = std::max(maxKeyLatency_, before - keyEdge_);
+    keyLatencies_.push_back(before - keyEdge_);
+    keyEdge_       = sim::Clock::never;
+  }
+
+  finishKeyToDisplay();
+  uint64_t press   = pressEdge_;
+  uint32_t flushes = oledLeft.flushes() + oledRight.flushes();
+  uint32_t frames  = renderer_.frames();
+  pressEdge_       = sim::Clock::never;
+
+#if ALARM_CLOCK_PROFILE
+  uint32_t start = time_us_32();
+  alarmClock_.run();
+  profiler_.loop(time_us_32() - start);
+#else
+  alarmClock_.run();
+#endif
+  shell_.poll();
+  settings_.run();
+  trackLevel();
+  core1();
+  if (press != sim::Clock::never and renderer_.frames() != frames and oledLeft.flushes() + oledRight.flushes() != flushes)
+  {
+    displayEdge_ = press;
+  }
+
+  sim::clock().advance(loopCostUs_);
+  stateTime_[name] += sim::clock().now() - before;
+  iterations_++;
+
+  if (tickless_)
+  {
+    before = sim::clock().now();
+    absolute_time_t deadline = absolute_time_min(alarmClock_.deadline(), settings_.deadline());
+    scheduler_.sleepUntil(absolute_time_min(deadline, limit));
+    sleepTime_ += sim::clock().now() - before;
+  }
+}
+
+void Simulation::trackLevel()
+{
+  uint8_t level = alarmClock_.level();
+  if (level == level_)
+  {
+    return;
+  }
+
+  uint64_t now      = sim::clock().now();
+  int32_t direction = level > level_ ? 1 : -1;
+  if (levelChanges_ > 0 and direction != levelDirection_ and now - levelChanged_ < FLAP_US)
+  {
+    levelFlaps_++;
+  }
+  levelChanges_++;
+  levelDirection_ = direction;
+  levelChanged_   = now;
+  level_          = level;
+}
+
+void Simulation::runUntil(uint64_t us)
+{
+  while (sim::clock().now() < us)
+  {
+    step(us);
+  }
+}
@@ -0,0 +1,160 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "alarmclock.h"
+#include "scheduler.h"
+#include "renderer.h"
+#include "shell.h"
+#include "settings.h"
+#include "cilo72/hw/i2c_bus.h"
+#include "simclock.h"
+#include "simbus.h"
+#include "simpanel.h"
+#include "simdfplayer.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// The alarm clock wired to fake drivers, plus a loop that charges a fixed
+// CPU cost per pass and books simulated time to the current state. With
+// tickless set the loop sleeps through the Scheduler like main() does,
+// otherwise it busy-polls.
+//
+// The Renderer gets a pass after every pass of the state machine, whenever
+// a display transfer completes while it has work left and at its animation
+// deadline, while core0 may sleep. With dualCore its time is booked to
+// core1 and does not delay core0; without, it runs inline on core0 as a
+// single-core build would.
+//
+// The shell reads sim::console() after each pass and answers to console;
+// with the profiling built in, passes are profiled as main() does. The
+// settings live in sim::flash(), which a scenario erases first unless it
+// is to start from an earlier run.
+class Simulation
+{
+public:
+  static constexpr uint8_t PIN_KEY_1 = 28;
+  static constexpr uint8_t PIN_KEY_2 = 27;
+  static constexpr uint8_t PIN_KEY_3 = 26;
+  static constexpr uint8_t PIN_KEY_4 = 22;
+
+  static constexpr uint8_t KEY_PLUS  = PIN_KEY_1;
+  static constexpr uint8_t KEY_MINUS = PIN_KEY_2;
+  static constexpr uint8_t KEY_ALARM = PIN_KEY_3;
+  static constexpr uint8_t KEY_ENTER = PIN_KEY_4;
+
+  static constexpr uint64_t SECOND = 1000000;
+  static constexpr uint64_t MINUTE = 60 * SECOND;
+
+  // A brightness level change undoing the previous one within this counts as
+  // a flap.
+  static constexpr uint64_t FLAP_US = 10 * SECOND;
+
+  // The alarm is what the RTC holds at boot, the clock reads it only once.
+  Simulation(uint32_t loopCostUs = 5, bool tickless = true,
+             const cilo72::ic::SD2405::Time &alarm = cilo72::ic::SD2405::Time(0, 0, 0), bool dualCore = true,
+             FILE *console = stdout);
+
+  Keys keys;
+  cilo72::hw::I2CBus i2cBus;
+  cilo72::ic::SD2405 rtc;
+  cilo72::ic::BH1750FVI lux;
+  cilo72::ic::WS2812 pixels;
+  sim::Panel panelRight;
+  sim::Panel panelLeft;
+  I2cDma i2cDma;
+  Oled oledRight;
+  Oled oledLeft;
+  sim::DfPlayerModel dfPlayerModel;
+  DfPlayer dfPlayer;
+  Mailbox<Frame> frames;
+
+  // True when both panels show exactly what the framebuffers hold, once the
+  // flushes in flight are through.
+  bool panelsMatch();
+
+  // Pulls the key pin low at atUs for holdMs, with contact bounce on both
+  // edges.
+  void press(uint8_t pin, uint64_t atUs, uint32_t holdMs = 80);
+  void step(uint64_t limit = sim::Clock::never);
+  void runUntil(uint64_t us);
+
+  AlarmClock &alarmClock() { return alarmClock_; }
+  Renderer &renderer() { return renderer_; }
+  Shell &shell() { return shell_; }
+  Settings &settings() { return settings_; }
+#if ALARM_CLOCK_PROFILE
+  const Profiler &profiler() const { return profiler_; }
+#endif
+  Scheduler &scheduler() { return scheduler_; }
+  uint64_t iterations() const { return iterations_; }
+  const std::map<std::string, uint64_t> &stateTime() const { return stateTime_; }
+  uint64_t sleepTime() const { return sleepTime_; }
+  uint64_t maxKeyLatency() const { return maxKeyLatency_; }
+
+  // From a key edge to the start of the pass that handles it, at quantile
+  // q of all presses.
+  uint64_t keyLatency(double q) const;
+  uint64_t core1Time() const { return sim::clock().offloaded(); }
+
+  // From a key press to the end of the display update it caused, for the
+  // presses that changed the display.
+  uint32_t keyToDisplayCount() const { return keyToDisplayCount_; }
+  uint64_t keyToDisplayMax() const { return keyToDisplayMax_; }
+  uint64_t keyToDisplayMean() const { return keyToDisplayCount_ ? keyToDisplaySum_ / keyToDisplayCount_ : 0; }
+
+  // Pixel updates while the alarm plays, the longest gap between two and
+  // how late the 50 ms blink steps in between came, at most per step. Steps
+  // that leave the pixel as it is are not sent, a gap spans one or more.
+  uint32_t blinkSteps() const { return blinkSteps_; }
+  uint64_t maxBlinkInterval() const { return maxBlinkInterval_; }
+  uint64_t maxBlinkLateness() const { return maxBlinkLateness_; }
+
+  uint32_t levelChanges() const { return levelChanges_; }
+  uint32_t levelFlaps() const { return levelFlaps_; }
+
+private:
+  AlarmClock alarmClock_;
+  FlashStore store_;
+  Settings settings_;
+  Renderer renderer_;
+#if ALARM_CLOCK_PROFILE
+  Profiler profiler_;
+#endif
+  Shell shell_;
+  Scheduler scheduler_;
+  bool dualCore_;
+  uint32_t loopCostUs_;
+  bool tickless_;
+  uint64_t iterations_;
+  std::map<std::string, uint64_t> stateTime_;
+  uint64_t sleepTime_;
+  uint64_t keyEdge_;
+  uint64_t maxKeyLatency_;
+  std::vector<uint64_t> keyLatencies_;
+  uint64_t pressEdge_;          ///< Press not handled by a loop pass yet.
+  uint64_t displayEdge_;        ///< Press whose display update is in flight.
+  uint64_t lastPanelData_;
+  uint32_t keyToDisplayCount_;
+  uint64_t keyToDisplayMax_;
+  uint64_t keyToDisplaySum_;
+  uint32_t blinkSteps_;
+  uint64_t lastBlink_;
+  uint64_t maxBlinkInterval_;
+  uint64_t maxBlinkLateness_;
+  uint64_t core1Wake_;          ///< Animation step core1 is woken for.
+  uint8_t level_;
+  int32_t levelDirection_;
+  uint64_t levelChanged_;
+  uint32_t levelChanges_;
+  uint32_t levelFlaps_;
+
+  void trackLevel();
+
+  void finishKeyToDisplay();
+  void core1();
+};
@@ -0,0 +1,201 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "statebench.h"
+#include "legacystate.h"
+#include "statemachine.h"
+#include <chrono>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Keeps the handler results alive.
+static volatile uint64_t keep;
+
+// Heap use of everything the benchmark builds.
+static uint64_t allocations = 0;
+static uint64_t allocatedBytes = 0;
+
+void *operator new(size_t size)
+{
+  allocations++;
+  allocatedBytes += size;
+  void *p = malloc(size ? size : 1);
+  if (p == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+  free(p);
+}
+
+static constexpr uint32_t STATES         = 6;
+static constexpr uint32_t RUNS_PER_STATE = 16;
+
+// What the handlers of the clock typically touch: a few counters and timers.
+struct Context
+{
+  uint32_t runs    = 0;
+  uint32_t enters  = 0;
+  uint32_t exits   = 0;
+  uint64_t elapsed = 0;
+};
+
+class Table
+{
+public:
+  enum class StateId : uint8_t
+  {
+    S0, S1, S2, S3, S4, S5, Count
+  };
+
+  Table(Context &context)
+      : context_(context), sm_(*this, states_, uint8_t(StateId::S0))
+  {
+  }
+
+  void run() { sm_.run(); }
+  absolute_time_t deadline() { return sm_.deadline(); }
+  size_t machineSize() const { return sizeof(sm_); }
+  static constexpr size_t tableSize() { return sizeof(states_); }
+
+private:
+  Context &context_;
+  static const State<Table> states_[STATES];
+  StateMachine<Table, STATES> sm_;
+
+  void enter() { context_.enters++; }
+  void exit() { context_.exits++; }
+  absolute_time_t deadline0() { return context_.elapsed; }
+
+  template <StateId NEXT>
+  StateMachineCommand step()
+  {
+    if (++context_.runs % RUNS_PER_STATE == 0)
+    {
+      return StateMachineCommand::changeTo(NEXT);
+    }
+    return StateMachineCommand::nothing();
+  }
+};
+
+using S = State<Table>;
+
+const State<Table> Table::states_[STATES] = {
+  {"S0", S::call<&Table::enter>, S::call<&Table::step<Table::StateId::S1>>, S::call<&Table::exit>, S::call<&Table::deadline0>},
+  {"S1", S::call<&Table::enter>, S::call<&Table::step<Table::StateId::S2>>, S::call<&Table::exit>, S::call<&Table::deadline0>},
+  {"S2", S::call<&Table::enter>, S::call<&Table::step<Table::StateId::S3>>, S::call<&Table::exit>, S::call<&Table::deadline0>},
+  {"S3", S::call<&Table::enter>, S::call<&Table::step<Table::StateId::S4>>, S::call<&Table::exit>, S::call<&Table::deadline0>},
+  {"S4", S::call<&Table::enter>, S::call<&Table::step<Table::StateId::S5>>, S::call<&Table::exit>, S::call<&Table::deadline0>},
+  {"S5", S::call<&Table::enter>, S::call<&Table::step<Table::StateId::S0>>, S::call<&Table::exit>, S::call<&Table::deadline0>},
+};
+
+// One instantiation per state, so every state runs its own handler code like
+// the states of the clock do and neither engine gets a single call target.
+template <uint32_t I>
+static void setup(legacy::State *states[], uint32_t &runs, uint32_t &enters, uint32_t &exits, uint64_t &elapsed)
+{
+  legacy::State *next = states[(I + 1) % STATES];
+  states[I]->setOnEnter([&enters, &runs, &elapsed]() { enters++; });
+  states[I]->setOnExit([&exits, &runs, &elapsed]() { exits++; });
+  states[I]->setOnDeadline([&elapsed, &runs, &enters]() { return absolute_time_t(elapsed); });
+  states[I]->setOnRun([&runs, &enters, &exits, &elapsed, next](legacy::State &state) -> const legacy::StateMachineCommand *
+  {
+    if (++runs % RUNS_PER_STATE == 0)
+    {
+      return state.changeTo(next);
+    }
+    return state.nothing();
+  });
+}
+
+template <typename Machine>
+static double nsPerPass(Machine &machine, uint64_t iterations, uint64_t &sink)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < iterations; i++)
+  {
+    machine.run();
+    sink += machine.deadline();
+  }
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+int statesBench(uint64_t iterations)
+{
+  uint64_t sink = 0;
+
+  // The handlers capture references the way the old main() did.
+  Context legacyContext;
+  uint32_t &runs    = legacyContext.runs;
+  uint32_t &enters  = legacyContext.enters;
+  uint32_t &exits   = legacyContext.exits;
+  uint64_t &elapsed = legacyContext.elapsed;
+
+  uint64_t before = allocatedBytes;
+  uint64_t count  = allocations;
+  legacy::State *states[STATES];
+  for (uint32_t i = 0; i < STATES; i++)
+  {
+    states[i] = new legacy::State("S");
+  }
+  setup<0>(states, runs, enters, exits, elapsed);
+  setup<1>(states, runs, enters, exits, elapsed);
+  setup<2>(states, runs, enters, exits, elapsed);
+  setup<3>(states, runs, enters, exits, elapsed);
+  setup<4>(states, runs, enters, exits, elapsed);
+  setup<5>(states, runs, enters, exits, elapsed);
+  legacy::StateMachine legacyMachine(states[0]);
+  uint64_t legacyHeap   = allocatedBytes - before;
+  uint64_t legacyAllocs = allocations - count;
+
+  Context tableContext;
+  before = allocatedBytes;
+  count  = allocations;
+  Table table(tableContext);
+  uint64_t tableHeap   = allocatedBytes - before;
+  uint64_t tableAllocs = allocations - count;
+
+  // Warm up both, then measure.
+  nsPerPass(legacyMachine, iterations / 10, sink);
+  nsPerPass(table, iterations / 10, sink);
+  double legacyNs = nsPerPass(legacyMachine, iterations, sink);
+  double tableNs  = nsPerPass(table, iterations, sink);
+  keep            = sink;
+
+  size_t legacyRam = STATES * sizeof(legacy::State) + legacyHeap + sizeof(legacyMachine);
+  size_t tableRam  = table.machineSize();
+
+  printf("states              : %u, change every %u passes, %llu passes\n", STATES, RUNS_PER_STATE,
+         (unsigned long long)iterations);
+  printf("                      %12s %12s\n", "std::function", "table");
+  printf("ns per pass         : %12.2f %12.2f\n", legacyNs, tableNs);
+  printf("heap allocations    : %12llu %12llu\n", (unsigned long long)legacyAllocs, (unsigned long long)tableAllocs);
+  printf("RAM bytes           : %12zu %12zu\n", legacyRam, tableRam);
+  printf("  per state         : %12zu %12zu\n", sizeof(legacy::State), size_t(0));
+  printf("  heap              : %12llu %12llu\n", (unsigned long long)legacyHeap, (unsigned long long)tableHeap);
+  printf("const table bytes   : %12zu %12zu\n", size_t(0), Table::tableSize());
+
+  for (legacy::State *state : states)
+  {
+    delete state;
+  }
+
+  if (legacyContext.enters != tableContext.enters or legacyContext.exits != tableContext.exits)
+  {
+    printf("FAIL: the engines took different transitions\n");
+    return 1;
+  }
+  return 0;
+}
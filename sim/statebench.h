@@ -0,0 +1,12 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Dispatch cost and memory of the state table against the std::function
+// states in legacystate.h, on six states that change every few passes.
+int statesBench(uint64_t iterations);
@@ -0,0 +1,160 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "timertest.h"
+#include "timerwheel.h"
+#include "simclock.h"
+#include <random>
+#include <stdio.h>
+
+static constexpr uint32_t TIMERS = 16;
+
+struct Expected
+{
+  bool armed;
+  uint64_t expiry;   ///< Tick, as the wheel counts them.
+  uint32_t periodMs;
+};
+
+// Up to 35 minutes, past the reach of the top level.
+static uint32_t randomMs(std::mt19937 &random)
+{
+  switch (random() % 4)
+  {
+  case 0:
+    return random() % 32;
+  case 1:
+    return random() % 2000;
+  case 2:
+    return random() % 60000;
+  default:
+    return random() % 2100000;
+  }
+}
+
+static uint64_t randomStepUs(std::mt19937 &random)
+{
+  switch (random() % 8)
+  {
+  case 0:
+    return random() % 1000;
+  case 1:
+  case 2:
+  case 3:
+    return random() % 5000;
+  case 4:
+  case 5:
+    return random() % 500000;
+  case 6:
+    return random() % 30000000;
+  default:
+    return random() % 1800000000;
+  }
+}
+
+int timerTest(uint32_t steps)
+{
+  sim::clock().reset();
+  sim::clock().advance(123456);
+
+  std::mt19937 random(7);
+  TimerWheel wheel;
+  Timer timers[TIMERS];
+  Expected expected[TIMERS] = {};
+
+  int failures   = 0;
+  uint64_t fired = 0;
+  uint64_t armed = 0;
+
+  for (uint32_t step = 0; step < steps and failures < 10; step++)
+  {
+    uint32_t i = random() % TIMERS;
+    switch (random() % 4)
+    {
+    case 0:
+    case 1:
+    {
+      uint32_t ms       = randomMs(random);
+      uint32_t periodMs = random() % 3 == 0 ? 50 + randomMs(random) : 0;
+      wheel.start(timers[i], ms, periodMs);
+      expected[i] = {true, (sim::clock().now() + 999) / 1000 + ms, periodMs};
+      armed++;
+      break;
+    }
+    case 2:
+      wheel.cancel(timers[i]);
+      expected[i].armed = false;
+      break;
+    default:
+      sim::clock().advance(randomStepUs(random));
+      break;
+    }
+
+    wheel.advance();
+    uint64_t now = sim::clock().now() / 1000;
+
+    Timer *timer;
+    while (wheel.pop(timer))
+    {
+      Expected &e = expected[timer - timers];
+      if (not e.armed or e.expiry > now)
+      {
+        printf("FAIL: timer %td expired at %llu, expected %llu%s\n", timer - timers, (unsigned long long)now,
+               (unsigned long long)e.expiry, e.armed ? "" : " (cancelled)");
+        failures++;
+      }
+
+      // A periodic timer expired several times since the last pop is one
+      // event.
+      if (e.periodMs > 0)
+      {
+        while (e.expiry <= now)
+        {
+          e.expiry += e.periodMs;
+        }
+      }
+      else
+      {
+        e.armed = false;
+      }
+      fired++;
+    }
+
+    uint64_t earliest = UINT64_MAX;
+    for (uint32_t t = 0; t < TIMERS; t++)
+    {
+      if (expected[t].armed and expected[t].expiry <= now)
+      {
+        printf("FAIL: timer %u due at %llu did not expire by %llu\n", t, (unsigned long long)expected[t].expiry,
+               (unsigned long long)now);
+        failures++;
+        expected[t].armed = false;
+      }
+      if (expected[t].armed and expected[t].expiry < earliest)
+      {
+        earliest = expected[t].expiry;
+      }
+      if (expected[t].armed != timers[t].armed())
+      {
+        printf("FAIL: timer %u armed %d, expected %d\n", t, timers[t].armed(), expected[t].armed);
+        failures++;
+        expected[t].armed = timers[t].armed();
+      }
+    }
+
+    absolute_time_t deadline = wheel.deadline();
+    absolute_time_t expect   = earliest == UINT64_MAX ? at_the_end_of_time : from_us_since_boot(earliest * 1000);
+    if (deadline != expect)
+    {
+      printf("FAIL: deadline %llu, expected %llu\n", (unsigned long long)deadline, (unsigned long long)expect);
+      failures++;
+    }
+  }
+
+  printf("timer wheel: %u steps over %.1f simulated days, %llu armed, %llu expired\n", steps,
+         sim::clock().now() / 86400e6, (unsigned long long)armed, (unsigned long long)fired);
+  printf(failures ? "FAIL: %d\n" : "OK\n", failures);
+  return failures;
+}
@@ -0,0 +1,15 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Arms, cancels and expires timers of the TimerWheel at random against a
+// plain list of expiry times, with the clock jumping ahead by anything from
+// a microsecond to half an hour. Every timer has to expire at its tick,
+// never early and never skipped, and the wheel's deadline has to be the
+// earliest expiry. Returns the number of failures.
+int timerTest(uint32_t steps);
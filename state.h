@@ -5,69 +5,30 @@
 
 #pragma once
 
-#include <functional>
+#include "pico/time.h"
 #include "statemachinecommand.h"
 
-class State
+// One row of a state table. Each handler is a member function of the owner
+// bound at compile time through the call<> trampoline, so a table of states
+// is a constant array that lives in flash, costs neither heap nor RAM, and
+// dispatches with one plain indirect call. Handlers left null do nothing; a
+// state without a deadline handler keeps polling.
+template <typename Owner>
+struct State
 {
-    public:
-    State()
-    : onEnter_([](){})
-    , onRun_([&](State & state) -> const StateMachineCommand * { return nothing(); })
-    , onExit_([](){})
-    {
-
-    }
-
-    void back()
-    {
-
-    }
-
-    const StateMachineCommand * run() 
-    {
-        return onRun_(*this);
-    }
-
-    void setOnRun(std::function<const StateMachineCommand *(State & state)> f)
-    {
-        onRun_ = f;
-    }
-
-    void setOnEnter(std::function<void()> f)
-    {
-        onEnter_ = f;
-    }
-
-    void onEnter()
-    {
-        onEnter_();
-    }
-
-    void setOnExit(std::function<void()> f)
-    {
-        onExit_ = f;
-    }
-
-    void onExit()
-    {
-        onExit_();
-    }
-
-    const StateMachineCommand * nothing() const
-    {
-        return &nothing_;
-    }
+    using Action   = void (*)(Owner &);
+    using Run      = StateMachineCommand (*)(Owner &);
+    using Deadline = absolute_time_t (*)(Owner &);
 
-    const StateMachineCommand *  changeTo(State * next)
+    template <auto F>
+    static auto call(Owner & owner)
     {
-        change_.to(next);
-        return &change_;
+        return (owner.*F)();
     }
 
-    StateMachineCommand nothing_;
-    StateMachineCommandChange change_;
-    std::function<void()> onEnter_;
-    std::function<const StateMachineCommand *(State & state)> onRun_;
-    std::function<void()> onExit_;
-};
\ No newline at end of file
+    const char * name;
+    Action onEnter;
+    Run onRun;
+    Action onExit;
+    Deadline onDeadline;
+};
@@ -5,43 +5,30 @@
 
 #include "statemachine.h"
 
-StateMachine::StateMachine(State *state)
-    : state_(state)
+StateHistory::StateHistory()
+    : top_(0), size_(0)
 {
 }
 
-void StateMachine::run()
+void StateHistory::push(uint8_t state)
 {
-    const StateMachineCommand *cmd = state_->run();
-
-    switch (cmd->type())
-    {
-    case StateMachineCommand::Type::Nothing:
+    states_[top_] = state;
+    top_          = (top_ + 1) % DEPTH;
+    if (size_ < DEPTH)
     {
+        size_++;
     }
-    break;
+}
 
-    case StateMachineCommand::Type::Back:
+bool StateHistory::pop(uint8_t &state)
+{
+    if (size_ == 0)
     {
+        return false;
     }
-    break;
 
-    case StateMachineCommand::Type::Change:
-    {
-        const StateMachineCommandChange *next = static_cast<const StateMachineCommandChange *>(cmd);
-
-        State *nextState = next->state();
-
-        if (nextState)
-        {
-            if (nextState != state_)
-            {
-                state_->onExit();
-                nextState->onEnter();
-                state_ = nextState;
-            }
-        }
-    }
-    break;
-    }
+    top_  = (top_ + DEPTH - 1) % DEPTH;
+    state = states_[top_];
+    size_--;
+    return true;
 }
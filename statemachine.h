@@ -5,15 +5,152 @@
 
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include "histogram.h"
 #include "state.h"
 #include "statemachinecommand.h"
 
+// The states changed away from, most recent on top. When full the oldest
+// entry is dropped, so Back always leads to one of the last DEPTH states.
+class StateHistory
+{
+    public:
+    static constexpr uint32_t DEPTH = 4;
+
+    StateHistory();
+
+    void push(uint8_t state);
+    bool pop(uint8_t & state);
+    uint32_t size() const { return size_; }
+
+    private:
+    uint8_t states_[DEPTH];
+    uint32_t top_;
+    uint32_t size_;
+};
+
+// The handlers of a state the profiling times apart.
+enum class StatePhase : uint8_t
+{
+    Enter,
+    Run,
+    Exit,
+    Count
+};
+
+// Runs the states of a constant table, the commands address states by their
+// index in it.
+template <typename Owner, size_t N>
 class StateMachine
 {
     public:
-    StateMachine(State * state);
+    constexpr StateMachine(Owner & owner, const State<Owner> (&states)[N], uint8_t initial)
+    : owner_(owner)
+    , states_(states)
+    , current_(&states[initial])
+    {
+
+    }
+
+    void run()
+    {
+        if (current_->onRun == nullptr)
+        {
+            return;
+        }
+
+        uint32_t start = ticks();
+        StateMachineCommand cmd = current_->onRun(owner_);
+        record(StatePhase::Run, start);
+        uint8_t next;
+
+        switch (cmd.type())
+        {
+        case StateMachineCommand::Type::Nothing:
+        {
+        }
+        break;
+
+        case StateMachineCommand::Type::Back:
+        {
+            if (history_.pop(next) and next != state())
+            {
+                change(next);
+            }
+        }
+        break;
+
+        case StateMachineCommand::Type::Change:
+        {
+            next = cmd.state();
+            if (next < N and next != state())
+            {
+                history_.push(state());
+                change(next);
+            }
+        }
+        break;
+        }
+    }
+
+    uint8_t state() const { return current_ - states_; }
+    const char * name() const { return current_->name; }
+    const StateHistory & history() const { return history_; }
+
+    static constexpr uint8_t size() { return N; }
+    const char * name(uint8_t state) const { return states_[state].name; }
+
+#if ALARM_CLOCK_PROFILE
+    // How long the handlers of the state took, in microseconds.
+    const Histogram & profile(uint8_t state, StatePhase phase) const { return profile_[state][uint8_t(phase)]; }
+#endif
+
+    absolute_time_t deadline()
+    {
+        return current_->onDeadline ? current_->onDeadline(owner_) : get_absolute_time();
+    }
 
-    void run();
     private:
-    State * state_;
+    Owner & owner_;
+    const State<Owner> * states_;
+    const State<Owner> * current_;
+    StateHistory history_;
+#if ALARM_CLOCK_PROFILE
+    Histogram profile_[N][uint8_t(StatePhase::Count)];
+#endif
+
+    void change(uint8_t next)
+    {
+        if (current_->onExit)
+        {
+            uint32_t start = ticks();
+            current_->onExit(owner_);
+            record(StatePhase::Exit, start);
+        }
+        current_ = &states_[next];
+        if (current_->onEnter)
+        {
+            uint32_t start = ticks();
+            current_->onEnter(owner_);
+            record(StatePhase::Enter, start);
+        }
+    }
+
+    // Both fold away without the profiling.
+    static uint32_t ticks()
+    {
+#if ALARM_CLOCK_PROFILE
+        return time_us_32();
+#else
+        return 0;
+#endif
+    }
+
+    void record(StatePhase phase, uint32_t start)
+    {
+#if ALARM_CLOCK_PROFILE
+        profile_[state()][uint8_t(phase)].add(time_us_32() - start);
+#endif
+    }
 };
@@ -5,61 +5,55 @@
 
 #pragma once
 
-class State;
+#include <stdint.h>
 
+// What a state's run handler asks the state machine to do next. Returned by
+// value; the target of a change is an index into the state table.
 class StateMachineCommand
 {
     public:
-    enum class Type
+    enum class Type : uint8_t
     {
         Nothing,
         Back,
         Change
     };
 
-    StateMachineCommand(Type type = Type::Nothing)
+    constexpr StateMachineCommand(Type type = Type::Nothing, uint8_t state = 0)
     : type_(type)
+    , state_(state)
     {
 
     }
 
-    Type type() const
+    static constexpr StateMachineCommand nothing()
     {
-        return type_;
+        return StateMachineCommand(Type::Nothing);
     }
 
-    protected:
-    Type type_;
-};
-
-class StateMachineCommandBack : public StateMachineCommand
-{
-    public:
-      StateMachineCommandBack()
-      : StateMachineCommand(Type::Back)
-      {
-
-      }
-};
-
-class StateMachineCommandChange : public StateMachineCommand
-{
-    public:
-      StateMachineCommandChange()
-      : StateMachineCommand(Type::Change)
-      {
+    // Returns to the state that was active before the last change.
+    static constexpr StateMachineCommand back()
+    {
+        return StateMachineCommand(Type::Back);
+    }
 
-      }
+    template <typename Id>
+    static constexpr StateMachineCommand changeTo(Id state)
+    {
+        return StateMachineCommand(Type::Change, static_cast<uint8_t>(state));
+    }
 
-      void to(State * to)
-      {
-        to_ = to;
-      }
+    constexpr Type type() const
+    {
+        return type_;
+    }
 
-      State * state() const
-      {
-        return to_;
-      }
+    constexpr uint8_t state() const
+    {
+        return state_;
+    }
 
-      State * to_;
-};
\ No newline at end of file
+    protected:
+    Type type_;
+    uint8_t state_;
+};
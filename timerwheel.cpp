@@ -0,0 +1,278 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "timerwheel.h"
+
+Timer::Timer()
+    : next_(nullptr)
+    , pprev_(nullptr)
+    , nextFired_(nullptr)
+    , queued_(false)
+    , fired_(false)
+    , expiry_(0)
+    , periodMs_(0)
+    , level_(0)
+    , slot_(0)
+{
+}
+
+TimerWheel::TimerWheel()
+    : occupied_{}
+    , far_(nullptr)
+    , now_(time_us_64() / 1000)
+    , firedHead_(nullptr)
+    , firedTail_(nullptr)
+{
+  for (uint32_t level = 0; level < LEVELS; level++)
+  {
+    for (uint32_t slot = 0; slot < SLOTS; slot++)
+    {
+      slots_[level][slot] = nullptr;
+    }
+  }
+}
+
+// Rounded up, a timer never expires before its full time.
+uint64_t TimerWheel::ticks()
+{
+  return (time_us_64() + 999) / 1000;
+}
+
+void TimerWheel::start(Timer &timer, uint32_t ms, uint32_t periodMs)
+{
+  cancel(timer);
+  timer.expiry_   = ticks() + ms;
+  timer.periodMs_ = periodMs;
+  insert(timer);
+}
+
+void TimerWheel::cancel(Timer &timer)
+{
+  unlink(timer);
+  timer.fired_ = false;
+}
+
+void TimerWheel::advance()
+{
+  uint64_t target = time_us_64() / 1000;
+  while (now_ < target)
+  {
+    // Nothing happens in between, the wheel can skip there.
+    uint64_t next = nextWork();
+    if (next > target)
+    {
+      now_ = target;
+      return;
+    }
+    now_ = next;
+    process();
+  }
+}
+
+bool TimerWheel::pop(Timer *&timer)
+{
+  while (firedHead_ != nullptr)
+  {
+    Timer *fired = firedHead_;
+    firedHead_   = fired->nextFired_;
+    if (firedHead_ == nullptr)
+    {
+      firedTail_ = nullptr;
+    }
+    fired->queued_ = false;
+
+    // Cancelled timers stay in the queue until here.
+    if (fired->fired_)
+    {
+      fired->fired_ = false;
+      timer         = fired;
+      return true;
+    }
+  }
+  return false;
+}
+
+absolute_time_t TimerWheel::deadline() const
+{
+  if (pending())
+  {
+    return get_absolute_time();
+  }
+
+  // The first occupied slot of a level holds its earliest timers.
+  uint64_t earliest = UINT64_MAX;
+  for (uint32_t level = 0; level < LEVELS; level++)
+  {
+    if (occupied_[level] == 0)
+    {
+      continue;
+    }
+    for (Timer *timer = slots_[level][__builtin_ctz(occupied_[level])]; timer != nullptr; timer = timer->next_)
+    {
+      earliest = timer->expiry_ < earliest ? timer->expiry_ : earliest;
+    }
+  }
+  for (Timer *timer = far_; timer != nullptr; timer = timer->next_)
+  {
+    earliest = timer->expiry_ < earliest ? timer->expiry_ : earliest;
+  }
+
+  return earliest == UINT64_MAX ? at_the_end_of_time : from_us_since_boot(earliest * 1000);
+}
+
+// The slot index of a timer is above the current one at its level: were it
+// equal, the timer would belong to a lower level.
+void TimerWheel::insert(Timer &timer)
+{
+  if (timer.expiry_ <= now_)
+  {
+    fire(timer);
+    return;
+  }
+
+  for (uint32_t level = 0; level < LEVELS; level++)
+  {
+    uint32_t above = BITS * (level + 1);
+    if ((timer.expiry_ >> above) == (now_ >> above))
+    {
+      uint32_t slot = (timer.expiry_ >> (BITS * level)) & (SLOTS - 1);
+      timer.level_  = level;
+      timer.slot_   = slot;
+      link(slots_[level][slot], timer);
+      occupied_[level] |= 1u << slot;
+      return;
+    }
+  }
+
+  timer.level_ = LEVELS;
+  link(far_, timer);
+}
+
+void TimerWheel::link(Timer *&head, Timer &timer)
+{
+  timer.next_ = head;
+  if (head != nullptr)
+  {
+    head->pprev_ = &timer.next_;
+  }
+  timer.pprev_ = &head;
+  head         = &timer;
+}
+
+void TimerWheel::unlink(Timer &timer)
+{
+  if (not timer.armed())
+  {
+    return;
+  }
+
+  *timer.pprev_ = timer.next_;
+  if (timer.next_ != nullptr)
+  {
+    timer.next_->pprev_ = timer.pprev_;
+  }
+  if (timer.level_ < LEVELS and slots_[timer.level_][timer.slot_] == nullptr)
+  {
+    occupied_[timer.level_] &= ~(1u << timer.slot_);
+  }
+  timer.next_  = nullptr;
+  timer.pprev_ = nullptr;
+}
+
+// A timer expired at now_; the next expiry of a periodic one follows from
+// this one.
+void TimerWheel::fire(Timer &timer)
+{
+  if (timer.periodMs_ > 0)
+  {
+    timer.expiry_ += timer.periodMs_;
+    insert(timer);
+  }
+
+  timer.fired_ = true;
+  if (not timer.queued_)
+  {
+    timer.queued_    = true;
+    timer.nextFired_ = nullptr;
+    if (firedTail_ != nullptr)
+    {
+      firedTail_->nextFired_ = &timer;
+    }
+    else
+    {
+      firedHead_ = &timer;
+    }
+    firedTail_ = &timer;
+  }
+}
+
+// Sorts a detached list into the wheel again from now_.
+void TimerWheel::cascade(Timer *list)
+{
+  while (list != nullptr)
+  {
+    Timer &timer = *list;
+    list         = timer.next_;
+    timer.next_  = nullptr;
+    timer.pprev_ = nullptr;
+    insert(timer);
+  }
+}
+
+// The next tick at which a slot expires or moves down, or the list beyond
+// the top level comes into reach.
+uint64_t TimerWheel::nextWork() const
+{
+  uint64_t next = UINT64_MAX;
+  for (uint32_t level = 0; level < LEVELS; level++)
+  {
+    if (occupied_[level] == 0)
+    {
+      continue;
+    }
+    uint32_t shift = BITS * level;
+    uint64_t block = now_ >> (shift + BITS) << (shift + BITS);
+    uint64_t at    = block + (uint64_t(__builtin_ctz(occupied_[level])) << shift);
+    next           = at < next ? at : next;
+  }
+  if (far_ != nullptr)
+  {
+    uint64_t wrap = ((now_ >> (BITS * LEVELS)) + 1) << (BITS * LEVELS);
+    next          = wrap < next ? wrap : next;
+  }
+  return next;
+}
+
+// At a level's boundary its slot for now_ moves down, top level first; what
+// reaches level 0 expires.
+void TimerWheel::process()
+{
+  if (far_ != nullptr and (now_ & ((uint64_t(1) << (BITS * LEVELS)) - 1)) == 0)
+  {
+    Timer *list = far_;
+    far_        = nullptr;
+    cascade(list);
+  }
+
+  for (uint32_t level = LEVELS; level-- > 0;)
+  {
+    uint32_t shift = BITS * level;
+    if (now_ & ((uint64_t(1) << shift) - 1))
+    {
+      continue;
+    }
+
+    uint32_t slot = (now_ >> shift) & (SLOTS - 1);
+    if ((occupied_[level] & (1u << slot)) == 0)
+    {
+      continue;
+    }
+
+    Timer *list         = slots_[level][slot];
+    slots_[level][slot] = nullptr;
+    occupied_[level]   &= ~(1u << slot);
+    cascade(list);
+  }
+}
@@ -0,0 +1,92 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "pico/time.h"
+#include <stdint.h>
+
+class TimerWheel;
+
+// A one-shot or periodic timer. The owner keeps it, the wheel only links
+// it, so arming and cancelling neither allocate nor search.
+class Timer
+{
+public:
+  Timer();
+  Timer(const Timer &) = delete;
+  Timer &operator=(const Timer &) = delete;
+
+  // Counting down; a one-shot timer that fired is no longer armed.
+  bool armed() const { return pprev_ != nullptr; }
+
+private:
+  friend class TimerWheel;
+
+  Timer *next_;         ///< In the slot's list.
+  Timer **pprev_;       ///< The pointer to this timer in that list, null when not armed.
+  Timer *nextFired_;
+  bool queued_;         ///< In the fired queue ...
+  bool fired_;          ///< ... and not cancelled since.
+  uint64_t expiry_;     ///< In ticks of 1 ms since boot.
+  uint32_t periodMs_;   ///< 0 for a one-shot timer.
+  uint8_t level_;       ///< LEVELS for the list beyond the top level.
+  uint8_t slot_;
+};
+
+// Timers in a hierarchical wheel of LEVELS x SLOTS lists with 1 ms ticks.
+// A timer sits in the lowest level whose slot tells its expiry apart from
+// the current tick; the slots of a higher level are moved down when the
+// wheel reaches them. Timers beyond the top level wait in a separate list
+// until it wraps.
+//
+// The wheel does not tick. advance() catches up to the current time from
+// one slot with work to the next, and deadline() tells when the next timer
+// expires, so the loop can sleep until then. Expired timers queue up as
+// events for pop(), in the order they expired; a periodic timer is armed
+// again from its expiry, not from when it was handled.
+class TimerWheel
+{
+public:
+  static constexpr uint32_t LEVELS = 4;
+  static constexpr uint32_t BITS   = 5;
+  static constexpr uint32_t SLOTS  = 1 << BITS;
+
+  TimerWheel();
+
+  // Arms the timer to expire in ms and then every periodMs, if not 0. An
+  // armed timer starts over.
+  void start(Timer &timer, uint32_t ms, uint32_t periodMs = 0);
+
+  // Disarms the timer and drops an event of it not popped yet.
+  void cancel(Timer &timer);
+
+  void advance();
+
+  // The next expired timer, one per call.
+  bool pop(Timer *&timer);
+  bool pending() const { return firedHead_ != nullptr; }
+
+  // When the next timer expires, now while events wait for pop().
+  absolute_time_t deadline() const;
+
+private:
+  Timer *slots_[LEVELS][SLOTS];
+  uint32_t occupied_[LEVELS];   ///< A bit per slot with timers.
+  Timer *far_;
+  uint64_t now_;                ///< The tick the wheel has advanced to.
+  Timer *firedHead_;
+  Timer *firedTail_;
+
+  static uint64_t ticks();
+
+  void insert(Timer &timer);
+  void link(Timer *&head, Timer &timer);
+  void unlink(Timer &timer);
+  void fire(Timer &timer);
+  void cascade(Timer *list);
+  uint64_t nextWork() const;
+  void process();
+};
@@ -0,0 +1,102 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#include "timeset.h"
+#include <stdio.h>
+
+TimeSet::TimeSet(uint8_t keyUp, uint8_t keyDown, uint8_t keyEnter)
+    : keyUp_(keyUp)
+    , keyDown_(keyDown)
+    , keyEnter_(keyEnter)
+    , selected_(0)
+{
+}
+
+void TimeSet::init(const cilo72::ic::SD2405::Time &time)
+{
+  time_ = time;
+  selected_ = 0;
+}
+
+bool TimeSet::run(const KeyEvent &event, bool & pressed)
+{
+  bool repeat = event.type == KeyEvent::Type::Press or event.type == KeyEvent::Type::Repeat;
+
+  if(event.is(KeyEvent::Type::Press, keyEnter_))
+  {
+    selected_++;
+  }
+  else if(repeat and event.key == keyUp_)
+  {
+    pressed = true;
+    step(1);
+  }
+  else if(repeat and event.key == keyDown_)
+  {
+    pressed = true;
+    step(-1);
+  }
+
+  return selected_ < 4;
+}
+
+void TimeSet::step(int32_t direction)
+{
+  switch (selected_)
+  {
+  case 0:
+    time_.setHour((time_.hour() + 24 + 10 * direction) % 24);
+    break;
+
+  case 1:
+    time_.setHour((time_.hour() + 24 + direction) % 24);
+    break;
+
+  case 2:
+    time_.setMinute((time_.minute() + 60 + 10 * direction) % 60);
+    break;
+
+  case 3:
+    time_.setMinute((time_.minute() + 60 + direction) % 60);
+    break;
+
+  default:
+    break;
+  }
+}
+
+void TimeSet::draw(Layer &layer, const Font &font, uint8_t c, bool selected, uint32_t & x, uint32_t & y)
+{
+  char s[10];
+  sprintf(s, "%01i", c);
+
+  if(selected)
+  {
+    layer.drawSquare(x-1, y-1, font.width() * scale + 2, font.height() * scale, Layer::Color::White);
+    layer.drawString(x, y, scale, s, Layer::Color::Black, font);
+  }
+  else
+  {
+    layer.drawString(x, y, scale, s, Layer::Color::White, font);
+  }
+  x += (font.width() * scale)+2;
+}
+
+void TimeSet::draw(Layer &layer, int32_t left, uint8_t hour, uint8_t minute, uint32_t selected, const Font &font)
+{
+  uint32_t x = left + 1;
+  uint32_t y = 4;
+
+  layer.clear(left, 0, Oled::WIDTH, Layer::HEIGHT);
+
+  draw(layer, font, hour / 10, selected == 0, x, y);
+  draw(layer, font, hour % 10, selected == 1, x, y);
+
+  layer.drawString(x, y, scale, ":", Layer::Color::White, font);
+  x += (font.width() * scale);
+
+  draw(layer, font, minute / 10, selected == 2, x, y);
+  draw(layer, font, minute % 10, selected == 3, x, y);
+}
@@ -0,0 +1,47 @@
+/*
+  Copyright (c) 2023 Daniel Zwirner
+  SPDX-License-Identifier: MIT-0
+*/
+
+#pragma once
+
+#include "cilo72/ic/sd2405.h"
+#include "compositor.h"
+#include "keys.h"
+#include "font.h"
+#include <stdint.h>
+
+// Edits a time digit by digit. Up and down also act on Repeat events, so
+// holding a key runs through the digit at the accelerating repeat rate;
+// every digit wraps within its field. draw() shows the edit on a layer and
+// is separate from the editing, it runs on the core that renders.
+class TimeSet
+{
+public:
+  TimeSet(uint8_t keyUp, uint8_t keyDown, uint8_t keyEnter);
+
+  void init(const cilo72::ic::SD2405::Time &time);
+  bool run(const KeyEvent &event, bool & pressed);
+
+  // On the panel whose columns start at left, which is cleared first.
+  static void draw(Layer &layer, int32_t left, uint8_t hour, uint8_t minute, uint32_t selected,
+                   const Font &font = font8x5);
+
+  const cilo72::ic::SD2405::Time & time() const
+  {
+    return time_;
+  }
+
+  uint32_t selected() const { return selected_; }
+
+private:
+  cilo72::ic::SD2405::Time time_;
+  uint8_t keyUp_;
+  uint8_t keyDown_;
+  uint8_t keyEnter_;
+  uint32_t selected_;
+  static constexpr uint32_t scale = 4;
+
+  void step(int32_t direction);
+  static void draw(Layer &layer, const Font &font, uint8_t c, bool selected, uint32_t & x, uint32_t & y);
+};
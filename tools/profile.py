@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+#
+#  Copyright (c) 2023 Daniel Zwirner
+#  SPDX-License-Identifier: MIT-0
+#
+# Reads the profile of an alarm clock built with ALARM_CLOCK_PROFILE, see
+# profiler.h for both formats, prints it and plots the histograms.
+#
+#   tools/profile.py /dev/ttyACM0              ask the clock for a binary dump
+#   tools/profile.py /dev/ttyACM0 --csv        the same as CSV
+#   tools/profile.py dump.bin --plot out.png   a dump saved before
+#
+# Talking to the clock needs pyserial, plotting matplotlib.
+
+import argparse
+import os
+import stat
+import sys
+
+BUCKETS = 16
+VERSION = 3
+
+# Tag, kind, text fields and number fields of each record.
+LAYOUTS = {
+    ord('h'): ('hist', 1, 3 + BUCKETS),
+    ord('i'): ('i2c', 0, 6),
+    ord('u'): ('uart', 1, 5),
+    ord('d'): ('display', 1, 3),
+    ord('t'): ('transition', 0, 2),
+    ord('a'): ('alarm', 0, 1),
+    ord('e'): ('end', 0, 0),
+}
+
+
+def decode_binary(data):
+    if data[:3] != b'ACP' or len(data) < 4 or data[3] != VERSION:
+        raise ValueError('not a version %d profile dump' % VERSION)
+    at = 4
+
+    def number():
+        nonlocal at
+        value, shift = 0, 0
+        while True:
+            byte = data[at]
+            at += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    records = []
+    while at < len(data):
+        tag = data[at]
+        at += 1
+        if tag not in LAYOUTS:
+            raise ValueError('unknown record %r at byte %d' % (chr(tag), at - 1))
+        kind, texts, numbers = LAYOUTS[tag]
+        record = [kind]
+        for _ in range(texts):
+            length = number()
+            record.append(data[at:at + length].decode())
+            at += length
+        record += [number() for _ in range(numbers)]
+        records.append(record)
+        if kind == 'end':
+            break
+    return records
+
+
+def decode_csv(text):
+    records = []
+    for line in text.splitlines():
+        fields = line.strip().split(',')
+        if not fields[0] or fields[0] not in [layout[0] for layout in LAYOUTS.values()]:
+            continue
+        kind, texts, _ = next(layout for layout in LAYOUTS.values() if layout[0] == fields[0])
+        records.append([kind] + fields[1:1 + texts] + [int(field) for field in fields[1 + texts:]])
+        if kind == 'end':
+            break
+    return records
+
+
+def decode(data):
+    if data.startswith(b'ACP'):
+        return decode_binary(data)
+    return decode_csv(data.decode(errors='replace'))
+
+
+def request(port, csv):
+    import serial
+
+    with serial.Serial(port, 115200, timeout=5) as link:
+        link.reset_input_buffer()
+        link.write(b'profile csv\n' if csv else b'profile binary\n')
+        data = b''
+        # The clock answers at its next pass; the dump ends with its end record.
+        while True:
+            chunk = link.read(256)
+            if not chunk:
+                raise TimeoutError('no complete dump from %s' % port)
+            data += chunk
+            start = data.find(b'hist' if csv else b'ACP')
+            if start < 0:
+                continue
+            try:
+                records = decode(data[start:])
+            except (IndexError, ValueError):
+                continue
+            if records and records[-1] == ['end']:
+                return data[start:]
+
+
+def bucket_label(bucket):
+    if bucket == 0:
+        return '0'
+    low = 1 << (bucket - 1)
+    if bucket == BUCKETS - 1:
+        return '>=%d' % low
+    return '%d-%d' % (low, 2 * low - 1)
+
+
+def report(records):
+    print('%-32s %8s %10s %8s %8s' % ('histogram', 'count', 'mean us', 'max us', 'share'))
+    hists = [r for r in records if r[0] == 'hist' and r[2]]
+    total = sum(r[3] for r in hists if r[1].startswith('state.')) or 1
+    for r in hists:
+        share = '%7.1f%%' % (100.0 * r[3] / total) if r[1].startswith('state.') else ''
+        print('%-32s %8d %10.1f %8d %8s' % (r[1], r[2], r[3] / r[2], r[4], share))
+
+    print()
+    print('%-8s %9s %13s %10s %12s %12s' % ('i2c', 'requests', 'transactions', 'bytes', 'busy us', 'max wait us'))
+    for r in records:
+        if r[0] == 'i2c':
+            print('0x%02x     %9d %13d %10d %12d %12d' % tuple(r[1:]))
+
+    for r in records:
+        if r[0] == 'uart':
+            print('\nuart %s: %d sent, %d coalesced, %d timeouts, %d failed, %d dropped' % tuple(r[1:]))
+        elif r[0] == 'display':
+            print('display %s (0x%02x): %d flushes, %d bytes' % tuple(r[1:]))
+        elif r[0] == 'transition':
+            print('digit transitions: %d steps, %d dropped' % tuple(r[1:]))
+        elif r[0] == 'alarm':
+            print('alarm sound: %d us after the alarm' % tuple(r[1:]))
+
+
+def plot(records, path):
+    import matplotlib
+    if path:
+        matplotlib.use('Agg')
+    import matplotlib.pyplot as plt
+
+    hists = [r for r in records if r[0] == 'hist' and r[2]]
+    columns = 3
+    rows = (len(hists) + columns - 1) // columns
+    figure, axes = plt.subplots(rows, columns, figsize=(5 * columns, 2.6 * rows), squeeze=False)
+    labels = [bucket_label(b) for b in range(BUCKETS)]
+    for ax, r in zip(axes.flat, hists):
+        ax.bar(range(BUCKETS), r[5:5 + BUCKETS])
+        ax.set_title('%s: %d, max %d us' % (r[1], r[2], r[4]), fontsize=9)
+        ax.set_xticks(range(BUCKETS))
+        ax.set_xticklabels(labels, rotation=90, fontsize=6)
+        ax.set_yscale('log')
+    for ax in list(axes.flat)[len(hists):]:
+        ax.axis('off')
+    figure.tight_layout()
+    if path:
+        figure.savefig(path)
+    else:
+        plt.show()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode and plot an alarm clock profile.')
+    parser.add_argument('source', help='serial port of the clock or a saved dump, - for stdin')
+    parser.add_argument('--csv', action='store_true', help='ask the clock for CSV instead of binary')
+    parser.add_argument('--save', metavar='FILE', help='keep the raw dump')
+    parser.add_argument('--plot', metavar='FILE', nargs='?', const='', help='plot, to FILE if given')
+    args = parser.parse_args()
+
+    if args.source == '-':
+        data = sys.stdin.buffer.read()
+    elif stat.S_ISCHR(os.stat(args.source).st_mode):
+        data = request(args.source, args.csv)
+    else:
+        with open(args.source, 'rb') as f:
+            data = f.read()
+
+    if args.save:
+        with open(args.save, 'wb') as f:
+            f.write(data)
+
+    records = decode(data)
+    report(records)
+    if args.plot is not None:
+        plot(records, args.plot)
+
+
+if __name__ == '__main__':
+    main()